@@ -15,8 +15,8 @@ Object hill(HILL, 20, 22);
 
 
 Mario mario(23, 40);
-Block hourBlock(13, 8);
-Block minuteBlock(32, 8);
+Block hourBlock(13, 8, &Super_Mario_Bros__24pt7b);
+Block minuteBlock(32, 8, &Super_Mario_Bros__24pt7b);
 
 unsigned long lastMillis = 0;
 
@@ -52,6 +52,7 @@ void Clockface::update() {
   hourBlock.update();
   minuteBlock.update();
   mario.update();
+  eventBus.dispatch();
 
   if (_dateTime->getSecond() == 0 && millis() - lastMillis > 1000) {
     mario.jump();
@@ -2,49 +2,33 @@
 
 //String &Block::_text;
 
-Block::Block(int x, int y) {
+Block::Block(int x, int y, const GFXfont* font) {
+  _font = font;
   _x = x;
   _y = y;
-  _firstY = y;
   _width = 19;
   _height = 19;
-}
 
-void Block::idle() {
-  if (_state != IDLE) {
-    // Serial.println("Block - Idle - Start");
+  uint16_t stepsUp = MAX_MOVE_HEIGHT / MOVE_PACE;
 
-    _lastState = _state;
-    _state = IDLE;
+  _bump[0] = {(int8_t)x, (int8_t)(y - MAX_MOVE_HEIGHT), EASING_LINEAR, (uint16_t)(stepsUp * MOVE_STEP_TIME)};
+  _bump[1] = {(int8_t)x, (int8_t)y, EASING_LINEAR, (uint16_t)(stepsUp * MOVE_STEP_TIME)};
 
-    _y = _firstY;
-  }
-} 
+  _animations[IDLE] = {1, 0, nullptr, 0, nullptr, 0, 0};
+  _animations[HIT] = {(uint8_t)(2 * stepsUp + 1), MOVE_STEP_TIME, nullptr, 0, _bump, 2, 0};
+}
 
 void Block::hit() {
-  if (_state != HIT) {
+  if (!_animator.playing(0)) {
     // Serial.println("Hit - Start");
-
-    _lastState = _state;
-    _state = HIT;
-
-    _lastY = _y;
-
-    direction = UP;
+    _animator.play(0, HIT, millis());
   }
 }
 
 void Block::setTextBlock() {
-  Locator::getDisplay()->setTextColor(0x0000);       
-  
-  
-  if (_text.length() == 1) {
-    Locator::getDisplay()->setCursor(_x+6, _y+12);
-  }  else {
-    Locator::getDisplay()->setCursor(_x+2, _y+12);
-  }
+  int16_t textX = (_text.length() == 1 ? _x+6 : _x+2);
 
-  Locator::getDisplay()->print(_text);
+  Locator::getGlyphCache()->print(Locator::getDisplay(), _font, _text.c_str(), textX, _y+12, 0x0000);
 }
 
 void Block::setText(String text) {
@@ -52,59 +36,35 @@ void Block::setText(String text) {
 }
 
 void Block::init() {
-  Locator::getEventBus()->subscribe(this);
-  Locator::getDisplay()->drawRGBBitmap(_x, _y, BLOCK, _width, _height);
-  setTextBlock();  
+  _animator.begin(_animations, this);
+  _animator.add(IDLE, _x, _y, _width, _height);
+  Locator::getSpatialGrid()->add(this, this);
 }
 
 void Block::update() {
+  _animator.update(millis(), 0);
+}
 
-  if (_state == IDLE && _lastState != _state) {
-    Locator::getDisplay()->drawRGBBitmap(_x, _y, BLOCK, _width, _height);
-
-    setTextBlock();
-
-    _lastState= _state;
-
-  } else if (_state == HIT) {
-    
-    if (millis() - lastMillis >= 60) {
-
-      // Serial.print("BLOCK Y = ");
-      // Serial.println(_y);
-      
-      Locator::getDisplay()->fillRect(_x, _y, _width, _height, SKY_COLOR);
-      
-      _y = _y + (MOVE_PACE * (direction == UP ? -1 : 1));
- 
-      Locator::getDisplay()->drawRGBBitmap(_x, _y, BLOCK, _width, _height);
-      setTextBlock();
-                 
-      if (floor(_firstY - _y) >= MAX_MOVE_HEIGHT) {
-        // Serial.println("DOWN");
-        direction = DOWN;
-      }
-
-      if (_y >= _firstY && direction == DOWN) {
-        idle();
-      }
+void Block::eraseSprite(int16_t x, int16_t y, int16_t width, int16_t height) {
+  Locator::getDisplay()->fillRect(x, y, width, height, SKY_COLOR);
+}
 
-      lastMillis = millis();
-    }
+void Block::drawSprite(uint16_t sprite, uint8_t frame, int16_t x, int16_t y) {
+  _y = y;
+  Locator::getSpatialGrid()->update(this);
 
-  }
+  Locator::getDisplay()->drawRGBBitmap(_x, _y, BLOCK, _width, _height);
+  setTextBlock();
 }
 
 
 void Block::execute(EventType event, Sprite* caller) {
   //Serial.println("Checking collision");
 
-  if (event == EventType::MOVE) {
-    if (this->collidedWith(caller)) {
-      Serial.println("Collision detected");
-      hit();
-      Locator::getEventBus()->broadcast(EventType::COLLISION, this);
-    }
+  if (event == EventType::COLLISION) {
+    Serial.println("Collision detected");
+    hit();
+    Locator::getEventBus()->broadcast(EventType::COLLISION, this);
   }
   
 }
@@ -4,38 +4,39 @@
 #include <Game.h>
 #include <Locator.h>
 #include <EventTask.h>
+#include <SpriteAnimator.h>
 #include "assets.h"
 
 const uint8_t MOVE_PACE = 2;
 const uint8_t MAX_MOVE_HEIGHT = 4;
+const uint16_t MOVE_STEP_TIME = 60;
 
-class Block: public Sprite, public EventTask {
+class Block: public Sprite, public EventTask, public SpriteRenderer {
   private:
-    enum State {
+    enum Animation {
       IDLE,
       HIT
-    };   
-
-    Direction direction; 
+    };
 
     String _text;
+    const GFXfont* _font;
+
+    // Up MAX_MOVE_HEIGHT and back, one MOVE_PACE step per frame
+    Keyframe _bump[2];
+    SpriteAnimation _animations[2];
+    SpriteAnimator _animator;
 
-    unsigned long lastMillis = 0;
-    State _state = IDLE; 
-    State _lastState = IDLE; 
-    uint8_t _lastY;
-    uint8_t _firstY;
-    
-    void idle();
     void hit();
     void setTextBlock();
 
   public:
-    Block(int x, int y);
+    Block(int x, int y, const GFXfont* font);
     void setText(String text);
     void init();
     void update();    
     const char* name();
     void execute(EventType event, Sprite* caller);
 
+    void eraseSprite(int16_t x, int16_t y, int16_t width, int16_t height) override;
+    void drawSprite(uint16_t sprite, uint8_t frame, int16_t x, int16_t y) override;
 };
@@ -27,6 +27,7 @@ void Mario::jump() {
     _width = MARIO_JUMP_SIZE[0];
     _height = MARIO_JUMP_SIZE[1];
     _sprite = MARIO_JUMP;
+    Locator::getSpatialGrid()->update(this);
 
     direction = UP;
 
@@ -47,12 +48,14 @@ void Mario::idle() {
     _width = MARIO_IDLE_SIZE[0];
     _height = MARIO_IDLE_SIZE[1];
     _sprite = MARIO_IDLE;
+    Locator::getSpatialGrid()->update(this);
   }
 }
 
 
 void Mario::init() {
-  Locator::getEventBus()->subscribe(this);
+  Locator::getSpatialGrid()->add(this);
+  Locator::getEventBus()->subscribe(this, EventType::COLLISION);
   Locator::getDisplay()->drawRGBBitmap(_x, _y, MARIO_IDLE, MARIO_IDLE_SIZE[0], MARIO_IDLE_SIZE[1]);
 }
 
@@ -73,7 +76,7 @@ void Mario::update() {
 
       Locator::getDisplay()->drawRGBBitmap(_x, _y, _sprite, _width, _height);
       
-      Locator::getEventBus()->broadcast(MOVE, this);
+      Locator::getSpatialGrid()->update(this);
 
      
       if (floor(_lastY - _y) >= MARIO_JUMP_HEIGHT) {
@@ -1,8 +1,22 @@
 #include "pacman.h"
 
+enum PacmanAnimation {
+  CHEWING
+};
+
+// The mouth opens or closes every third step of 75ms
+static const SpriteAnimation PACMAN_ANIMATIONS[] = {
+  {2, 225, nullptr, SPRITE_LOOP_ENDLESS, nullptr, 0, 0}
+};
+
 Pacman::Pacman(int x, int y) {
   _x = x;
   _y = y;
+  _width = SPRITE_SIZE;
+  _height = SPRITE_SIZE;
+
+  _animator.begin(PACMAN_ANIMATIONS, this);
+  _animator.add(CHEWING, _x, _y, _width, _height);
 }
 
 void Pacman::turn(Direction dir) {
@@ -42,20 +56,17 @@ void Pacman::move(Direction dir) {
 
 
 void Pacman::init() {
-  //Locator::getEventBus()->subscribe(this);
-  Locator::getDisplay()->drawRGBBitmap(_x, _y, _PACMAN[int(_pacman_anim)], SPRITE_SIZE, SPRITE_SIZE);
+  //Locator::getEventBus()->subscribe(this, EventType::COLLISION);
+  Locator::getDisplay()->drawRGBBitmap(_x, _y, _PACMAN[_animator.frame(0)], SPRITE_SIZE, SPRITE_SIZE);
 }
 
 void Pacman::update() { 
   
   if (_state == MOVING || _state == INVENCIBLE) {
-    Locator::getDisplay()->fillRect(_x,_y, SPRITE_SIZE, SPRITE_SIZE, 0);
     this->move(_direction);
+    _animator.moveTo(0, _x, _y);
   }
 
-  if (_iteration % 3 == 0)
-    _pacman_anim = !_pacman_anim; 
-
 
   if (_state == INVENCIBLE) {
     
@@ -73,11 +84,19 @@ void Pacman::update() {
     changePacmanColor(current_color);
   }
   
-  Locator::getDisplay()->drawRGBBitmap(_x, _y, _PACMAN[int(_pacman_anim)], SPRITE_SIZE, SPRITE_SIZE);
+  _animator.update(millis(), 0);
 
   _iteration++;
 }
 
+void Pacman::eraseSprite(int16_t x, int16_t y, int16_t width, int16_t height) {
+  Locator::getDisplay()->fillRect(x, y, width, height, 0);
+}
+
+void Pacman::drawSprite(uint16_t sprite, uint8_t frame, int16_t x, int16_t y) {
+  Locator::getDisplay()->drawRGBBitmap(x, y, _PACMAN[frame], SPRITE_SIZE, SPRITE_SIZE);
+}
+
 void Pacman::setState(State state) {
 
   if (state == INVENCIBLE) {
@@ -4,11 +4,12 @@
 #include <Game.h>
 #include <Locator.h>
 #include <EventBus.h>
+#include <SpriteAnimator.h>
 #include <ImageUtils.h>
 #include "assets.h"
 
 
-class Pacman: public Sprite, public EventTask {
+class Pacman: public Sprite, public EventTask, public SpriteRenderer {
   private:
 
     uint16_t _PACMAN [2][25] = {
@@ -39,8 +40,8 @@ class Pacman: public Sprite, public EventTask {
     const unsigned short* _sprite;
     unsigned long invencibleTimeout = 0;
     
-
-    bool _pacman_anim = true;
+    // Chews through both frames of _PACMAN, moved by the clockface
+    SpriteAnimator _animator;
 
     void flip();
     void rotate();
@@ -65,6 +66,8 @@ class Pacman: public Sprite, public EventTask {
     void update();
     const char* name();
     void execute(EventType event, Sprite* caller);
+    void eraseSprite(int16_t x, int16_t y, int16_t width, int16_t height) override;
+    void drawSprite(uint16_t sprite, uint8_t frame, int16_t x, int16_t y) override;
     Direction _direction = Direction::RIGHT;
     State _state = MOVING;
     const int SPRITE_SIZE = 5;
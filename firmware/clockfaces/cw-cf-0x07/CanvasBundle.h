@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <CWCanvasTypes.h>
+
+#define CANVAS_BUNDLE_FORMAT 4
+
+// A canvas compiled on a host by the canvas bundler (tools/canvas-bundler), so the clock
+// loads it with plain reads: no JSON, no base64, no PNG decoding. Everything is little endian.
+//
+//   CanvasBundleHeader
+//   strings     stringsSize bytes, the string pool of CanvasProgram
+//   elements    elementCount x CanvasBundleElement
+//   sprites     spriteCount x CanvasBundleSprite
+//   frames      frameCount x CanvasBundleFrame
+//   instances   instanceCount x CanvasBundleInstance
+//   keyframes   keyframeCount x CanvasBundleKeyframe, the paths of the instances
+//   fonts       fontCount x CanvasBundleFont, each followed by its font pack
+//   bitmaps     bitmapCount x CanvasBundleBitmap
+//   atlas       atlasSize bytes, RGB565 pixels of each bitmap followed by its 1 bit mask, if any
+
+struct __attribute__((packed)) CanvasBundleHeader
+{
+  uint32_t magic;
+  uint16_t format;
+  uint16_t version;
+  uint16_t bgColor;
+  uint16_t delay;
+  uint16_t name;
+  uint16_t author;
+  uint16_t stringsSize;
+  uint16_t elementCount;
+  uint16_t spriteCount;
+  uint16_t frameCount;
+  uint16_t instanceCount;
+  uint16_t bitmapCount;
+  uint16_t keyframeCount;
+  uint16_t fontCount;
+  uint32_t atlasSize;
+};
+
+struct __attribute__((packed)) CanvasBundleElement
+{
+  uint8_t type;
+  uint16_t font;    // string offset of the font name, 0 for the default font
+  int16_t x, y;
+  int16_t x1, y1;
+  uint16_t color;
+  uint16_t bgColor;
+  uint16_t text;    // string offset, the bitmap index for images
+};
+
+struct __attribute__((packed)) CanvasBundleSprite
+{
+  uint16_t firstFrame;
+  uint8_t count;
+  uint8_t width, height;
+};
+
+// Animations are bundled as one bitmap per frame, with the delay they were made with
+struct __attribute__((packed)) CanvasBundleFrame
+{
+  uint16_t bitmap;
+  uint16_t delay;   // ms, 0 to use the instance's frameDelay
+};
+
+struct __attribute__((packed)) CanvasBundleInstance
+{
+  uint32_t loopDelay;
+  uint32_t frameDelay;
+  uint32_t moveStartTime;
+  uint16_t firstKeyframe;
+  uint8_t keyframeCount;
+  uint8_t sprite;
+  int8_t x, y;
+};
+
+struct __attribute__((packed)) CanvasBundleKeyframe
+{
+  int8_t x, y;
+  uint8_t easing;
+  uint16_t duration;
+};
+
+// A font shipped in the canvas, see FontRegistry.h for the pack
+struct __attribute__((packed)) CanvasBundleFont
+{
+  uint16_t name;
+  uint32_t size;
+};
+
+// A decoded image in the atlas, same layout as a SpriteCache entry
+struct __attribute__((packed)) CanvasBundleBitmap
+{
+  uint32_t offset;
+  uint8_t width, height;
+  uint8_t hasMask;
+  uint8_t reserved;
+
+  uint32_t pixelBytes() const { return width * height * 2; }
+  uint32_t maskBytes() const { return (hasMask ? ((width + 7) / 8) * height : 0); }
+};
@@ -0,0 +1,761 @@
+#include "CanvasProgram.h"
+#include <algorithm>
+
+static bool elementType(const char *type, CanvasElementType &result)
+{
+  static const struct { const char *name; CanvasElementType type; } TYPES[] = {
+    {"text", ELEMENT_TEXT},
+    {"datetime", ELEMENT_DATETIME},
+    {"fillrect", ELEMENT_FILLRECT},
+    {"rect", ELEMENT_RECT},
+    {"line", ELEMENT_LINE},
+    {"image", ELEMENT_IMAGE},
+  };
+
+  if (type == nullptr)
+    return false;
+
+  for (auto &entry : TYPES)
+  {
+    if (strcmp(type, entry.name) == 0) {
+      result = entry.type;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void easingType(const char *name, Easing &result)
+{
+  static const char *const NAMES[] = {"linear", "easeIn", "easeOut", "easeInOut", "bounce"};
+
+  for (uint8_t i = 0; i < EASING_COUNT; i++)
+  {
+    if (strcmp(name, NAMES[i]) == 0)
+      result = (Easing)i;
+  }
+}
+
+// Largest pool a uint16_t offset reaches, one byte is always left for the terminator
+#define CANVAS_POOL_MAX (UINT16_MAX - 1)
+
+// Appends to the string pool, failing the read once it is full
+class PoolWriter : public Print
+{
+private:
+  std::vector<char> &_pool;
+
+public:
+  PoolWriter(std::vector<char> &pool) : _pool(pool) {}
+
+  size_t write(uint8_t c) override
+  {
+    if (_pool.size() >= CANVAS_POOL_MAX)
+      return 0;
+
+    _pool.push_back(c);
+    return 1;
+  }
+};
+
+// Decodes base64 as it is written. Past the limit or on an invalid character it only
+// remembers the failure, so the JSON around it keeps being read
+class Base64Writer : public Print
+{
+private:
+  std::vector<uint8_t> &_out;
+  size_t _limit;
+  uint32_t _bits = 0;
+  uint8_t _count = 0;
+
+public:
+  bool failed = false;
+
+  Base64Writer(std::vector<uint8_t> &out, size_t limit) : _out(out), _limit(limit) {}
+
+  size_t write(uint8_t c) override
+  {
+    int8_t value;
+    if (c >= 'A' && c <= 'Z')
+      value = c - 'A';
+    else if (c >= 'a' && c <= 'z')
+      value = c - 'a' + 26;
+    else if (c >= '0' && c <= '9')
+      value = c - '0' + 52;
+    else if (c == '+' || c == '/')
+      value = (c == '+' ? 62 : 63);
+    else {
+      failed = failed || (c != '=' && c != '\n' && c != '\r');
+      return 1;
+    }
+
+    _bits = (_bits << 6) | value;
+    _count += 6;
+    if (_count >= 8) {
+      _count -= 8;
+      failed = failed || _out.size() >= _limit;
+      if (!failed)
+        _out.push_back((_bits >> _count) & 0xFF);
+    }
+    return 1;
+  }
+};
+
+// Values of an unexpected type read as 0 / "", like a missing key
+static bool readNumber(JsonStreamReader &json, long &value)
+{
+  int c = json.peek();
+  if (c == '{' || c == '[' || c == '"') {
+    value = 0;
+    return json.skipValue();
+  }
+  return json.readInteger(value);
+}
+
+static bool readName(JsonStreamReader &json, char *buffer, size_t size)
+{
+  if (json.peek() == '"')
+    return json.readString(buffer, size);
+
+  buffer[0] = 0;
+  return json.skipValue();
+}
+
+void CanvasProgram::clear()
+{
+  elements.clear();
+  sprites.clear();
+  instances.clear();
+  keyframes.clear();
+  fontPacks.clear();
+  _frames.clear();
+  _frameDelays.clear();
+  frameHandles.clear();
+  _strings.clear();
+  bitmaps.clear();
+  atlasStart = 0;
+  _bundled = false;
+  bgColor = delay = version = name = author = 0;
+}
+
+bool CanvasProgram::readText(JsonStreamReader &json, uint16_t &offset)
+{
+  offset = 0;
+  if (json.peek() != '"')
+    return json.skipValue();
+
+  PoolWriter pool(_strings);
+  size_t start = _strings.size();
+
+  if (!json.readString(&pool))
+    return false;
+
+  // Empty strings all share the one at offset 0
+  if (_strings.size() == start)
+    return true;
+
+  offset = start;
+  _strings.push_back(0);
+  return true;
+}
+
+bool CanvasProgram::readElement(JsonStreamReader &json, FontRegistry &fonts, CanvasListener *listener)
+{
+  if (json.peek() != '{')
+    return json.skipValue();
+
+  size_t poolStart = _strings.size();
+  char key[24];
+  char type[12] = "";
+  char font[CW_FONT_NAME_MAX + 1] = "";
+  long x = 0, y = 0, x1 = 0, y1 = 0, width = 0, height = 0, color = 0, fgColor = 0, bgColor = 0;
+  uint16_t content = 0, image = 0;
+
+  const struct { const char *key; long *value; } NUMBERS[] = {
+    {"x", &x}, {"y", &y}, {"x1", &x1}, {"y1", &y1}, {"width", &width}, {"height", &height},
+    {"color", &color}, {"fgColor", &fgColor}, {"bgColor", &bgColor},
+  };
+
+  json.beginObject();
+  while (json.nextMember(key, sizeof(key)))
+  {
+    if (strcmp(key, "type") == 0)
+      readName(json, type, sizeof(type));
+    else if (strcmp(key, "font") == 0)
+      readName(json, font, sizeof(font));
+    else if (strcmp(key, "content") == 0)
+      readText(json, content);
+    else if (strcmp(key, "image") == 0)
+      readText(json, image);
+    else
+    {
+      long *value = nullptr;
+      for (auto &number : NUMBERS)
+      {
+        if (strcmp(key, number.key) == 0)
+          value = number.value;
+      }
+      (value != nullptr ? readNumber(json, *value) : json.skipValue());
+    }
+  }
+
+  CanvasElement element = {};
+  if (json.failed() || !elementType(type, element.type)) {
+    // Strings of an element that is not drawn are dropped again
+    if (!json.failed())
+      _strings.resize(poolStart);
+    return !json.failed();
+  }
+
+  element.x = x;
+  element.y = y;
+
+  switch (element.type)
+  {
+  case ELEMENT_TEXT:
+  case ELEMENT_DATETIME:
+    element.font = fonts.intern(font);
+    element.color = fgColor;
+    element.bgColor = bgColor;
+    element.text = content;
+    break;
+  case ELEMENT_FILLRECT:
+  case ELEMENT_RECT:
+    element.x1 = width;
+    element.y1 = height;
+    element.color = color;
+    break;
+  case ELEMENT_LINE:
+    element.x1 = x1;
+    element.y1 = y1;
+    element.color = color;
+    break;
+  case ELEMENT_IMAGE:
+    element.text = image;
+    break;
+  }
+
+  elements.push_back(element);
+
+  if (listener != nullptr)
+    listener->onElement(*this, elements.back());
+
+  return true;
+}
+
+bool CanvasProgram::readSprites(JsonStreamReader &json)
+{
+  if (json.peek() != '[')
+    return json.skipValue();
+
+  char key[24];
+
+  json.beginArray();
+  while (json.nextElement())
+  {
+    CanvasSpriteFrames sprite = {(uint16_t)_frames.size(), 0, 0, 0, false};
+
+    if (json.peek() == '{') {
+      readAnimation(json, sprite);
+      sprites.push_back(sprite);
+      continue;
+    }
+
+    if (json.peek() != '[') {
+      json.skipValue();
+      sprites.push_back(sprite);
+      continue;
+    }
+
+    json.beginArray();
+    while (json.nextElement())
+    {
+      uint16_t offset = 0;
+
+      if (json.peek() == '{') {
+        json.beginObject();
+        while (json.nextMember(key, sizeof(key)))
+          (strcmp(key, "image") == 0 ? readText(json, offset) : json.skipValue());
+      } else {
+        json.skipValue();
+      }
+
+      _frames.push_back(offset);
+      _frameDelays.push_back(0);
+      sprite.count++;
+    }
+    sprites.push_back(sprite);
+  }
+  return !json.failed();
+}
+
+// {"animation": "<base64 GIF or APNG>"}: kept in the pool like an image, only its frame
+// count, delays and size are read here. The clock decodes all its frames at once
+bool CanvasProgram::readAnimation(JsonStreamReader &json, CanvasSpriteFrames &sprite)
+{
+  char key[24];
+  uint16_t offset = 0;
+
+  json.beginObject();
+  while (json.nextMember(key, sizeof(key)))
+    (strcmp(key, "animation") == 0 ? readText(json, offset) : json.skipValue());
+
+  if (json.failed() || offset == 0)
+    return false;
+
+  std::vector<uint8_t> data;
+  Base64Writer decoder(data, CW_ANIMATION_MAX_SIZE);
+  for (const char *c = text(offset); *c != 0; c++)
+    decoder.write(*c);
+
+  AnimationDecoder animation;
+  std::vector<uint16_t> delays;
+  if (decoder.failed || !animation.open(data.data(), data.size(), nullptr, &delays))
+  {
+    Serial.printf("[Canvas] Sprite %u is not an animated GIF or PNG\n", (unsigned)sprites.size());
+    return false;
+  }
+
+  sprite.count = delays.size();
+  sprite.width = animation.width();
+  sprite.height = animation.height();
+  sprite.animation = true;
+  for (uint16_t delay : delays)
+  {
+    _frames.push_back(offset);
+    _frameDelays.push_back(delay);
+  }
+  return true;
+}
+
+uint8_t CanvasProgram::animationFrames(uint16_t index) const
+{
+  if (_bundled)
+    return 0;
+
+  for (const CanvasSpriteFrames &sprite : sprites)
+    if (sprite.animation && sprite.firstFrame == index)
+      return sprite.count;
+  return 0;
+}
+
+// [{"name": "tiny", "pack": "<base64 font pack>"}], registered as soon as each one is read
+bool CanvasProgram::readFonts(JsonStreamReader &json, FontRegistry &fonts)
+{
+  if (json.peek() != '[')
+    return json.skipValue();
+
+  char key[24];
+
+  json.beginArray();
+  while (json.nextElement())
+  {
+    if (json.peek() != '{') {
+      json.skipValue();
+      continue;
+    }
+
+    char name[CW_FONT_NAME_MAX + 1] = "";
+    std::vector<uint8_t> pack;
+    Base64Writer decoder(pack, CW_FONT_PACK_BUDGET);
+
+    json.beginObject();
+    while (json.nextMember(key, sizeof(key)))
+    {
+      if (strcmp(key, "name") == 0)
+        readName(json, name, sizeof(name));
+      else if (strcmp(key, "pack") == 0 && json.peek() == '"')
+        json.readString(&decoder);
+      else
+        json.skipValue();
+    }
+
+    if (json.failed() || name[0] == 0 || pack.empty())
+      continue;
+
+    MemoryStream input(pack.data(), pack.size());
+    String error;
+
+    if (decoder.failed || !fonts.load(name, input, pack.size(), error)) {
+      Serial.printf("[Canvas] Font '%s' not loaded: %s\n", name, (decoder.failed ? "Invalid base64" : error.c_str()));
+      continue;
+    }
+
+    uint8_t id = fonts.intern(name);
+    if (std::find(fontPacks.begin(), fontPacks.end(), id) == fontPacks.end())
+      fontPacks.push_back(id);
+  }
+  return !json.failed();
+}
+
+// Absolute points, e.g. [{"x": 40, "y": 8, "duration": 600, "easing": "easeInOut"}, ...]
+bool CanvasProgram::readPath(JsonStreamReader &json, LoopEntry &entry)
+{
+  if (json.peek() != '[')
+    return json.skipValue();
+
+  char key[24];
+  entry.firstKeyframe = keyframes.size();
+  entry.keyframeCount = 0;
+
+  json.beginArray();
+  while (json.nextElement())
+  {
+    if (json.peek() != '{') {
+      json.skipValue();
+      continue;
+    }
+
+    char easing[12] = "";
+    long x = 0, y = 0, duration = 0;
+
+    json.beginObject();
+    while (json.nextMember(key, sizeof(key)))
+    {
+      if (strcmp(key, "easing") == 0)
+        readName(json, easing, sizeof(easing));
+      else if (strcmp(key, "x") == 0)
+        readNumber(json, x);
+      else if (strcmp(key, "y") == 0)
+        readNumber(json, y);
+      else if (strcmp(key, "duration") == 0)
+        readNumber(json, duration);
+      else
+        json.skipValue();
+    }
+
+    Keyframe keyframe = {(int8_t)x, (int8_t)y, EASING_LINEAR, (uint16_t)min(max(duration, 0L), (long)UINT16_MAX)};
+    easingType(easing, keyframe.easing);
+
+    if (entry.keyframeCount < UINT8_MAX && keyframes.size() < UINT16_MAX) {
+      keyframes.push_back(keyframe);
+      entry.keyframeCount++;
+    }
+  }
+  return !json.failed();
+}
+
+bool CanvasProgram::readLoop(JsonStreamReader &json, std::vector<LoopEntry> &loop)
+{
+  if (json.peek() != '[')
+    return json.skipValue();
+
+  char key[24];
+
+  json.beginArray();
+  while (json.nextElement())
+  {
+    LoopEntry entry = {};
+    loop.push_back(entry);
+
+    if (json.peek() != '{') {
+      json.skipValue();
+      continue;
+    }
+
+    char type[8] = "";
+    long loopDelay = 0, frameDelay = 0, moveStartTime = 0, moveDuration = 0;
+    long sprite = 0, x = 0, y = 0, moveTargetX = 0, moveTargetY = 0, returnToOrigin = 0;
+
+    const struct { const char *key; long *value; } NUMBERS[] = {
+      {"sprite", &sprite}, {"x", &x}, {"y", &y},
+      {"loopDelay", &loopDelay}, {"frameDelay", &frameDelay},
+      {"moveStartTime", &moveStartTime}, {"moveDuration", &moveDuration},
+      {"moveTargetX", &moveTargetX}, {"moveTargetY", &moveTargetY},
+      {"shouldReturnToOrigin", &returnToOrigin},
+    };
+
+    json.beginObject();
+    while (json.nextMember(key, sizeof(key)))
+    {
+      if (strcmp(key, "type") == 0) {
+        readName(json, type, sizeof(type));
+        continue;
+      }
+
+      if (strcmp(key, "path") == 0) {
+        readPath(json, loop.back());
+        continue;
+      }
+
+      long *value = nullptr;
+      for (auto &number : NUMBERS)
+      {
+        if (strcmp(key, number.key) == 0)
+          value = number.value;
+      }
+      (value != nullptr ? readNumber(json, *value) : json.skipValue());
+    }
+
+    LoopEntry &last = loop.back();
+    last.isSprite = (strcmp(type, "sprite") == 0);
+    last.sprite = sprite;
+    last.x = x;
+    last.y = y;
+    last.loopDelay = loopDelay;
+    last.frameDelay = (uint16_t)frameDelay;
+    last.moveStartTime = moveStartTime;
+    last.moveDuration = moveDuration;
+    last.moveTargetX = moveTargetX;
+    last.moveTargetY = moveTargetY;
+    last.returnToOrigin = (returnToOrigin != 0);
+  }
+  return !json.failed();
+}
+
+// Needs delay and all sprites, which can come after the loop in the file
+void CanvasProgram::resolveLoop(const std::vector<LoopEntry> &loop)
+{
+  static const LoopEntry NO_TIMING = {};
+
+  for (const LoopEntry &entry : loop)
+  {
+    if (!entry.isSprite || entry.sprite >= sprites.size() || sprites[entry.sprite].count == 0)
+      continue;
+
+    // Timing and movement come from the loop entry at the sprite's index
+    const LoopEntry &timing = (entry.sprite < loop.size() ? loop[entry.sprite] : NO_TIMING);
+
+    CanvasSpriteInstance instance;
+    instance.sprite = entry.sprite;
+    instance.x = entry.x;
+    instance.y = entry.y;
+    instance.loopDelay = timing.loopDelay ?: delay;
+    instance.frameDelay = timing.frameDelay ?: delay;
+    instance.moveStartTime = timing.moveStartTime ?: 1;
+    instance.firstKeyframe = timing.firstKeyframe;
+    instance.keyframeCount = timing.keyframeCount;
+
+    // Without a path, moveTarget is a one keyframe path, or two when it returns to the origin
+    int8_t targetX = timing.moveTargetX ?: -1;
+    int8_t targetY = timing.moveTargetY ?: -1;
+
+    if (instance.keyframeCount == 0 && timing.moveDuration > 0 && (targetX > -1 || targetY > -1) && keyframes.size() < UINT16_MAX - 1) {
+      uint16_t duration = min(timing.moveDuration, (uint32_t)UINT16_MAX);
+
+      instance.firstKeyframe = keyframes.size();
+      keyframes.push_back({targetX, targetY, EASING_LINEAR, duration});
+      if (timing.returnToOrigin)
+        keyframes.push_back({timing.x, timing.y, EASING_LINEAR, duration});
+      instance.keyframeCount = keyframes.size() - instance.firstKeyframe;
+    }
+
+    instances.push_back(instance);
+  }
+}
+
+bool CanvasProgram::compile(Stream &input, int32_t size, FontRegistry &fonts, CanvasListener *listener, String &error)
+{
+  clear();
+  if (listener != nullptr)
+    listener->onStart();
+
+  // Base64 images are most of a canvas, so the pool never needs more than the file size
+  if (size > 0)
+    _strings.reserve(min(size, (int32_t)UINT16_MAX));
+  _strings.push_back(0);
+
+  JsonStreamReader json(input);
+  std::vector<LoopEntry> loop;
+  bool hasName = false;
+  bool hasSetup = false;
+  char key[24];
+
+  json.beginObject();
+  while (json.nextMember(key, sizeof(key)))
+  {
+    long value = 0;
+
+    if (strcmp(key, "name") == 0) {
+      hasName = (json.peek() == '"');
+      readText(json, name);
+    } else if (strcmp(key, "author") == 0) {
+      readText(json, author);
+    } else if (strcmp(key, "bgColor") == 0) {
+      readNumber(json, value);
+      bgColor = value;
+      if (listener != nullptr)
+        listener->onBackground(bgColor);
+    } else if (strcmp(key, "delay") == 0) {
+      readNumber(json, value);
+      delay = value;
+    } else if (strcmp(key, "version") == 0) {
+      readNumber(json, value);
+      version = value;
+    } else if (strcmp(key, "setup") == 0 && json.peek() == '[') {
+      hasSetup = true;
+      json.beginArray();
+      while (json.nextElement())
+        readElement(json, fonts, listener);
+    } else if (strcmp(key, "sprites") == 0) {
+      readSprites(json);
+    } else if (strcmp(key, "loop") == 0) {
+      readLoop(json, loop);
+    } else if (strcmp(key, "fonts") == 0) {
+      readFonts(json, fonts);
+    } else {
+      json.skipValue();
+    }
+  }
+
+  if (json.failed() || !hasName || !hasSetup)
+  {
+    error = (_strings.size() >= CANVAS_POOL_MAX ? "Canvas strings exceed 64KB" : json.failed() ? "Invalid JSON" : "Not a canvas definition");
+    clear();
+    return false;
+  }
+
+  resolveLoop(loop);
+  frameHandles.assign(_frames.size(), -1);
+
+  if (size <= 0)
+    _strings.shrink_to_fit();
+
+  return true;
+}
+
+static bool readRecord(Stream &input, void *record, size_t size, uint32_t &position)
+{
+  position += size;
+  return (size == 0 || input.readBytes((uint8_t *)record, size) == size);
+}
+
+bool CanvasProgram::load(Stream &bundle, int32_t size, FontRegistry &fonts, String &error)
+{
+  clear();
+
+  CanvasBundleHeader header;
+  uint32_t position = 0;
+
+  if (!readRecord(bundle, &header, sizeof(header), position) || header.magic != CW_CANVAS_BUNDLE_MAGIC || header.format != CANVAS_BUNDLE_FORMAT) {
+    error = "Not a canvas bundle";
+    return false;
+  }
+
+  bool valid = (header.stringsSize > 0);
+
+  _strings.resize(header.stringsSize);
+  valid = valid && readRecord(bundle, _strings.data(), _strings.size(), position) && _strings.back() == 0;
+
+  elements.reserve(header.elementCount);
+  for (uint16_t i = 0; valid && i < header.elementCount; i++)
+  {
+    CanvasBundleElement record;
+    valid = readRecord(bundle, &record, sizeof(record), position) && record.type <= ELEMENT_IMAGE && record.font < header.stringsSize;
+
+    CanvasElement element = {};
+    element.type = (CanvasElementType)record.type;
+    element.font = (valid ? fonts.intern(text(record.font)) : FontRegistry::DEFAULT_FONT);
+    element.text = record.text;
+    element.x = record.x;
+    element.y = record.y;
+    element.x1 = record.x1;
+    element.y1 = record.y1;
+    element.color = record.color;
+    element.bgColor = record.bgColor;
+
+    valid = valid && (element.type == ELEMENT_IMAGE ? element.text < header.bitmapCount : element.text < header.stringsSize);
+    elements.push_back(element);
+  }
+
+  sprites.reserve(header.spriteCount);
+  for (uint16_t i = 0; valid && i < header.spriteCount; i++)
+  {
+    CanvasBundleSprite record;
+    valid = readRecord(bundle, &record, sizeof(record), position) && record.firstFrame + record.count <= header.frameCount;
+    sprites.push_back({record.firstFrame, record.count, record.width, record.height, false});
+  }
+
+  _frames.reserve(header.frameCount);
+  _frameDelays.reserve(header.frameCount);
+  for (uint16_t i = 0; valid && i < header.frameCount; i++)
+  {
+    CanvasBundleFrame record;
+    valid = readRecord(bundle, &record, sizeof(record), position) && record.bitmap < header.bitmapCount;
+    _frames.push_back(record.bitmap);
+    _frameDelays.push_back(record.delay);
+  }
+
+  instances.reserve(header.instanceCount);
+  for (uint16_t i = 0; valid && i < header.instanceCount; i++)
+  {
+    CanvasBundleInstance record;
+    valid = readRecord(bundle, &record, sizeof(record), position) && record.sprite < header.spriteCount;
+
+    valid = valid && record.firstKeyframe + record.keyframeCount <= header.keyframeCount;
+
+    CanvasSpriteInstance instance;
+    instance.loopDelay = record.loopDelay;
+    instance.frameDelay = record.frameDelay;
+    instance.moveStartTime = record.moveStartTime;
+    instance.firstKeyframe = record.firstKeyframe;
+    instance.keyframeCount = record.keyframeCount;
+    instance.sprite = record.sprite;
+    instance.x = record.x;
+    instance.y = record.y;
+    instances.push_back(instance);
+  }
+
+  keyframes.reserve(header.keyframeCount);
+  for (uint16_t i = 0; valid && i < header.keyframeCount; i++)
+  {
+    CanvasBundleKeyframe record;
+    valid = readRecord(bundle, &record, sizeof(record), position) && record.easing < EASING_COUNT;
+    keyframes.push_back({record.x, record.y, (Easing)record.easing, record.duration});
+  }
+
+  // A font that cannot be loaded is drawn with the default one, like an unknown font name
+  for (uint16_t i = 0; valid && i < header.fontCount; i++)
+  {
+    CanvasBundleFont record;
+    valid = readRecord(bundle, &record, sizeof(record), position) && record.name < header.stringsSize;
+
+    String fontError;
+    if (valid && !fonts.load(text(record.name), bundle, record.size, fontError))
+      Serial.printf("[Canvas] Font '%s' not loaded: %s\n", text(record.name), fontError.c_str());
+    else if (valid)
+      fontPacks.push_back(fonts.intern(text(record.name)));
+    position += record.size;
+  }
+
+  bitmaps.resize(header.bitmapCount);
+  valid = valid && readRecord(bundle, bitmaps.data(), bitmaps.size() * sizeof(CanvasBundleBitmap), position);
+  for (const CanvasBundleBitmap &bitmap : bitmaps)
+    valid = valid && bitmap.offset + bitmap.pixelBytes() + bitmap.maskBytes() <= header.atlasSize;
+
+  if (!valid || header.name >= header.stringsSize || header.author >= header.stringsSize || (size > 0 && (uint32_t)size != position + header.atlasSize))
+  {
+    clear();
+    error = "Invalid canvas bundle";
+    return false;
+  }
+
+  bgColor = header.bgColor;
+  delay = header.delay;
+  version = header.version;
+  name = header.name;
+  author = header.author;
+  atlasStart = position;
+  frameHandles.assign(_frames.size(), -1);
+  _bundled = true;
+  return true;
+}
+
+void CanvasProgram::requireFonts(FontRegistry &fonts) const
+{
+  for (const CanvasElement &element : elements)
+  {
+    if (element.type == ELEMENT_TEXT || element.type == ELEMENT_DATETIME)
+      fonts.require(element.font);
+  }
+}
+
+size_t CanvasProgram::memoryUsage() const
+{
+  return _strings.capacity() + (_frames.capacity() + _frameDelays.capacity() + frameHandles.capacity()) * sizeof(uint16_t) +
+         bitmaps.capacity() * sizeof(CanvasBundleBitmap) +
+         elements.capacity() * sizeof(CanvasElement) +
+         sprites.capacity() * sizeof(CanvasSpriteFrames) +
+         instances.capacity() * sizeof(CanvasSpriteInstance) +
+         keyframes.capacity() * sizeof(Keyframe);
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <Arduino.h>
+#include <gfxfont.h>
+#include <vector>
+#include <CWJsonReader.h>
+#include <CWCanvasTypes.h>
+#include <Motion.h>
+#include <FontRegistry.h>
+#include <AnimationDecoder.h>
+#include "CanvasBundle.h"
+
+enum CanvasElementType : uint8_t
+{
+  ELEMENT_TEXT,
+  ELEMENT_DATETIME,
+  ELEMENT_FILLRECT,
+  ELEMENT_RECT,
+  ELEMENT_LINE,
+  ELEMENT_IMAGE
+};
+
+// One entry of "setup". For rects x1/y1 are width/height, for lines the end point
+struct CanvasElement
+{
+  uint16_t text;      // content, datetime format or image, as an offset in the string pool
+  int16_t x, y;
+  int16_t x1, y1;
+  uint16_t color;     // fgColor for text
+  uint16_t bgColor;
+  CanvasElementType type;
+  uint8_t font;       // id in the FontRegistry
+};
+
+// Frames of one entry of "sprites". The frames of an animation all point to its GIF or APNG
+struct CanvasSpriteFrames
+{
+  uint16_t firstFrame;
+  uint8_t count;
+  uint8_t width, height;
+  bool animation;
+};
+
+// One sprite of "loop" with its timing resolved. Its movement is a path in keyframes,
+// started from wherever the sprite is every moveStartTime ms
+struct CanvasSpriteInstance
+{
+  uint32_t loopDelay;
+  uint32_t frameDelay;
+  uint32_t moveStartTime;
+  uint16_t firstKeyframe;
+  uint8_t keyframeCount;
+  uint8_t sprite;
+  int8_t x, y;
+};
+
+class CanvasProgram;
+
+// Sees the canvas while it is compiled, so the first screen can be drawn before the
+// sprites (usually most of the bytes) arrived
+class CanvasListener
+{
+public:
+  virtual void onStart() {}
+  virtual void onBackground(uint16_t color) {}
+  virtual void onElement(const CanvasProgram &program, const CanvasElement &element) {}
+};
+
+// A canvas definition compiled into plain arrays straight from the JSON stream, so no
+// document is ever built and drawing a frame needs no key lookups or string compares.
+// Strings (texts, formats, base64 images) are copied into a single pool as they are read;
+// only the pool grows with the canvas, parsing itself needs a few bytes.
+// A program loaded from a bundle has its images already decoded: they are bitmaps in the
+// bundle's atlas instead of base64 strings.
+class CanvasProgram : public StagedCanvas
+{
+private:
+  // Raw loop entry, timing is resolved once the whole loop was read
+  struct LoopEntry
+  {
+    uint32_t loopDelay, frameDelay, moveStartTime, moveDuration;
+    uint8_t sprite;
+    int8_t x, y;
+    int8_t moveTargetX, moveTargetY;
+    bool returnToOrigin;
+    bool isSprite;
+    uint16_t firstKeyframe;   // "path", already in keyframes
+    uint8_t keyframeCount;
+  };
+
+  std::vector<char> _strings;
+  std::vector<uint16_t> _frames;   // string offset, or bitmap index when bundled
+  std::vector<uint16_t> _frameDelays;   // ms, 0 to use the instance's frameDelay
+  bool _bundled = false;
+
+  bool readText(JsonStreamReader &json, uint16_t &offset);
+  bool readElement(JsonStreamReader &json, FontRegistry &fonts, CanvasListener *listener);
+  bool readFonts(JsonStreamReader &json, FontRegistry &fonts);
+  bool readSprites(JsonStreamReader &json);
+  bool readAnimation(JsonStreamReader &json, CanvasSpriteFrames &sprite);
+  bool readPath(JsonStreamReader &json, LoopEntry &entry);
+  bool readLoop(JsonStreamReader &json, std::vector<LoopEntry> &loop);
+  void resolveLoop(const std::vector<LoopEntry> &loop);
+
+public:
+  std::vector<CanvasElement> elements;
+  std::vector<CanvasSpriteFrames> sprites;
+  std::vector<CanvasSpriteInstance> instances;
+  std::vector<Keyframe> keyframes;
+  std::vector<uint8_t> fontPacks;      // fonts shipped in the canvas
+  std::vector<int16_t> frameHandles;   // sprite cache handle of each frame, -1 when not cached
+  std::vector<CanvasBundleBitmap> bitmaps;
+  uint32_t atlasStart = 0;             // file offset of the bundle's atlas
+
+  uint16_t bgColor = 0;
+  uint16_t delay = 0;
+  uint16_t version = 0;
+  uint16_t name = 0;
+  uint16_t author = 0;
+
+  // size is only a hint to allocate the string pool once, -1 when unknown
+  bool compile(Stream &input, int32_t size, FontRegistry &fonts, CanvasListener *listener, String &error);
+  // Reads everything but the atlas of a bundle, which stays in the file
+  bool load(Stream &bundle, int32_t size, FontRegistry &fonts, String &error);
+  // Loads the fonts of the text that are neither built in nor shipped in the canvas, on the
+  // task that compiled it, so drawing never waits for the file system
+  void requireFonts(FontRegistry &fonts) const;
+  void clear();
+
+  bool bundled() const { return _bundled; }
+
+  const char *text(uint16_t offset) const { return &_strings[offset]; }
+  const char *frame(const CanvasSpriteInstance &instance, uint8_t index) const { return text(_frames[sprites[instance.sprite].firstFrame + index]); }
+  const char *frame(uint16_t index) const { return text(_frames[index]); }
+  uint32_t frameDelay(const CanvasSpriteInstance &instance, uint8_t index) const
+  {
+    uint16_t delay = _frameDelays[sprites[instance.sprite].firstFrame + index];
+    return (delay > 0 ? delay : instance.frameDelay);
+  }
+  uint16_t frameDelay(uint16_t index) const { return _frameDelays[index]; }
+  const uint16_t *frameDelays(const CanvasSpriteInstance &instance) const { return &_frameDelays[sprites[instance.sprite].firstFrame]; }
+  // Frames of the animation starting at index, 0 when the frame is an image of its own
+  uint8_t animationFrames(uint16_t index) const;
+  const Keyframe *path(const CanvasSpriteInstance &instance) const { return &keyframes[instance.firstKeyframe]; }
+  int16_t frameHandle(const CanvasSpriteInstance &instance, uint8_t index) const { return frameHandles[sprites[instance.sprite].firstFrame + index]; }
+  const CanvasBundleBitmap &frameBitmap(uint16_t index) const { return bitmaps[_frames[index]]; }
+  const CanvasBundleBitmap &frameBitmap(const CanvasSpriteInstance &instance, uint8_t index) const { return frameBitmap(sprites[instance.sprite].firstFrame + index); }
+  const CanvasBundleBitmap &imageBitmap(const CanvasElement &element) const { return bitmaps[element.text]; }
+  size_t memoryUsage() const override;
+};
+
+// Compiles a canvas while the store reads it from a download or a file
+class CanvasCompiler : public CanvasParser
+{
+private:
+  CanvasProgram &_program;
+  FontRegistry &_fonts;
+  CanvasListener *_listener;
+
+public:
+  CanvasCompiler(CanvasProgram &program, FontRegistry &fonts, CanvasListener *listener = nullptr)
+      : _program(program), _fonts(fonts), _listener(listener) {}
+
+  bool parse(Stream &input, int32_t size, String &error) override
+  {
+    return _program.compile(input, size, _fonts, _listener, error);
+  }
+};
+
+// Loads a bundle through the store
+class CanvasBundleReader : public CanvasParser
+{
+private:
+  CanvasProgram &_program;
+  FontRegistry &_fonts;
+
+public:
+  CanvasBundleReader(CanvasProgram &program, FontRegistry &fonts) : _program(program), _fonts(fonts) {}
+
+  bool parse(Stream &input, int32_t size, String &error) override
+  {
+    return _program.load(input, size, _fonts, error);
+  }
+};
+
+// Loads a font pack stored on flash through the store
+class FontPackReader : public CanvasParser
+{
+private:
+  FontRegistry &_fonts;
+  const char *_name;
+
+public:
+  FontPackReader(FontRegistry &fonts, const char *name) : _fonts(fonts), _name(name) {}
+
+  bool parse(Stream &input, int32_t size, String &error) override
+  {
+    return _fonts.load(_name, input, size, error);
+  }
+};
@@ -0,0 +1,215 @@
+#include "CanvasRenderer.h"
+#include <PNGRender.h>
+
+TimeCadence CanvasRenderer::cadence(const char *format)
+{
+  TimeCadence cadence = CADENCE_DAY;
+
+  for (const char *c = format; *c; c++)
+  {
+    if (*c == '~' || *c == '\\') {
+      if (*++c == 0)
+        break;
+    } else if (isalpha(*c) && strchr("dDjlNSwzWFmMntLoYy", *c) == nullptr) {
+      if (strchr("aAgGhHiTeOPZ", *c) == nullptr)
+        return CADENCE_SECOND;
+      cadence = CADENCE_MINUTE;
+    }
+  }
+  return cadence;
+}
+
+uint16_t CanvasRenderer::cacheFrames(SpriteCache &cache, CanvasProgram &source, uint16_t index)
+{
+  uint8_t animated = source.animationFrames(index);
+  if (animated > 0) {
+    cacheAnimation(cache, source.frame(index), &source.frameHandles[index], animated);
+    return animated;
+  }
+
+  source.frameHandles[index] = cacheImage(cache, source.frame(index));
+  return 1;
+}
+
+void CanvasRenderer::show(CanvasProgram &program, SpriteCache &cache, bool backgroundPainted, uint16_t painted)
+{
+  _program = &program;
+  _cache = &cache;
+
+  // Clear screen, unless it was already drawn while the canvas was read
+  if (!backgroundPainted) {
+    _display->fillRect(0, 0, 64, 64, program.bgColor);
+    painted = 0;
+  }
+
+  // Draw static elements, Date/Time is drawn once by refreshDateTime
+  for (size_t i = painted; i < program.elements.size(); i++)
+  {
+    renderElement(program, program.elements[i]);
+  }
+
+  resetDateTimes();
+  refreshDateTime();
+
+  createSprites();
+}
+
+void CanvasRenderer::renderElement(const CanvasProgram &source, const CanvasElement &element)
+{
+  switch (element.type)
+  {
+  case ELEMENT_TEXT:
+    renderText(source.text(element.text), element);
+    break;
+  case ELEMENT_FILLRECT:
+    _display->fillRect(element.x, element.y, element.x1, element.y1, element.color);
+    break;
+  case ELEMENT_RECT:
+    _display->drawRect(element.x, element.y, element.x1, element.y1, element.color);
+    break;
+  case ELEMENT_LINE:
+    _display->drawLine(element.x, element.y, element.x1, element.y1, element.color);
+    break;
+  case ELEMENT_IMAGE:
+    if (source.bundled())
+      drawBitmap(source.imageBitmap(element), element.x, element.y);
+    else
+      renderImage(source.text(element.text), element.x, element.y);
+    break;
+  case ELEMENT_DATETIME:
+    break;
+  }
+}
+
+void CanvasRenderer::renderText(const char *text, const CanvasElement &element)
+{
+  const GFXfont *font = Locator::getFontRegistry()->get(element.font);
+  int16_t x1, y1;
+  uint16_t w, h;
+
+  Locator::getGlyphCache()->getTextBounds(_display, font, text, element.x, element.y, &x1, &y1, &w, &h);
+
+  // BG Color
+  _display->fillRect(
+      x1,
+      y1,
+      w + 4, //Problems with large fonts; when changing from the number 0 to the number 1, it remained blurry. I added 4 for major clean
+      h,
+      element.bgColor);
+
+  Locator::getGlyphCache()->print(_display, font, text, element.x, element.y, element.color);
+}
+
+void CanvasRenderer::resetDateTimes()
+{
+  _dateTimes.clear();
+
+  for (uint16_t i = 0; i < _program->elements.size(); i++)
+  {
+    const CanvasElement &element = _program->elements[i];
+    if (element.type == ELEMENT_DATETIME)
+      _dateTimes.push_back({i, cadence(_program->text(element.text)), -1, "", 0, 0, 0, 0, true});
+  }
+}
+
+void CanvasRenderer::refreshDateTime()
+{
+  if (_dateTimes.empty())
+    return;
+
+  int16_t minute = _clock->minuteOfDay();
+  int16_t day = _clock->day();
+
+  for (DateTimeText &shown : _dateTimes)
+  {
+    const CanvasElement &element = _program->elements[shown.element];
+    int16_t stamp = (shown.cadence == CADENCE_DAY ? day : minute);
+
+    if (shown.cadence != CADENCE_SECOND && stamp == shown.stamp && !shown.dirty)
+      continue;
+    shown.stamp = stamp;
+
+    String text = _clock->format(_program->text(element.text));
+    if (text == shown.text && !shown.dirty)
+      continue;
+
+    const GFXfont *font = Locator::getFontRegistry()->get(element.font);
+
+    if (shown.dirty || text.indexOf('\n') >= 0 || shown.text.indexOf('\n') >= 0) {
+      _display->fillRect(shown.x1, shown.y1, shown.w, shown.h, element.bgColor);
+      renderText(text.c_str(), element);
+    } else
+      Locator::getGlyphCache()->reprint(_display, font, shown.text.c_str(), text.c_str(), element.x, element.y, element.color, element.bgColor);
+
+    shown.text = text;
+    shown.dirty = false;
+    Locator::getGlyphCache()->getTextBounds(_display, font, text.c_str(), element.x, element.y, &shown.x1, &shown.y1, &shown.w, &shown.h);
+  }
+}
+
+// Something else was drawn over these pixels, the times there are drawn again next tick
+void CanvasRenderer::invalidateDateTimes(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  for (DateTimeText &shown : _dateTimes)
+  {
+    if (x < shown.x1 + (int16_t)shown.w && shown.x1 < x + w && y < shown.y1 + (int16_t)shown.h && shown.y1 < y + h)
+      shown.dirty = true;
+  }
+}
+
+void CanvasRenderer::createSprites()
+{
+  _animations.clear();
+
+  for (const CanvasSpriteInstance &instance : _program->instances)
+  {
+    const CanvasSpriteFrames &frames = _program->sprites[instance.sprite];
+    _animations.push_back({frames.count, instance.frameDelay, _program->frameDelays(instance), instance.loopDelay,
+                           _program->path(instance), instance.keyframeCount, instance.moveStartTime});
+  }
+
+  _animator.begin(_animations.data(), this);
+
+  for (const CanvasSpriteInstance &instance : _program->instances)
+  {
+    CanvasSpriteFrames &frames = _program->sprites[instance.sprite];
+    if (frames.width == 0 && !_cache->getDimensions(_program->frameHandle(instance, 0), frames.width, frames.height))
+      getImageDimensions(_program->frame(instance, 0), frames.width, frames.height);
+
+    _animator.add(_animator.size(), instance.x, instance.y, frames.width, frames.height);
+  }
+}
+
+void CanvasRenderer::animate(unsigned long now)
+{
+  if (_animator.empty())
+    return;
+
+  _animator.update(now, _clock->second());
+}
+
+// From the cache, or read from the bundle / decoded again when it did not fit
+void CanvasRenderer::drawFrame(const CanvasSpriteInstance &instance, uint8_t frame, int16_t x, int16_t y)
+{
+  if (_cache->draw(_program->frameHandle(instance, frame), _display, x, y, true))
+    return;
+
+  if (_program->bundled())
+    drawBitmap(_program->frameBitmap(instance, frame), x, y, true);
+  else if (_program->sprites[instance.sprite].animation)
+    renderAnimationFrame(_program->frame(instance, frame), frame, x, y);
+  else
+    renderImage(_program->frame(instance, frame), x, y, true);
+}
+
+void CanvasRenderer::eraseSprite(int16_t x, int16_t y, int16_t width, int16_t height)
+{
+  _display->fillRect(x, y, width, height, _program->bgColor);
+  invalidateDateTimes(x, y, width, height);
+}
+
+// Sprites were added in the order of the program's instances
+void CanvasRenderer::drawSprite(uint16_t sprite, uint8_t frame, int16_t x, int16_t y)
+{
+  drawFrame(_program->instances[sprite], frame, x, y);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <vector>
+#include <Locator.h>
+#include <SpriteCache.h>
+#include <SpriteAnimator.h>
+#include "CanvasProgram.h"
+
+// How often the text of a format changes
+enum TimeCadence : uint8_t
+{
+  CADENCE_SECOND,
+  CADENCE_MINUTE,
+  CADENCE_DAY
+};
+
+// The time a canvas is drawn with: CWDateTime on the panel, a simulated clock in the bench
+class CanvasClock
+{
+public:
+  // format uses the letters of ezTime's dateTime()
+  virtual String format(const char *format) = 0;
+  virtual int16_t minuteOfDay() = 0;
+  virtual int16_t day() = 0;
+  virtual uint8_t second() = 0;
+};
+
+// Draws a compiled canvas: the setup elements, the date/times that changed once a second
+// and the sprites of the loop, from the frames in a SpriteCache. Bitmaps of a bundled
+// program are left to drawBitmap(), only the clockface has the bundle's file.
+class CanvasRenderer : public SpriteRenderer
+{
+private:
+  // A datetime element and the text it shows, formatted again once per cadence
+  struct DateTimeText
+  {
+    uint16_t element;
+    TimeCadence cadence;
+    int16_t stamp;     // minute of the day or day it was last formatted in
+    String text;
+    int16_t x1, y1;    // bounds of text
+    uint16_t w, h;
+    bool dirty;        // drawn over, or never drawn: cleared and drawn from scratch
+  };
+
+  std::vector<DateTimeText> _dateTimes;
+
+  // One row per instance of the program, sprites are added in the same order
+  std::vector<SpriteAnimation> _animations;
+  SpriteAnimator _animator;
+
+  void renderText(const char *text, const CanvasElement &element);
+  void resetDateTimes();
+  void invalidateDateTimes(int16_t x, int16_t y, int16_t w, int16_t h);
+  void createSprites();
+  void drawFrame(const CanvasSpriteInstance &instance, uint8_t frame, int16_t x, int16_t y);
+
+protected:
+  Adafruit_GFX *_display;
+  CanvasClock *_clock;
+  CanvasProgram *_program = nullptr;
+  SpriteCache *_cache = nullptr;
+
+  // A bitmap of the bundle's atlas, nothing is drawn without a bundle
+  virtual void drawBitmap(const CanvasBundleBitmap &bitmap, int16_t x, int16_t y, bool masked = false) {}
+
+public:
+  CanvasRenderer(Adafruit_GFX *display, CanvasClock *clock) : _display(display), _clock(clock) {}
+
+  // Letters ezTime replaces with a date, or with the hour / minute (and the timezone, which
+  // only changes with them). Anything else, seconds included, may change every second
+  static TimeCadence cadence(const char *format);
+  // Decodes the frame at index of a program compiled from JSON, or all the frames of the
+  // animation it starts, into the cache. Returns how many it took
+  static uint16_t cacheFrames(SpriteCache &cache, CanvasProgram &source, uint16_t index);
+
+  // Draws program and starts its sprites. When the background and the first painted
+  // elements are on the display already (drawn while the canvas was read), only the rest is
+  void show(CanvasProgram &program, SpriteCache &cache, bool backgroundPainted = false, uint16_t painted = 0);
+  // Date/time elements are only drawn by refreshDateTime(), which knows the bounds to clear
+  void renderElement(const CanvasProgram &source, const CanvasElement &element);
+  // Once a second: only the elements whose cadence came around are formatted, and only the
+  // characters that changed since the last time are drawn again
+  void refreshDateTime();
+  // Plays the sprites, as often as possible
+  void animate(unsigned long now);
+
+  void eraseSprite(int16_t x, int16_t y, int16_t width, int16_t height) override;
+  void drawSprite(uint16_t sprite, uint8_t frame, int16_t x, int16_t y) override;
+};
@@ -4,7 +4,6 @@
 
 #include <Adafruit_GFX.h>
 #include <Locator.h>
-#include <ArduinoJson.h>
 #include <vector>
 #include <CWPreferences.h>
 #include <StatusController.h>
@@ -17,9 +16,11 @@
 #include "fonts/hour8pt7b.h"
 #include "fonts/minute7pt7b.h"
 #include "fonts/cartographer3pt7b.h"
-#include "PNGRender.h"
-#include "CustomSprite.h"
+#include "CanvasProgram.h"
+#include "CanvasRenderer.h"
 #include "CWHttpClient.h"
+#include <CWCanvasStore.h>
+#include <CWCanvasRefresh.h>
 
 #define CLOCKFACE_NAME "cw-cf-0x07"
 
@@ -34,29 +35,56 @@ const uint8_t CW_ICON_CANVAS[] PROGMEM = {
 	0x3f, 0xff, 0xff, 0x80, 0x3c, 0x1f, 0x07, 0x80, 0x3c, 0x1f, 0x07, 0x80, 0x18, 0x0e, 0x03, 0x00
 };
 
-class Clockface : public IClockface
+// CWDateTime as the clock canvases are drawn with
+class DateTimeClock : public CanvasClock
+{
+public:
+  CWDateTime *dateTime = nullptr;
+
+  String format(const char *format) override { return dateTime->getFormattedTime(format); }
+  int16_t minuteOfDay() override { return dateTime->getHour() * 60 + dateTime->getMinute(); }
+  int16_t day() override { return dateTime->getDay(); }
+  uint8_t second() override { return dateTime->getSecond(); }
+};
+
+class Clockface : public IClockface, public CanvasListener, public CanvasRenderer
 {
 private:
-  Adafruit_GFX *_display;
   CWDateTime *_dateTime;
+  DateTimeClock _clock;
   uint16_t delay;
 
-  void setFont(const char *fontName);
-  bool deserializeDefinition();
+  // What was already drawn while the canvas was being read
+  bool _backgroundPainted = false;
+  uint16_t _elementsRead = 0;
+  uint16_t _elementsPainted = 0;
+
+  static bool loadFontPack(const char *name);
+  static StagedCanvas *stageCanvas(const String &name);
+  static bool loadBundle(const String &name, CanvasProgram &compiled);
+  bool loadDefinition(CanvasProgram &compiled);
+  void openBundle();
+  void checkPlaylist();
+  void readyStandby();
+  void prepareStandby(CanvasProgram *canvas);
+  void dropStandby();
+  void rotate();
+  static size_t cacheBudget(const CanvasProgram &source);
+  int16_t cacheBitmap(SpriteCache &cache, File &file, const CanvasProgram &source, const CanvasBundleBitmap &bitmap);
+  uint16_t cacheFrames(SpriteCache &cache, File &file, CanvasProgram &source, uint16_t index);
   void clockfaceSetup();
-  void clockfaceLoop();
-  void renderElements(JsonArrayConst elements);
-  void renderText(String text, JsonVariantConst value);
-  void createSprites();
-  void refreshDateTime();
+  void cacheSpriteFrames();
   void drawSplashScreen(uint16_t color, const char *msg);
-  void handleSpriteAnimation(std::shared_ptr<CustomSprite> &sprite);
-  void handleSpriteMovement(std::shared_ptr<CustomSprite> &sprite);
 
-  std::vector<std::shared_ptr<CustomSprite>> sprites;
+protected:
+  void drawBitmap(const CanvasBundleBitmap &bitmap, int16_t x, int16_t y, bool masked = false) override;
 
 public:
   Clockface(Adafruit_GFX *display);
   void setup(CWDateTime *dateTime);
   void update();
+
+  void onStart() override;
+  void onBackground(uint16_t color) override;
+  void onElement(const CanvasProgram &source, const CanvasElement &element) override;
 };
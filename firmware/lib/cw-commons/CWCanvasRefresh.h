@@ -0,0 +1,262 @@
+#pragma once
+
+#include <Arduino.h>
+#include "CWPreferences.h"
+#include "CWCanvasStore.h"
+#include <atomic>
+
+#define CW_CANVAS_REFRESH_STACK 8192
+
+// Most one canvas may take once built, sprite frames included. With a playlist the next
+// canvas is held next to the current one, so two of these are the whole canvas memory
+#ifndef CW_CANVAS_SLOT_BUDGET
+  #define CW_CANVAS_SLOT_BUDGET 49152
+#endif
+
+// Heap left to everything else (WiFi, TLS, the web server) while a canvas is preloaded
+#ifndef CW_CANVAS_HEAP_RESERVE
+  #define CW_CANVAS_HEAP_RESERVE 32768
+#endif
+
+// Keeps the current canvas up to date without a restart. A task on core 0 revalidates it
+// with the canvas server every canvasRefresh minutes, or when asked, and has the clockface's
+// stager build a new version while the old one keeps being drawn.
+// The clockface takes the staged canvas between two frames.
+// The same task preloads the next canvas of the playlist into a standby slot, which the
+// clockface takes when it is its turn.
+struct ClockwiseCanvasRefresh
+{
+  TaskHandle_t task = nullptr;
+  CanvasStager stager = nullptr;
+  std::atomic<StagedCanvas *> staged{nullptr};
+  std::atomic<StagedCanvas *> standby{nullptr};
+  SemaphoreHandle_t mutex = nullptr;
+  String current;       // canvas on screen
+  String preloading;    // canvas asked for the standby slot
+  volatile bool forceReload = false;
+  volatile bool refreshWanted = false;
+
+  static ClockwiseCanvasRefresh *getInstance()
+  {
+    static ClockwiseCanvasRefresh base;
+    return &base;
+  }
+
+  // Asks the canvas server for a newer version of the stored canvas, when there is one to ask.
+  // An uploaded canvas or bundle, or a server set to LOCAL, is left as it is.
+  static CanvasFetchResult sync(const String &name, CanvasParser *parser = nullptr)
+  {
+    ClockwiseCanvasStore *store = ClockwiseCanvasStore::getInstance();
+    String server = ClockwiseParams::getInstance()->canvasServer;
+
+    if (server.isEmpty() || server == "LOCAL" || !ClockwiseCanvasStore::isValidName(name))
+      return CANVAS_NOT_MODIFIED;
+
+    if ((store->exists(name) && !store->hasValidators(name)) || store->hasBundle(name))
+      return CANVAS_NOT_MODIFIED;
+
+    String file = String("/" + name + ".json");
+    uint16_t port = 4443;
+
+    if (server.startsWith("raw.")) {
+      port = 443;
+      file = String("/robegamesios/clock-club/main/shared" + file);
+    }
+
+    return store->fetch(name, server.c_str(), file.c_str(), port, parser);
+  }
+
+  // Guards the names, the clockface and the web server set them from other tasks
+  void lock()
+  {
+    if (mutex != nullptr)
+      xSemaphoreTake(mutex, portMAX_DELAY);
+  }
+
+  void unlock()
+  {
+    if (mutex != nullptr)
+      xSemaphoreGive(mutex);
+  }
+
+  // The canvas after current in canvasPlaylist (comma separated names), the first one when
+  // current is not in it. Empty without a playlist
+  static String next(const String &current)
+  {
+    String playlist = ClockwiseParams::getInstance()->canvasPlaylist;
+    String first, previous;
+    int start = 0;
+
+    while (start <= (int)playlist.length())
+    {
+      int end = playlist.indexOf(',', start);
+      if (end < 0)
+        end = playlist.length();
+
+      String name = playlist.substring(start, end);
+      name.trim();
+      start = end + 1;
+
+      if (!ClockwiseCanvasStore::isValidName(name))
+        continue;
+
+      if (previous == current)
+        return name;
+
+      if (first.isEmpty())
+        first = name;
+      previous = name;
+    }
+    return first;
+  }
+
+  void begin(CanvasStager canvasStager, const String &canvas)
+  {
+    stager = canvasStager;
+    if (mutex == nullptr)
+      mutex = xSemaphoreCreateMutex();
+    setCurrent(canvas);
+
+    if (task == nullptr)
+      xTaskCreatePinnedToCore(refreshTask, "cw-canvas", CW_CANVAS_REFRESH_STACK, this, 1, &task, 0);
+  }
+
+  // On demand refresh, reload also decodes the stored file when the server has nothing new
+  // (e.g. after an upload)
+  void request(bool reload = false)
+  {
+    if (reload)
+      forceReload = true;
+    refreshWanted = true;
+
+    if (task != nullptr)
+      xTaskNotifyGive(task);
+  }
+
+  // Builds name into the standby slot, replacing what was there
+  void preload(const String &name)
+  {
+    lock();
+    preloading = name;
+    unlock();
+
+    if (task != nullptr)
+      xTaskNotifyGive(task);
+  }
+
+  // The canvas refreshed from now on, once the clockface switched to it
+  void setCurrent(const String &name)
+  {
+    lock();
+    current = name;
+    unlock();
+  }
+
+  bool isCurrent(const String &name)
+  {
+    lock();
+    bool same = (current == name);
+    unlock();
+    return same;
+  }
+
+  // Called by the clockface at a frame boundary, the caller owns the returned canvas
+  StagedCanvas *take()
+  {
+    return staged.exchange(nullptr);
+  }
+
+  StagedCanvas *takeStandby()
+  {
+    return standby.exchange(nullptr);
+  }
+
+  static void refreshTask(void *param)
+  {
+    ClockwiseCanvasRefresh *refresh = (ClockwiseCanvasRefresh *)param;
+
+    while (true)
+    {
+      uint16_t minutes = ClockwiseParams::getInstance()->canvasRefresh;
+      bool timedOut = (ulTaskNotifyTake(pdTRUE, (minutes == 0 ? portMAX_DELAY : pdMS_TO_TICKS(minutes * 60000UL))) == 0);
+
+      refresh->lock();
+      String name = refresh->current;
+      String next = refresh->preloading;
+      refresh->preloading = "";
+      refresh->unlock();
+
+      if (!next.isEmpty())
+        refresh->preloadStandby(next);
+
+      // A preload alone does not revalidate the current canvas
+      if (!timedOut && !refresh->refreshWanted)
+        continue;
+
+      bool reload = refresh->forceReload;
+      refresh->forceReload = false;
+      refresh->refreshWanted = false;
+
+      if (sync(name) == CANVAS_UPDATED || reload)
+        refresh->stage(name);
+    }
+  }
+
+  // Downloaded first when it is not stored yet, like the canvas the clock starts with
+  void preloadStandby(const String &name)
+  {
+    ClockwiseCanvasStore *store = ClockwiseCanvasStore::getInstance();
+    sync(name);
+
+    if (!store->exists(name) && !store->hasBundle(name)) {
+      Serial.printf("[Canvas] Playlist canvas '%s' not found\n", name.c_str());
+      return;
+    }
+
+    // The previous standby is dropped before the next one is built, both never coexist
+    delete standby.exchange(nullptr);
+
+    if (ESP.getFreeHeap() < CW_CANVAS_SLOT_BUDGET + CW_CANVAS_HEAP_RESERVE) {
+      Serial.printf("[Canvas] Not enough heap to preload '%s' (%u bytes free)\n", name.c_str(), ESP.getFreeHeap());
+      return;
+    }
+
+    unsigned long start = millis();
+    StagedCanvas *canvas = stager(name);
+    if (canvas == nullptr)
+      return;
+
+    if (canvas->memoryUsage() > CW_CANVAS_SLOT_BUDGET) {
+      Serial.printf("[Canvas] '%s' needs %u bytes, over the %u of a canvas slot\n", name.c_str(), canvas->memoryUsage(), CW_CANVAS_SLOT_BUDGET);
+      delete canvas;
+      return;
+    }
+
+    canvas->file = name;
+    Serial.printf("[Canvas] Preloaded '%s' in %lums\n", name.c_str(), millis() - start);
+    delete standby.exchange(canvas);
+  }
+
+  void stage(const String &name)
+  {
+    ClockwiseCanvasStore *store = ClockwiseCanvasStore::getInstance();
+    if (!store->exists(name) && !store->hasBundle(name))
+      return;
+
+    if (ESP.getFreeHeap() < CW_CANVAS_SLOT_BUDGET + CW_CANVAS_HEAP_RESERVE) {
+      Serial.printf("[Canvas] Not enough heap to stage '%s' (%u bytes free), trying on the next refresh\n", name.c_str(), ESP.getFreeHeap());
+      return;
+    }
+
+    unsigned long start = millis();
+    StagedCanvas *canvas = stager(name);
+    if (canvas == nullptr)
+      return;
+
+    canvas->file = name;
+    Serial.printf("[Canvas] Staged '%s' in %lums\n", name.c_str(), millis() - start);
+
+    // A version nobody took yet is simply replaced
+    delete staged.exchange(canvas);
+  }
+};
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include "CWHttpClient.h"
+#include "CWCanvasTypes.h"
+#include "CWJsonReader.h"
+
+#ifndef CW_CANVAS_MAX_SIZE
+  #define CW_CANVAS_MAX_SIZE 32768
+#endif
+
+#define CW_CANVAS_NAME_MAX 24
+#define CW_CANVAS_CHUNK_SIZE 512
+
+enum CanvasFetchResult
+{
+  CANVAS_UPDATED,
+  CANVAS_NOT_MODIFIED,
+  CANVAS_FETCH_FAILED
+};
+
+// Hands the bytes of a source stream to the JSON parser while copying them to a file,
+// one chunk at a time, so an upload is validated and stored in a single pass.
+class CanvasTeeStream : public Stream
+{
+private:
+  Stream *_source;
+  File *_target;
+  int32_t _remaining;
+  int32_t _maxSize;
+  uint8_t _buffer[CW_CANVAS_CHUNK_SIZE];
+  uint16_t _length = 0;
+  uint16_t _position = 0;
+  int32_t _total = 0;
+  bool _failed = false;
+  bool _tooLarge = false;
+
+  bool fill()
+  {
+    if (_position < _length)
+      return true;
+
+    if (_remaining == 0 || _failed)
+      return false;
+
+    // A negative size reads until the source ends, still bounded by the max canvas size
+    int32_t wanted = (_remaining > 0 ? min((int32_t)sizeof(_buffer), _remaining) : (int32_t)sizeof(_buffer));
+    _length = _source->readBytes(_buffer, wanted);
+    _position = 0;
+
+    if (_remaining > 0)
+      _remaining -= _length;
+    else if (_length == 0)
+      _remaining = 0;
+
+    _total += _length;
+    if (_total > _maxSize)
+      _tooLarge = true;
+
+    if ((_length == 0 && _remaining != 0) || _tooLarge || _target->write(_buffer, _length) != _length)
+    {
+      _failed = true;
+      return false;
+    }
+
+    return _length > 0;
+  }
+
+public:
+  CanvasTeeStream(Stream *source, File *target, int32_t size, int32_t maxSize = CW_CANVAS_MAX_SIZE) : _source(source), _target(target), _remaining(size), _maxSize(maxSize) {}
+
+  int available() override { return (_length - _position) + max(_remaining, (int32_t)0); }
+  int read() override { return fill() ? _buffer[_position++] : -1; }
+  int peek() override { return fill() ? _buffer[_position] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+  // Copies what the parser did not consume (trailing whitespace) and reports if everything arrived
+  bool finish()
+  {
+    while (fill())
+      _position = _length;
+
+    return !_failed && _remaining == 0;
+  }
+
+  bool tooLarge() { return _tooLarge; }
+  int32_t total() { return _total; }
+};
+
+// Canvas definitions stored in LittleFS as /<name>.json, the same layout as the data folder,
+// so they can also be flashed with 'pio run -t uploadfs'. A precompiled bundle of the same
+// canvas, /<name>.cwb, is used instead of the JSON when present.
+struct ClockwiseCanvasStore
+{
+  bool mounted = false;
+  SemaphoreHandle_t mutex = nullptr;
+
+  static ClockwiseCanvasStore *getInstance()
+  {
+    static ClockwiseCanvasStore base;
+    return &base;
+  }
+
+  void begin()
+  {
+    mutex = xSemaphoreCreateMutex();
+    mounted = LittleFS.begin(true);
+    if (mounted)
+      Serial.printf("[Canvas] LittleFS mounted, %u of %u bytes used\n", LittleFS.usedBytes(), LittleFS.totalBytes());
+    else
+      Serial.println("[Canvas] Failed to mount LittleFS");
+  }
+
+  // Held while a stored file is read or replaced, uploads and the background refresh run on
+  // different tasks. Bodies are received into a temporary file without it, so a slow network
+  // never keeps the other task waiting.
+  void lock()
+  {
+    if (mutex != nullptr)
+      xSemaphoreTake(mutex, portMAX_DELAY);
+  }
+
+  void unlock()
+  {
+    if (mutex != nullptr)
+      xSemaphoreGive(mutex);
+  }
+
+  static bool isValidName(const String &name)
+  {
+    if (name.isEmpty() || name.length() > CW_CANVAS_NAME_MAX)
+      return false;
+
+    for (size_t i = 0; i < name.length(); i++)
+    {
+      char c = name.charAt(i);
+      if (!isalnum(c) && c != '-' && c != '_')
+        return false;
+    }
+    return true;
+  }
+
+  static String path(const String &name)
+  {
+    return "/" + name + ".json";
+  }
+
+  static String metaPath(const String &name)
+  {
+    return "/" + name + ".meta";
+  }
+
+  static String bundlePath(const String &name)
+  {
+    return "/" + name + ".cwb";
+  }
+
+  static String fontPath(const String &name)
+  {
+    return "/fonts/" + name + ".cwf";
+  }
+
+  bool exists(const String &name)
+  {
+    return mounted && isValidName(name) && LittleFS.exists(path(name));
+  }
+
+  bool hasBundle(const String &name)
+  {
+    return mounted && isValidName(name) && LittleFS.exists(bundlePath(name));
+  }
+
+  bool hasFont(const String &name)
+  {
+    return mounted && isValidName(name) && LittleFS.exists(fontPath(name));
+  }
+
+  File open(const String &name)
+  {
+    return LittleFS.open(path(name), FILE_READ);
+  }
+
+  File openBundle(const String &name)
+  {
+    return LittleFS.open(bundlePath(name), FILE_READ);
+  }
+
+  bool load(const String &name, CanvasParser &parser, String &error)
+  {
+    return parseFile(path(name), parser, error);
+  }
+
+  bool loadBundle(const String &name, CanvasParser &parser, String &error)
+  {
+    return parseFile(bundlePath(name), parser, error);
+  }
+
+  bool loadFont(const String &name, CanvasParser &parser, String &error)
+  {
+    return parseFile(fontPath(name), parser, error);
+  }
+
+  bool parseFile(const String &filePath, CanvasParser &parser, String &error)
+  {
+    lock();
+    File file = LittleFS.open(filePath, FILE_READ);
+    bool parsed = (file && parser.parse(file, file.size(), error));
+    if (!file)
+      error = "File not found";
+    file.close();
+    unlock();
+    return parsed;
+  }
+
+  // Streams an upload into the file system, parsing it as it arrives. The previous file
+  // is only replaced once the whole body was received and is a valid canvas.
+  // Returns an HTTP status code, error is filled for 4xx/5xx.
+  uint16_t receive(Stream &client, const String &name, int32_t contentLength, String &error, bool bundle = false)
+  {
+    if (!mounted) {
+      error = "File system not available";
+      return 503;
+    }
+
+    if (!isValidName(name)) {
+      error = "Invalid canvas name";
+      return 400;
+    }
+
+    if (contentLength <= 0) {
+      error = "Content-Length required";
+      return 411;
+    }
+
+    return store(client, name, contentLength, error, nullptr, bundle);
+  }
+
+  // Same as receive(), a negative length reads the stream until it ends.
+  // A parser, when given, reads the canvas as it arrives instead of a plain syntax check.
+  // A download gives its response, whose validators are written along with the file.
+  uint16_t store(Stream &client, const String &name, int32_t contentLength, String &error, CanvasParser *parser = nullptr, bool bundle = false,
+                 const HttpResponse *response = nullptr)
+  {
+    String finalPath = (bundle ? bundlePath(name) : path(name));
+    int32_t maxSize = (bundle ? CW_CANVAS_BUNDLE_MAX_SIZE : CW_CANVAS_MAX_SIZE);
+
+    if (contentLength > maxSize) {
+      error = "Canvas too large";
+      return 413;
+    }
+
+    size_t existing = (LittleFS.exists(finalPath) ? LittleFS.open(finalPath, FILE_READ).size() : 0);
+    if (contentLength > 0 && (size_t)contentLength > LittleFS.totalBytes() - LittleFS.usedBytes() + existing) {
+      error = "Not enough space";
+      return 507;
+    }
+
+    unsigned long start = millis();
+    // Uploads and downloads each have their own, they are received at the same time
+    String tmpPath = "/" + name + (response != nullptr ? ".dl" : ".tmp");
+    File file = LittleFS.open(tmpPath, FILE_WRITE);
+    if (!file) {
+      error = "Could not create file";
+      return 500;
+    }
+
+    CanvasTeeStream tee(&client, &file, contentLength, maxSize);
+    String parseError;
+    bool parsed = (parser != nullptr ? parser->parse(tee, contentLength, parseError) : bundle ? validateBundle(tee, parseError) : validate(tee, parseError));
+    bool complete = tee.finish();
+    file.close();
+
+    if (tee.tooLarge()) {
+      LittleFS.remove(tmpPath);
+      error = "Canvas too large";
+      return 413;
+    }
+
+    if (!parsed || !complete)
+    {
+      LittleFS.remove(tmpPath);
+      error = (!complete ? "Incomplete upload" : parseError);
+      return 400;
+    }
+
+    lock();
+    bool committed = commit(tmpPath, finalPath);
+
+    // Validators of a previous download no longer describe this file, and a bundle of
+    // an older version would hide it
+    if (committed && !bundle) {
+      LittleFS.remove(metaPath(name));
+      LittleFS.remove(bundlePath(name));
+      if (response != nullptr)
+        writeValidators(name, *response);
+    }
+    unlock();
+
+    if (!committed) {
+      LittleFS.remove(tmpPath);
+      error = "Could not write file";
+      return 500;
+    }
+
+    Serial.printf("[Canvas] Stored '%s' as %s (%d bytes) in %lums\n", name.c_str(), finalPath.c_str(), tee.total(), millis() - start);
+    return 201;
+  }
+
+  // Streamed, so a canvas of any size is checked with a few bytes of state: only "name" and
+  // "setup" are looked at, the rest is just checked for syntax
+  static bool validate(Stream &input, String &error)
+  {
+    JsonStreamReader json(input);
+    char key[8];
+    bool hasName = false;
+    bool hasSetup = false;
+
+    json.beginObject();
+    while (json.nextMember(key, sizeof(key)))
+    {
+      int type = json.peek();
+
+      if (strcmp(key, "name") == 0 && type == '"')
+        hasName = json.readString((Print *)nullptr);
+      else if (strcmp(key, "setup") == 0 && type == '[')
+        hasSetup = json.skipValue();
+      else
+        json.skipValue();
+    }
+
+    if (json.failed())
+      error = "Invalid JSON";
+    else if (!hasName || !hasSetup)
+      error = "Not a canvas definition";
+
+    return error.isEmpty();
+  }
+
+  // Only the magic is checked here, the loader checks the rest of the layout
+  static bool validateBundle(Stream &input, String &error)
+  {
+    uint32_t magic = 0;
+    if (input.readBytes((uint8_t *)&magic, sizeof(magic)) != sizeof(magic) || magic != CW_CANVAS_BUNDLE_MAGIC)
+      error = "Not a canvas bundle";
+
+    return error.isEmpty();
+  }
+
+  // Only copies downloaded from a server that sent an ETag or Last-Modified have one
+  bool hasValidators(const String &name)
+  {
+    return exists(name) && LittleFS.exists(metaPath(name));
+  }
+
+  // ETag and Last-Modified of the stored copy, one per line in /<name>.meta
+  HttpValidators readValidators(const String &name)
+  {
+    HttpValidators validators;
+    if (!hasValidators(name))
+      return validators;
+
+    File file = LittleFS.open(metaPath(name), FILE_READ);
+    validators.etag = file.readStringUntil('\n');
+    validators.lastModified = file.readStringUntil('\n');
+    file.close();
+    return validators;
+  }
+
+  void writeValidators(const String &name, const HttpResponse &response)
+  {
+    if (response.etag.isEmpty() && response.lastModified.isEmpty())
+      return;
+
+    File file = LittleFS.open(metaPath(name), FILE_WRITE);
+    file.printf("%s\n%s\n", response.etag.c_str(), response.lastModified.c_str());
+    file.close();
+  }
+
+  // Downloads a canvas from the canvas server, asking only for changes to the stored copy.
+  // The parser, if any, sees a new version while it downloads; on a 304 it is not called.
+  CanvasFetchResult fetch(const String &name, const char *host, const char *remotePath, uint16_t port, CanvasParser *parser = nullptr)
+  {
+    if (!mounted || !isValidName(name))
+      return CANVAS_FETCH_FAILED;
+
+    return download(name, host, remotePath, port, parser);
+  }
+
+  // The store is only locked to read the validators and to commit the file, not while
+  // the network is used
+  CanvasFetchResult download(const String &name, const char *host, const char *remotePath, uint16_t port, CanvasParser *parser)
+  {
+    ClockwiseHttpClient *http = ClockwiseHttpClient::getInstance();
+
+    lock();
+    HttpValidators validators = readValidators(name);
+    unlock();
+
+    HttpResponse response = http->get(host, remotePath, port, &validators);
+
+    if (response.status == 304) {
+      http->end();
+      Serial.printf("[Canvas] '%s' not modified, using the stored copy\n", name.c_str());
+      return CANVAS_NOT_MODIFIED;
+    }
+
+    if (response.status != 200) {
+      http->end();
+      return CANVAS_FETCH_FAILED;
+    }
+
+    String error;
+    // Content-Length or chunked, the body stream ends exactly where the canvas does
+    uint16_t status = store(http->body, name, response.contentLength, error, parser, false, &response);
+    http->end();
+
+    if (status != 201) {
+      Serial.printf("[Canvas] Download of '%s' failed: %s\n", name.c_str(), error.c_str());
+      return CANVAS_FETCH_FAILED;
+    }
+
+    return CANVAS_UPDATED;
+  }
+
+  // LittleFS replaces the destination atomically, a reset leaves either version in place
+  bool commit(const String &tmpPath, const String &finalPath)
+  {
+    return LittleFS.rename(tmpPath, finalPath);
+  }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+// First bytes of a precompiled canvas bundle ("CWB1"), JSON canvases start with '{'
+#define CW_CANVAS_BUNDLE_MAGIC 0x31425743UL
+
+#ifndef CW_CANVAS_BUNDLE_MAX_SIZE
+  #define CW_CANVAS_BUNDLE_MAX_SIZE 65536
+#endif
+
+// Reads a canvas while it is stored or loaded, e.g. to compile it without a JSON document
+// in between. size is the byte count when known, -1 otherwise.
+class CanvasParser
+{
+public:
+  virtual bool parse(Stream &input, int32_t size, String &error) = 0;
+};
+
+// Whatever the clockface builds from a stored canvas, owned by the refresh until taken
+class StagedCanvas
+{
+public:
+  String file;   // name of the stored canvas it was built from
+
+  virtual ~StagedCanvas() {}
+  virtual size_t memoryUsage() const { return 0; }
+};
+
+// Builds the staged form of a stored canvas, nullptr when it is not valid
+typedef StagedCanvas *(*CanvasStager)(const String &name);
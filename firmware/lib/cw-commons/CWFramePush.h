@@ -0,0 +1,168 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <new>
+#include <FrameBuffer.h>
+#include <PNGRender.h>
+
+#ifndef CW_PUSH_DEFAULT_TTL
+  #define CW_PUSH_DEFAULT_TTL 30
+#endif
+
+#ifndef CW_PUSH_MAX_TTL
+  #define CW_PUSH_MAX_TTL 3600
+#endif
+
+#define CW_PUSH_READ_TIMEOUT 5000
+
+enum PushFormat {
+  PUSH_RGB565,
+  PUSH_PNG
+};
+
+struct PushRequest
+{
+  PushFormat format;
+  int32_t contentLength;
+  uint8_t x, y, w, h;
+  uint16_t ttl;
+};
+
+// Draws an image received over HTTP (raw little endian RGB565 or PNG) on the panel
+// and holds it there for a while before giving the panel back to the clockface.
+// The body is read in its own task through a fixed size buffer, so the render loop keeps
+// running (drawing only into a hidden copy of the framebuffer) while a slow upload is
+// being received. The image goes through the framebuffer, so the mirror shows it too.
+struct ClockwiseFramePush
+{
+  FrameBuffer *frameBuffer = nullptr;
+  WiFiClient client;
+  PushRequest request;
+  volatile bool busy = false;
+  volatile bool holding = false;
+  volatile unsigned long holdUntil = 0;
+
+  static ClockwiseFramePush *getInstance()
+  {
+    static ClockwiseFramePush base;
+    return &base;
+  }
+
+  void begin(FrameBuffer *fb)
+  {
+    frameBuffer = fb;
+  }
+
+  // Returns the HTTP status when the request is refused, 0 when it was accepted
+  uint16_t accept(WiFiClient newClient, PushRequest req)
+  {
+    if (frameBuffer == nullptr)
+      return 503;
+
+    if (busy)
+      return 409;
+
+    if (req.w == 0 || req.h == 0 || req.x + req.w > DISPLAY_WIDTH || req.y + req.h > DISPLAY_HEIGHT)
+      return 400;
+
+    if (req.contentLength <= 0 || (req.format == PUSH_RGB565 && req.contentLength != req.w * req.h * 2))
+      return 400;
+
+    req.ttl = constrain(req.ttl == 0 ? CW_PUSH_DEFAULT_TTL : req.ttl, 1, CW_PUSH_MAX_TTL);
+
+    client = newClient;
+    request = req;
+    busy = true;
+    holding = true;
+    frameBuffer->suspendOutput();
+
+    if (xTaskCreatePinnedToCore(pushTask, "cw-push", 4096, this, 1, NULL, 0) != pdPASS)
+    {
+      busy = false;
+      holdUntil = 0;
+      return 503;
+    }
+
+    return 0;
+  }
+
+  // Called from the main loop, gives the panel back once the image expired
+  void handle()
+  {
+    if (holding && !busy && (long)(millis() - holdUntil) >= 0)
+    {
+      holding = false;
+      frameBuffer->resumeOutput();
+      Serial.println("[Push] Back to the clockface");
+    }
+  }
+
+  static void pushTask(void *param)
+  {
+    ClockwiseFramePush *push = (ClockwiseFramePush *)param;
+    push->receive();
+    vTaskDelete(NULL);
+  }
+
+  void receive()
+  {
+    unsigned long start = millis();
+    client.setTimeout(CW_PUSH_READ_TIMEOUT);
+
+    bool success = (request.format == PUSH_PNG ? receivePNG() : receiveRGB565());
+
+    client.println(success ? "HTTP/1.0 204 No Content" : "HTTP/1.0 400 Bad Request");
+    client.println();
+    client.stop();
+
+    Serial.printf("[Push] %s %s image in %lums, holding it for %ds\n", (success ? "Received" : "Failed to receive"),
+                  (request.format == PUSH_PNG ? "PNG" : "RGB565"), millis() - start, (success ? request.ttl : 0));
+
+    holdUntil = millis() + (success ? request.ttl * 1000UL : 0);
+    busy = false;
+  }
+
+  bool receiveRGB565()
+  {
+    FrameBufferOverlay overlay(frameBuffer);
+    uint16_t line[DISPLAY_WIDTH];
+    size_t lineSize = request.w * sizeof(uint16_t);
+
+    for (uint8_t row = 0; row < request.h; row++)
+    {
+      if (client.readBytes((uint8_t *)line, lineSize) != lineSize)
+        return false;
+
+      overlay.drawRGBBitmap(request.x, request.y + row, line, request.w, 1);
+    }
+
+    return true;
+  }
+
+  bool receivePNG()
+  {
+    // The canvas keeps using the shared decoder, so the push gets its own for the transfer
+    PNG *decoder = new (std::nothrow) PNG();
+    PNGStreamSource *source = new (std::nothrow) PNGStreamSource();
+
+    FrameBufferOverlay overlay(frameBuffer);
+
+    // A PNG larger than the rect is refused rather than drawn over the rest of the panel
+    bool success = false;
+    if (decoder != nullptr && source != nullptr)
+    {
+      source->stream = &client;
+      source->size = request.contentLength;
+      success = renderImageStream(decoder, source, &overlay, request.x, request.y, request.w, request.h);
+    }
+    else
+    {
+      Serial.println("[Push] Not enough memory to decode PNG");
+    }
+
+    delete source;
+    delete decoder;
+    return success;
+  }
+};
@@ -3,8 +3,372 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 
+#define CW_HTTP_TIMEOUT 10000
+#define CW_HTTP_DNS_TTL 600000
+#define CW_HTTP_DNS_CACHE_SIZE 4
+// Leftover body bytes read to keep the connection instead of reconnecting
+#define CW_HTTP_MAX_DRAIN 2048
+
+// Cache validators of a local copy, sent as If-None-Match / If-Modified-Since
+struct HttpValidators
+{
+  String etag;
+  String lastModified;
+};
+
+#define CW_HTTP_LINE_MAX 256
+
+// Receives the response head as it is parsed, header names are lower case
+class HttpHeaderHandler
+{
+public:
+  virtual void onStatus(int16_t status, bool http11) {}
+  virtual void onHeader(const char *name, const char *value) {}
+};
+
+// Parses a status line and headers one byte at a time with a fixed line buffer.
+// Longer header lines are cut to CW_HTTP_LINE_MAX.
+class HttpHeaderParser
+{
+private:
+  enum State : uint8_t { STATUS_LINE, HEADER_LINE, DONE, FAILED };
+
+  HttpHeaderHandler *_handler = nullptr;
+  State _state = STATUS_LINE;
+  char _line[CW_HTTP_LINE_MAX];
+  uint16_t _length = 0;
+
+  static char *trim(char *text)
+  {
+    while (*text == ' ' || *text == '\t')
+      text++;
+
+    char *end = text + strlen(text);
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+      *--end = 0;
+    return text;
+  }
+
+  void parseStatus()
+  {
+    // HTTP/1.x NNN Reason
+    if (strncmp(_line, "HTTP/1.", 7) != 0 || _length < 12 || !isdigit(_line[9])) {
+      _state = FAILED;
+      return;
+    }
+
+    _handler->onStatus(atoi(_line + 9), _line[7] == '1');
+    _state = HEADER_LINE;
+  }
+
+  void parseHeader()
+  {
+    char *line = trim(_line);
+    if (*line == 0) {
+      _state = DONE;
+      return;
+    }
+
+    char *value = strchr(line, ':');
+    if (value == nullptr)
+      return;
+
+    *value++ = 0;
+    for (char *c = line; *c; c++)
+      *c = tolower(*c);
+
+    _handler->onHeader(trim(line), trim(value));
+  }
+
+public:
+  void begin(HttpHeaderHandler *handler)
+  {
+    _handler = handler;
+    _state = STATUS_LINE;
+    _length = 0;
+  }
+
+  // Returns true once the blank line ending the head was seen (or parsing failed)
+  bool feed(char c)
+  {
+    if (_state == DONE || _state == FAILED)
+      return true;
+
+    if (c != '\n') {
+      if (_length < CW_HTTP_LINE_MAX - 1)
+        _line[_length++] = c;
+      return false;
+    }
+
+    _line[_length] = 0;
+    if (_state == STATUS_LINE)
+      parseStatus();
+    else
+      parseHeader();
+    _length = 0;
+
+    return (_state == DONE || _state == FAILED);
+  }
+
+  bool failed() { return _state != DONE; }
+};
+
+struct HttpResponse : public HttpHeaderHandler
+{
+  int16_t status = 0;           // negative when no response was received
+  int32_t contentLength = -1;   // -1 when unknown (chunked or until the connection closes)
+  bool chunked = false;
+  bool keepAlive = false;
+  String etag;
+  String lastModified;
+
+  HttpHeaderHandler *listener = nullptr;  // also gets every event
+
+  void onStatus(int16_t code, bool http11) override
+  {
+    status = code;
+    keepAlive = http11;
+
+    if (listener != nullptr)
+      listener->onStatus(code, http11);
+  }
+
+  void onHeader(const char *name, const char *value) override
+  {
+    if (strcmp(name, "content-length") == 0) {
+      contentLength = atol(value);
+    } else if (strcmp(name, "transfer-encoding") == 0) {
+      chunked = (strcasecmp(value, "chunked") == 0);
+    } else if (strcmp(name, "connection") == 0) {
+      keepAlive = (strcasecmp(value, "keep-alive") == 0 || (keepAlive && strcasecmp(value, "close") != 0));
+    } else if (strcmp(name, "etag") == 0) {
+      etag = value;
+    } else if (strcmp(name, "last-modified") == 0) {
+      lastModified = value;
+    }
+
+    if (listener != nullptr)
+      listener->onHeader(name, value);
+  }
+};
+
+// Body of the current response read straight from the connection: exactly Content-Length
+// bytes, the decoded data of a chunked body, or everything until the connection closes.
+// Only the chunk framing is parsed here, the data is never buffered.
+class HttpBodyStream : public Stream
+{
+private:
+  enum Mode : uint8_t { LENGTH, CHUNKED, UNTIL_CLOSE };
+
+  Client *_client = nullptr;
+  Mode _mode = LENGTH;
+  int32_t _remaining = 0;   // in the whole body or in the current chunk
+  bool _done = true;
+  bool _failed = false;
+
+  // Framing bytes are tiny and arrive with the data, so waiting for them is fine
+  int nextByte()
+  {
+    unsigned long start = millis();
+    do {
+      int c = _client->read();
+      if (c >= 0)
+        return c;
+      if (!_client->connected())
+        return -1;
+      delay(1);
+    } while (millis() - start < _timeout);
+    return -1;
+  }
+
+  bool skipLine()
+  {
+    int c;
+    while ((c = nextByte()) >= 0 && c != '\n');
+    return c >= 0;
+  }
+
+  // Reads the next chunk size line, and the trailers after the last chunk
+  void nextChunk()
+  {
+    int32_t size = 0;
+    int digits = 0;
+    int c;
+
+    while ((c = nextByte()) >= 0 && isxdigit(c))
+    {
+      size = (size << 4) | (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+      digits++;
+    }
+
+    // Chunk extensions after ';' are ignored
+    if (c != '\n' && !skipLine())
+      c = -1;
+
+    if (c < 0 || digits == 0 || size < 0) {
+      fail();
+      return;
+    }
+
+    if (size > 0) {
+      _remaining = size;
+      return;
+    }
+
+    // Trailers end with an empty line
+    while (true)
+    {
+      int first = nextByte();
+      if (first == '\r')
+        first = nextByte();
+      if (first == '\n')
+        break;
+      if (first < 0 || !skipLine()) {
+        fail();
+        return;
+      }
+    }
+    _done = true;
+  }
+
+  void fail()
+  {
+    Serial.println(F("[HTTP] Invalid chunked body"));
+    _remaining = 0;
+    _done = true;
+    _failed = true;
+  }
+
+  void consumed(int32_t count)
+  {
+    if (_mode == UNTIL_CLOSE)
+      return;
+
+    _remaining -= count;
+    if (_remaining > 0)
+      return;
+
+    if (_mode == LENGTH)
+      _done = true;
+    else if (skipLine())  // CRLF after the chunk data
+      nextChunk();
+    else
+      fail();
+  }
+
+  bool ready()
+  {
+    if (_done || _client == nullptr)
+      return false;
+
+    if (_mode == UNTIL_CLOSE && !_client->connected() && _client->available() <= 0) {
+      _done = true;
+      return false;
+    }
+    return true;
+  }
+
+public:
+  void begin(Client *client, int32_t length, bool chunked)
+  {
+    _client = client;
+    _mode = (chunked ? CHUNKED : length < 0 ? UNTIL_CLOSE : LENGTH);
+    _remaining = length;
+    _done = (client == nullptr || (_mode == LENGTH && length == 0));
+    _failed = false;
+    setTimeout(CW_HTTP_TIMEOUT);
+
+    if (_mode == CHUNKED && client != nullptr)
+      nextChunk();
+  }
+
+  // True once the whole body was read, the connection can then take another request
+  bool finished() { return _done && !_failed; }
+
+  int available() override
+  {
+    if (!ready())
+      return 0;
+
+    int count = _client->available();
+    return (_mode != UNTIL_CLOSE && count > _remaining ? _remaining : count);
+  }
+
+  int read() override
+  {
+    if (!ready())
+      return -1;
+
+    int c = nextByte();
+    if (c >= 0)
+      consumed(1);
+    return c;
+  }
+
+  int peek() override
+  {
+    if (!ready())
+      return -1;
+
+    unsigned long start = millis();
+    int c;
+    while ((c = _client->peek()) < 0 && _client->connected() && millis() - start < _timeout)
+      delay(1);
+    return c;
+  }
+
+  // Bulk reads avoid going through the TLS layer one byte at a time
+  size_t readBytes(char *buffer, size_t length)
+  {
+    size_t count = 0;
+    unsigned long start = millis();
+
+    while (count < length && ready() && millis() - start < _timeout)
+    {
+      size_t wanted = length - count;
+      if (_mode != UNTIL_CLOSE && wanted > (size_t)_remaining)
+        wanted = _remaining;
+
+      int n = _client->read((uint8_t *)buffer + count, wanted);
+      if (n > 0) {
+        count += n;
+        consumed(n);
+        start = millis();
+      } else if (!_client->connected()) {
+        _done = true;
+        _failed = (_mode != UNTIL_CLOSE);
+        break;
+      } else {
+        delay(1);
+      }
+    }
+    return count;
+  }
+
+  size_t write(uint8_t) override { return 0; }
+};
+
+struct DnsCacheEntry
+{
+  String host;
+  IPAddress ip;
+  unsigned long resolvedAt = 0;
+};
+
+// HTTP/1.1 client that keeps the connection (and so the TLS session) open between requests
+// to the same server, caches DNS lookups and supports conditional requests.
+// Only one response can be read at a time: get() then body, then end().
 struct ClockwiseHttpClient
 {
+  WiFiClientSecure secureClient;
+  WiFiClient plainClient;
+  Client *active = nullptr;
+  String activeHost;
+  uint16_t activePort = 0;
+  bool reusable = false;
+
+  HttpBodyStream body;
+  DnsCacheEntry dnsCache[CW_HTTP_DNS_CACHE_SIZE];
 
   static ClockwiseHttpClient *getInstance()
   {
@@ -12,59 +376,202 @@ struct ClockwiseHttpClient
     return &base;
   }
 
-  void httpGet(WiFiClientSecure *client, const char *host, const char *path, const uint16_t port)
+  bool resolve(const char *host, IPAddress &ip)
   {
-    Serial.printf("[HTTP] GET request to '%s%s' on port %d\n", host, path, port);
+    DnsCacheEntry *slot = &dnsCache[0];
 
-    if (WiFi.status() != WL_CONNECTED)
+    for (uint8_t i = 0; i < CW_HTTP_DNS_CACHE_SIZE; i++)
     {
-      Serial.println("Not connected");
-      return;
+      DnsCacheEntry &entry = dnsCache[i];
+      if (entry.host == host && millis() - entry.resolvedAt < CW_HTTP_DNS_TTL) {
+        ip = entry.ip;
+        return true;
+      }
+
+      if (entry.resolvedAt < slot->resolvedAt)
+        slot = &entry;
     }
 
-    client->setInsecure();
-    client->setTimeout(10000);
-    if (!client->connect(host, port))
+    if (!WiFi.hostByName(host, ip))
+      return false;
+
+    slot->host = host;
+    slot->ip = ip;
+    slot->resolvedAt = millis();
+    return true;
+  }
+
+  void forgetHost(const char *host)
+  {
+    for (uint8_t i = 0; i < CW_HTTP_DNS_CACHE_SIZE; i++)
     {
-      Serial.println(F("Connection failed"));
-      return;
+      if (dnsCache[i].host == host)
+        dnsCache[i] = DnsCacheEntry();
     }
+  }
 
-    // Send HTTP request
-    client->printf("GET %s HTTP/1.1\r\n", path);
-    client->printf("Host: %s\r\n", host);
-    client->println(F("Connection: close"));
-    if (client->println() == 0)
-    {
-      Serial.println(F("Failed to send request"));
-      client->stop();
-      return;
+  bool isConnectedTo(const char *host, uint16_t port)
+  {
+    return (reusable && active != nullptr && active->connected() && activeHost == host && activePort == port);
+  }
+
+  // Port 80 is plain HTTP, anything else is HTTPS
+  bool connect(const char *host, uint16_t port)
+  {
+    if (isConnectedTo(host, port))
+      return true;
+
+    close();
+
+    IPAddress ip;
+    if (!resolve(host, ip)) {
+      Serial.printf("[HTTP] Could not resolve %s\n", host);
+      return false;
+    }
+
+    bool connected;
+    if (port == 80) {
+      plainClient.setTimeout(CW_HTTP_TIMEOUT);
+      connected = plainClient.connect(ip, port);
+      active = &plainClient;
+    } else {
+      secureClient.setInsecure();
+      secureClient.setTimeout(CW_HTTP_TIMEOUT);
+      // The host name is still needed for SNI
+      connected = secureClient.connect(ip, port, host, nullptr, nullptr, nullptr);
+      active = &secureClient;
     }
 
-    // char arrCode[4];
-    // memcpy(arrCode, status + 8, 3);  //HTTP/1.1 404 Not Found
-    // arrCode[3] = 0;
-    // uint16_t httpCode = atoi(arrCode);
+    if (!connected) {
+      Serial.println(F("[HTTP] Connection failed"));
+      forgetHost(host);
+      active = nullptr;
+      return false;
+    }
 
-    // Check HTTP status
-    char status[32] = {0};
-    client->readBytesUntil('\r', status, sizeof(status));
+    activeHost = host;
+    activePort = port;
+    return true;
+  }
 
-    if (strstr(status, "200 OK") == NULL)
+  void close()
+  {
+    if (active != nullptr)
+      active->stop();
+
+    active = nullptr;
+    reusable = false;
+    body.begin(nullptr, 0, false);
+  }
+
+  // Feeds the parser as bytes arrive until the blank line after the headers, the body is left in the socket
+  bool readResponseHead(HttpResponse &response)
+  {
+    HttpHeaderParser parser;
+    parser.begin(&response);
+    unsigned long start = millis();
+
+    while (millis() - start < CW_HTTP_TIMEOUT)
     {
-      Serial.print(F("Unexpected response: "));
-      Serial.println(status);
-      client->stop();
-      return;
+      int c = active->read();
+      if (c < 0) {
+        if (!active->connected())
+          return false;
+        delay(1);
+        continue;
+      }
+
+      if (parser.feed(c))
+        return !parser.failed();
     }
+    return false;
+  }
 
-    // Skip HTTP headers
-    char endOfHeaders[] = "\r\n\r\n";
-    if (!client->find(endOfHeaders))
+  // Sends a GET and reads the status and headers, the body is then available in 'body'.
+  // A 304 means the copy described by the validators is still current.
+  HttpResponse get(const char *host, const char *path, uint16_t port, const HttpValidators *validators = nullptr, HttpHeaderHandler *listener = nullptr)
+  {
+    HttpResponse response;
+
+    if (WiFi.status() != WL_CONNECTED)
     {
-      Serial.println(F("Invalid response"));
-      client->stop();
+      Serial.println("Not connected");
+      response.status = -1;
+      return response;
+    }
+
+    end();
+
+    // A kept connection may have been closed by the server in the meantime, retry once on a new one
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+      bool reused = isConnectedTo(host, port);
+      Serial.printf("[HTTP] GET request to '%s%s' on port %d%s\n", host, path, port, (reused ? " (reusing connection)" : ""));
+
+      if (!connect(host, port)) {
+        response.status = -1;
+        return response;
+      }
+
+      active->printf("GET %s HTTP/1.1\r\n", path);
+      active->printf("Host: %s\r\n", host);
+      active->print(F("Connection: keep-alive\r\n"));
+      if (validators != nullptr && !validators->etag.isEmpty())
+        active->printf("If-None-Match: %s\r\n", validators->etag.c_str());
+      if (validators != nullptr && !validators->lastModified.isEmpty())
+        active->printf("If-Modified-Since: %s\r\n", validators->lastModified.c_str());
+      active->print(F("\r\n"));
+
+      response = HttpResponse();
+      response.listener = listener;
+      if (readResponseHead(response))
+        break;
+
+      close();
+      if (!reused) {
+        Serial.println(F("[HTTP] Invalid response"));
+        response.status = -2;
+        return response;
+      }
+    }
+
+    if (response.status < 0)
+      return response;
+
+    bool noBody = (response.status == 204 || response.status == 304 || (response.status >= 100 && response.status < 200));
+    if (noBody) {
+      response.contentLength = 0;
+      response.chunked = false;
+    }
+
+    body.begin(active, response.contentLength, response.chunked);
+    reusable = response.keepAlive && (response.chunked || response.contentLength >= 0);
+
+    if (response.status != 200 && response.status != 304)
+      Serial.printf("[HTTP] Unexpected response: %d\n", response.status);
+
+    return response;
+  }
+
+  // Finishes the current response, keeping the connection when the rest of the body is small enough to skip
+  void end()
+  {
+    if (active == nullptr)
       return;
+
+    char discard[64];
+    uint16_t drained = 0;
+    while (reusable && !body.finished() && drained < CW_HTTP_MAX_DRAIN)
+    {
+      size_t n = body.readBytes(discard, sizeof(discard));
+      if (n == 0)
+        break;
+      drained += n;
     }
+
+    if (!reusable || !body.finished())
+      close();
+    else
+      body.begin(nullptr, 0, false);
   }
 };
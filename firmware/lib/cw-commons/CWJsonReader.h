@@ -0,0 +1,327 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Pull parser reading JSON straight from a Stream, so a document of any size is walked
+// with a few bytes of state. The caller drives it with the structure it expects:
+//
+//   reader.beginObject();
+//   while (reader.nextMember(key, sizeof(key)))
+//     ... read or skip the value ...
+//
+// Strings are written to a Print as they are unescaped, values nobody asked for are
+// skipped without being stored. Any syntax error makes every following call return false.
+class JsonStreamReader
+{
+private:
+  static const uint8_t MAX_DEPTH = 32;
+
+  Stream &_input;
+  int _peeked = -1;
+  bool _hasPeeked = false;
+  bool _failed = false;
+  uint8_t _depth = 0;
+  uint32_t _started = 0;   // bit per depth: a member or element was already read
+
+  int next()
+  {
+    if (_hasPeeked) {
+      _hasPeeked = false;
+      return _peeked;
+    }
+    return _input.read();
+  }
+
+  int peekChar()
+  {
+    if (!_hasPeeked) {
+      _peeked = _input.read();
+      _hasPeeked = true;
+    }
+    return _peeked;
+  }
+
+  int peekToken()
+  {
+    while (true)
+    {
+      int c = peekChar();
+      if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        return c;
+      next();
+    }
+  }
+
+  bool fail()
+  {
+    _failed = true;
+    return false;
+  }
+
+  bool expect(char c)
+  {
+    if (_failed || peekToken() != c)
+      return fail();
+    next();
+    return true;
+  }
+
+  bool push(char open)
+  {
+    if (!expect(open) || _depth >= MAX_DEPTH)
+      return fail();
+
+    _depth++;
+    _started &= ~(1UL << _depth);
+    return true;
+  }
+
+  // Consumes the closing bracket or the comma before the next entry
+  bool more(char close)
+  {
+    if (_failed || _depth == 0)
+      return false;
+
+    if (peekToken() == close) {
+      next();
+      _depth--;
+      return false;
+    }
+
+    if (_started & (1UL << _depth))
+      return expect(',');
+
+    _started |= (1UL << _depth);
+    return true;
+  }
+
+  bool writeUtf8(Print *out, uint32_t code)
+  {
+    uint8_t bytes[4];
+    uint8_t length;
+
+    if (code < 0x80) {
+      bytes[0] = code;
+      length = 1;
+    } else if (code < 0x800) {
+      bytes[0] = 0xC0 | (code >> 6);
+      bytes[1] = 0x80 | (code & 0x3F);
+      length = 2;
+    } else {
+      bytes[0] = 0xE0 | (code >> 12);
+      bytes[1] = 0x80 | ((code >> 6) & 0x3F);
+      bytes[2] = 0x80 | (code & 0x3F);
+      length = 3;
+    }
+
+    for (uint8_t i = 0; i < length; i++)
+    {
+      if (out != nullptr && out->write(bytes[i]) != 1)
+        return false;
+    }
+    return true;
+  }
+
+  bool skipLiteral(const char *literal)
+  {
+    for (const char *c = literal; *c; c++)
+    {
+      if (next() != *c)
+        return fail();
+    }
+    return true;
+  }
+
+public:
+  JsonStreamReader(Stream &input) : _input(input) {}
+
+  bool failed() { return _failed; }
+
+  // First character of the next value: '{', '[', '"', 't', 'f', 'n', '-' or a digit
+  int peek() { return (_failed ? -1 : peekToken()); }
+
+  bool beginObject() { return push('{'); }
+  bool beginArray() { return push('['); }
+
+  // False once the closing '}' was consumed
+  bool nextMember(char *key, size_t keySize)
+  {
+    if (!more('}'))
+      return false;
+
+    if (!readString(key, keySize) || !expect(':'))
+      return false;
+    return true;
+  }
+
+  // False once the closing ']' was consumed
+  bool nextElement()
+  {
+    return more(']') && !_failed;
+  }
+
+  // Writes the unescaped string to out, or drops it when out is null
+  bool readString(Print *out)
+  {
+    if (!expect('"'))
+      return false;
+
+    while (true)
+    {
+      int c = next();
+      if (c < 0 || c < ' ')
+        return fail();
+
+      if (c == '"')
+        return true;
+
+      if (c == '\\')
+      {
+        c = next();
+        switch (c)
+        {
+        case '"': case '\\': case '/': break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'u':
+        {
+          uint32_t code = 0;
+          for (uint8_t i = 0; i < 4; i++)
+          {
+            int h = next();
+            if (!isxdigit(h))
+              return fail();
+            code = (code << 4) | (isdigit(h) ? h - '0' : tolower(h) - 'a' + 10);
+          }
+          if (!writeUtf8(out, code))
+            return fail();
+          continue;
+        }
+        default:
+          return fail();
+        }
+      }
+
+      if (out != nullptr && out->write((uint8_t)c) != 1)
+        return fail();
+    }
+  }
+
+  // Longer strings are cut to fit, always null terminated
+  bool readString(char *buffer, size_t size)
+  {
+    class BufferPrint : public Print
+    {
+    public:
+      char *buffer;
+      size_t size;
+      size_t length = 0;
+
+      BufferPrint(char *b, size_t s) : buffer(b), size(s) {}
+      size_t write(uint8_t c) override
+      {
+        if (length + 1 < size)
+          buffer[length++] = c;
+        return 1;
+      }
+    } out(buffer, size);
+
+    bool ok = readString(&out);
+    if (size > 0)
+      buffer[out.length] = 0;
+    return ok;
+  }
+
+  // Numbers are truncated to an integer, true/false read as 1/0, null as 0
+  bool readInteger(long &value)
+  {
+    value = 0;
+    int c = peek();
+
+    if (c == 't' || c == 'f' || c == 'n') {
+      value = (c == 't');
+      return skipLiteral(c == 't' ? "true" : c == 'f' ? "false" : "null");
+    }
+
+    bool negative = (c == '-');
+    if (negative)
+      next();
+
+    if (!isdigit(peekChar()))
+      return fail();
+
+    while (isdigit(peekChar()))
+      value = value * 10 + (next() - '0');
+
+    // Fraction and exponent are read but not applied
+    if (peekChar() == '.') {
+      next();
+      while (isdigit(peekChar()))
+        next();
+    }
+    if (peekChar() == 'e' || peekChar() == 'E') {
+      next();
+      if (peekChar() == '+' || peekChar() == '-')
+        next();
+      while (isdigit(peekChar()))
+        next();
+    }
+
+    if (negative)
+      value = -value;
+    return true;
+  }
+
+  bool readBool(bool &value)
+  {
+    long number;
+    bool ok = readInteger(number);
+    value = (number != 0);
+    return ok;
+  }
+
+  bool skipValue()
+  {
+    char key[1];
+    int c = peek();
+
+    if (c == '{') {
+      beginObject();
+      while (nextMember(key, sizeof(key)))
+        skipValue();
+    } else if (c == '[') {
+      beginArray();
+      while (nextElement())
+        skipValue();
+    } else if (c == '"') {
+      readString((Print *)nullptr);
+    } else {
+      long number;
+      readInteger(number);
+    }
+    return !_failed;
+  }
+};
+
+// Read-only Stream over a string or bytes in memory, e.g. a canvas embedded in the firmware
+class MemoryStream : public Stream
+{
+private:
+  const char *_data;
+  size_t _length;
+  size_t _position = 0;
+
+public:
+  MemoryStream(const char *data) : _data(data), _length(strlen(data)) {}
+  MemoryStream(const uint8_t *data, size_t length) : _data((const char *)data), _length(length) {}
+
+  size_t length() { return _length; }
+
+  int available() override { return _length - _position; }
+  int read() override { return (_position < _length ? (uint8_t)_data[_position++] : -1); }
+  int peek() override { return (_position < _length ? (uint8_t)_data[_position] : -1); }
+  size_t write(uint8_t) override { return 0; }
+};
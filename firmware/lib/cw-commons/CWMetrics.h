@@ -0,0 +1,200 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ezTime.h>
+#include <atomic>
+
+// Bucket upper bounds in microseconds, the +Inf bucket is implicit
+const uint32_t LOOP_LATENCY_BOUNDS[] = {500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000, 1000000};
+const uint32_t HTTP_LATENCY_BOUNDS[] = {5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000};
+
+// Prometheus style histogram. Observing is a couple of relaxed atomic adds; the sum is kept as
+// seconds + microseconds so it does not wrap after ~71 minutes like a plain 32 bit counter would.
+// The sum carry is only correct with a single writer, which is the case for the main loop.
+template <size_t N>
+struct CWHistogram
+{
+  const uint32_t *bounds;
+  std::atomic<uint32_t> buckets[N + 1];
+  std::atomic<uint32_t> sumSeconds;
+  std::atomic<uint32_t> sumMicros;
+
+  CWHistogram(const uint32_t (&b)[N]) : bounds(b), sumSeconds(0), sumMicros(0)
+  {
+    for (size_t i = 0; i <= N; i++)
+      buckets[i].store(0, std::memory_order_relaxed);
+  }
+
+  void observe(uint32_t us)
+  {
+    size_t i = 0;
+    while (i < N && us > bounds[i])
+      i++;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t micros = sumMicros.load(std::memory_order_relaxed) + us;
+    if (micros >= 1000000)
+    {
+      sumSeconds.fetch_add(micros / 1000000, std::memory_order_relaxed);
+      micros %= 1000000;
+    }
+    sumMicros.store(micros, std::memory_order_relaxed);
+  }
+
+  void print(Print &out, const char *name)
+  {
+    uint32_t count = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+      count += buckets[i].load(std::memory_order_relaxed);
+      out.printf("%s_bucket{le=\"%u.%06u\"} %u\n", name, bounds[i] / 1000000, bounds[i] % 1000000, count);
+    }
+    count += buckets[N].load(std::memory_order_relaxed);
+    out.printf("%s_bucket{le=\"+Inf\"} %u\n", name, count);
+    out.printf("%s_sum %u.%06u\n", name, sumSeconds.load(std::memory_order_relaxed), sumMicros.load(std::memory_order_relaxed));
+    out.printf("%s_count %u\n", name, count);
+  }
+};
+
+// Runtime counters exposed on /metrics in the Prometheus text format.
+// Hot paths only touch atomics; heap and RSSI are read when the endpoint is scraped.
+struct ClockwiseMetrics
+{
+  CWHistogram<10> loopLatency{LOOP_LATENCY_BOUNDS};
+  CWHistogram<9> httpLatency{HTTP_LATENCY_BOUNDS};
+
+  std::atomic<uint32_t> frames{0};
+  std::atomic<uint32_t> fps{0};
+  std::atomic<uint32_t> httpRequests{0};
+  std::atomic<uint32_t> wifiDisconnects{0};
+  std::atomic<uint32_t> wifiReconnects{0};
+  std::atomic<bool> wifiConnectedOnce{false};
+  std::atomic<int32_t> ntpOffsetMs{0};
+
+  // Only touched by the main loop
+  uint32_t windowFrames = 0;
+  unsigned long windowStart = 0;
+  time_t lastNtpSync = 0;
+  time_t sampledTime = 0;
+  uint16_t sampledMs = 0;
+  unsigned long sampledAt = 0;
+
+  static ClockwiseMetrics *getInstance()
+  {
+    static ClockwiseMetrics base;
+    return &base;
+  }
+
+  void begin()
+  {
+    WiFi.onEvent(onWiFiEvent);
+  }
+
+  static void onWiFiEvent(WiFiEvent_t event)
+  {
+    ClockwiseMetrics *metrics = getInstance();
+
+    if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+      metrics->wifiDisconnects.fetch_add(1, std::memory_order_relaxed);
+    } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+      if (metrics->wifiConnectedOnce.exchange(true))
+        metrics->wifiReconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void recordFrame()
+  {
+    frames.fetch_add(1, std::memory_order_relaxed);
+    windowFrames++;
+  }
+
+  void recordHttpRequest(uint32_t us)
+  {
+    httpRequests.fetch_add(1, std::memory_order_relaxed);
+    httpLatency.observe(us);
+  }
+
+  // Called once per loop iteration with its duration
+  void recordLoop(uint32_t us)
+  {
+    loopLatency.observe(us);
+
+    unsigned long now = millis();
+    if (now - windowStart >= 1000)
+    {
+      fps.store(windowFrames * 1000 / (now - windowStart), std::memory_order_relaxed);
+      windowFrames = 0;
+      windowStart = now;
+      trackNtpOffset();
+    }
+  }
+
+  // ezTime does not report the offset it corrects on sync, so the clock is sampled every second
+  // and, when a new sync shows up, the jump from the extrapolated time is the measured offset
+  void trackNtpOffset()
+  {
+    if (timeStatus() == timeNotSet)
+      return;
+
+    time_t t = UTC.now();
+    uint16_t ms = UTC.ms(LAST_READ);
+    unsigned long at = millis();
+
+    if (lastNtpUpdateTime() != lastNtpSync)
+    {
+      if (lastNtpSync != 0 && sampledAt != 0)
+      {
+        int64_t expected = (int64_t)sampledTime * 1000 + sampledMs + (at - sampledAt);
+        int64_t actual = (int64_t)t * 1000 + ms;
+        ntpOffsetMs.store((int32_t)(actual - expected), std::memory_order_relaxed);
+      }
+      lastNtpSync = lastNtpUpdateTime();
+    }
+
+    sampledTime = t;
+    sampledMs = ms;
+    sampledAt = at;
+  }
+
+  void printMetric(Print &out, const char *name, const char *type, const char *help, const char *format, ...)
+  {
+    out.printf("# HELP %s %s\n# TYPE %s %s\n%s ", name, help, name, type, name);
+
+    char value[24];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(value, sizeof(value), format, args);
+    va_end(args);
+
+    out.println(value);
+  }
+
+  void print(Print &out)
+  {
+    printMetric(out, "clockwise_heap_free_bytes", "gauge", "Free heap", "%u", ESP.getFreeHeap());
+    printMetric(out, "clockwise_heap_min_free_bytes", "gauge", "Lowest free heap since boot", "%u", ESP.getMinFreeHeap());
+    printMetric(out, "clockwise_heap_largest_free_block_bytes", "gauge", "Largest allocatable block", "%u", ESP.getMaxAllocHeap());
+    printMetric(out, "clockwise_uptime_seconds", "counter", "Time since boot", "%lu", millis() / 1000);
+
+    out.print("# HELP clockwise_loop_duration_seconds Main loop iteration time\n# TYPE clockwise_loop_duration_seconds histogram\n");
+    loopLatency.print(out, "clockwise_loop_duration_seconds");
+
+    printMetric(out, "clockwise_frames_total", "counter", "Clockface updates", "%u", frames.load(std::memory_order_relaxed));
+    printMetric(out, "clockwise_fps", "gauge", "Clockface updates in the last second", "%u", fps.load(std::memory_order_relaxed));
+
+    printMetric(out, "clockwise_http_requests_total", "counter", "HTTP requests handled", "%u", httpRequests.load(std::memory_order_relaxed));
+    out.print("# HELP clockwise_http_request_duration_seconds HTTP request handling time\n# TYPE clockwise_http_request_duration_seconds histogram\n");
+    httpLatency.print(out, "clockwise_http_request_duration_seconds");
+
+    if (lastNtpUpdateTime() > 0)
+    {
+      printMetric(out, "clockwise_ntp_last_sync_age_seconds", "gauge", "Time since the last NTP sync", "%ld", (long)(UTC.now() - lastNtpUpdateTime()));
+      printMetric(out, "clockwise_ntp_offset_seconds", "gauge", "Clock correction applied by the last NTP sync", "%.3f", ntpOffsetMs.load(std::memory_order_relaxed) / 1000.0);
+    }
+
+    printMetric(out, "clockwise_wifi_disconnects_total", "counter", "WiFi station disconnections", "%u", wifiDisconnects.load(std::memory_order_relaxed));
+    printMetric(out, "clockwise_wifi_reconnects_total", "counter", "WiFi reconnections after the first connection", "%u", wifiReconnects.load(std::memory_order_relaxed));
+    printMetric(out, "clockwise_wifi_rssi_dbm", "gauge", "WiFi signal strength", "%d", WiFi.RSSI());
+  }
+};
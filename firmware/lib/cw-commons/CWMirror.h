@@ -0,0 +1,237 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <FrameBuffer.h>
+#include "mbedtls/base64.h"
+
+#ifndef CW_MIRROR_DEFAULT_FPS
+  #define CW_MIRROR_DEFAULT_FPS 5
+#endif
+
+#ifndef CW_MIRROR_MAX_FPS
+  #define CW_MIRROR_MAX_FPS 20
+#endif
+
+// Worst case for one tile row: a 4 bytes rect header per tile and a run (count + RGB565) per pixel
+const size_t MIRROR_RAW_SIZE = (FB_TILE_COLS * 4) + (DISPLAY_WIDTH * FB_TILE_SIZE * 3);
+const size_t MIRROR_B64_SIZE = ((MIRROR_RAW_SIZE + 2) / 3) * 4 + 1;
+
+// Streams the framebuffer to a browser using Server-Sent Events.
+// The first event is a keyframe, then only the tiles that changed are sent, merged into
+// rectangles and RLE-compressed: [x][y][w][h] followed by [count][color lo][color hi] runs.
+// Encoding happens in its own task on core 0, the render loop only marks tiles as dirty.
+struct ClockwiseMirror
+{
+  FrameBuffer *frameBuffer = nullptr;
+  WiFiClient client;
+  SemaphoreHandle_t lock = nullptr;
+  TaskHandle_t task = nullptr;
+  uint16_t frameInterval = 1000 / CW_MIRROR_DEFAULT_FPS;
+  bool keyframe = false;
+
+  uint16_t *sent = nullptr;
+  uint8_t *raw = nullptr;
+  unsigned char *encoded = nullptr;
+
+  static ClockwiseMirror *getInstance()
+  {
+    static ClockwiseMirror base;
+    return &base;
+  }
+
+  void begin(FrameBuffer *fb)
+  {
+    frameBuffer = fb;
+  }
+
+  void attach(WiFiClient newClient, uint8_t fps)
+  {
+    if (frameBuffer == nullptr)
+      return;
+
+    if (lock == nullptr)
+      lock = xSemaphoreCreateMutex();
+
+    fps = constrain(fps == 0 ? CW_MIRROR_DEFAULT_FPS : fps, 1, CW_MIRROR_MAX_FPS);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    client.stop();
+    client = newClient;
+    frameInterval = 1000 / fps;
+    keyframe = true;
+    xSemaphoreGive(lock);
+
+    if (task == nullptr)
+      xTaskCreatePinnedToCore(mirrorTask, "cw-mirror", 4096, this, 1, &task, 0);
+
+    Serial.printf("[Mirror] Client attached, %d fps\n", fps);
+  }
+
+  static void mirrorTask(void *param)
+  {
+    ClockwiseMirror *mirror = (ClockwiseMirror *)param;
+
+    for (;;)
+    {
+      xSemaphoreTake(mirror->lock, portMAX_DELAY);
+      bool streaming = mirror->streamFrame();
+      uint16_t interval = mirror->frameInterval;
+      xSemaphoreGive(mirror->lock);
+
+      vTaskDelay(pdMS_TO_TICKS(streaming ? interval : 250));
+    }
+  }
+
+  bool streamFrame()
+  {
+    if (!client.connected())
+    {
+      if (sent != nullptr)
+      {
+        Serial.println("[Mirror] Client detached");
+        client.stop();
+        releaseBuffers();
+      }
+      return false;
+    }
+
+    if (sent == nullptr && !allocateBuffers())
+    {
+      client.stop();
+      return false;
+    }
+
+    for (uint8_t row = 0; row < FB_TILE_ROWS; row++)
+    {
+      uint8_t dirty = frameBuffer->takeDirtyTiles(row);
+      if (keyframe)
+        dirty = 0xFF;
+
+      size_t len = encodeTileRow(row, dirty, keyframe);
+      if (len > 0 && !sendEvent(keyframe ? "key" : "delta", len))
+      {
+        client.stop();
+        return false;
+      }
+    }
+
+    keyframe = false;
+    return true;
+  }
+
+  bool tileChanged(uint8_t row, uint8_t col)
+  {
+    const uint16_t *pixels = frameBuffer->getPixels();
+
+    for (uint8_t y = row * FB_TILE_SIZE; y < (row + 1) * FB_TILE_SIZE; y++)
+    {
+      uint16_t offset = y * DISPLAY_WIDTH + col * FB_TILE_SIZE;
+      if (memcmp(&pixels[offset], &sent[offset], FB_TILE_SIZE * sizeof(uint16_t)) != 0)
+        return true;
+    }
+    return false;
+  }
+
+  size_t encodeTileRow(uint8_t row, uint8_t dirty, bool force)
+  {
+    size_t len = 0;
+    uint8_t col = 0;
+
+    while (col < FB_TILE_COLS)
+    {
+      if (!(dirty & (1 << col)) || !(force || tileChanged(row, col)))
+      {
+        col++;
+        continue;
+      }
+
+      // Merge the neighbour tiles that also changed into a single rectangle
+      uint8_t first = col;
+      while (col < FB_TILE_COLS && (dirty & (1 << col)) && (force || col == first || tileChanged(row, col)))
+        col++;
+
+      len += encodeRect(first * FB_TILE_SIZE, row * FB_TILE_SIZE, (col - first) * FB_TILE_SIZE, FB_TILE_SIZE, raw + len);
+    }
+
+    return len;
+  }
+
+  size_t encodeRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t *out)
+  {
+    const uint16_t *pixels = frameBuffer->getPixels();
+    size_t len = 0;
+
+    out[len++] = x;
+    out[len++] = y;
+    out[len++] = w;
+    out[len++] = h;
+
+    // Snapshot the rect first, so the runs and the copy used for diffing always match
+    for (uint8_t yy = y; yy < y + h; yy++)
+      memcpy(&sent[yy * DISPLAY_WIDTH + x], &pixels[yy * DISPLAY_WIDTH + x], w * sizeof(uint16_t));
+
+    uint16_t color = sent[y * DISPLAY_WIDTH + x];
+    uint8_t count = 0;
+
+    for (uint8_t yy = y; yy < y + h; yy++)
+    {
+      for (uint8_t xx = x; xx < x + w; xx++)
+      {
+        uint16_t pixel = sent[yy * DISPLAY_WIDTH + xx];
+        if (pixel != color || count == 255)
+        {
+          out[len++] = count;
+          out[len++] = color & 0xFF;
+          out[len++] = color >> 8;
+          color = pixel;
+          count = 0;
+        }
+        count++;
+      }
+    }
+
+    out[len++] = count;
+    out[len++] = color & 0xFF;
+    out[len++] = color >> 8;
+    return len;
+  }
+
+  bool sendEvent(const char *name, size_t len)
+  {
+    size_t encodedLen = 0;
+    if (mbedtls_base64_encode(encoded, MIRROR_B64_SIZE, &encodedLen, raw, len) != 0)
+      return false;
+
+    client.printf("event: %s\ndata: ", name);
+    if (client.write(encoded, encodedLen) != encodedLen)
+      return false;
+
+    return client.print("\n\n") > 0;
+  }
+
+  bool allocateBuffers()
+  {
+    sent = (uint16_t *)malloc(DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(uint16_t));
+    raw = (uint8_t *)malloc(MIRROR_RAW_SIZE);
+    encoded = (unsigned char *)malloc(MIRROR_B64_SIZE);
+
+    if (sent == nullptr || raw == nullptr || encoded == nullptr)
+    {
+      Serial.println("[Mirror] Not enough memory");
+      releaseBuffers();
+      return false;
+    }
+    return true;
+  }
+
+  void releaseBuffers()
+  {
+    free(sent);
+    free(raw);
+    free(encoded);
+    sent = nullptr;
+    raw = nullptr;
+    encoded = nullptr;
+  }
+};
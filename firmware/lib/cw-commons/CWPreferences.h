@@ -1,49 +1,86 @@
 #pragma once
 
 #include <Preferences.h>
+#include "CWSettings.h"
 
 #ifndef CW_PREF_DB_NAME
     #define CW_PREF_DB_NAME "clockwise"
 #endif
 
+// How long saveLater() waits for more changes before writing them to NVS
+#ifndef CW_PREF_COMMIT_DELAY
+    #define CW_PREF_COMMIT_DELAY 5000
+#endif
+
+// All settings are kept in a single NVS blob:
+//   header: [version][entry count][body length lo][body length hi][crc32 of the body, 4 bytes LE]
+//   body:   per setting [key length][key][type][value]
+//           value is 1 byte for bool/uint8, 2 bytes LE for uint16, [length][chars] for strings
+// Entries are matched by key, so settings added to or removed from the table migrate by
+// themselves; the version only changes if this layout does.
+#define CW_PREF_BLOB_KEY "settings"
+const uint8_t SETTINGS_BLOB_VERSION = 1;
+const size_t SETTINGS_BLOB_HEADER_SIZE = 8;
+
+constexpr size_t settingBlobSize(const SettingDescriptor &setting)
+{
+    size_t size = 2 + (setting.type == SETTING_STRING ? 1 + setting.max : setting.type == SETTING_UINT16 ? 2 : 1);
+    for (const char *c = setting.key; *c; c++)
+        size++;
+    return size;
+}
+
+constexpr size_t settingsBlobMaxSize()
+{
+    size_t size = SETTINGS_BLOB_HEADER_SIZE;
+    for (const SettingDescriptor &setting : SETTINGS)
+        size += settingBlobSize(setting);
+    return size;
+}
+
+const size_t SETTINGS_BLOB_MAX_SIZE = settingsBlobMaxSize();
+static_assert(SETTINGS_BLOB_MAX_SIZE - SETTINGS_BLOB_HEADER_SIZE <= 0xFFFF, "Settings blob body length is 16 bits");
+
+inline uint32_t settingsCrc32(const uint8_t *data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+template <SettingType T> struct SettingField;
+template <> struct SettingField<SETTING_BOOL> { typedef bool Type; };
+template <> struct SettingField<SETTING_UINT8> { typedef uint8_t Type; };
+template <> struct SettingField<SETTING_UINT16> { typedef uint16_t Type; };
+template <> struct SettingField<SETTING_STRING> { typedef String Type; };
+
+typedef void (*SettingHook)(ClockwiseParam param);
+
 
 struct ClockwiseParams
 {
     Preferences preferences;
 
-    const char* const PREF_SWAP_BLUE_GREEN = "swapBlueGreen";
-    const char* const PREF_USE_24H_FORMAT = "use24hFormat";
-    const char* const PREF_DISPLAY_BRIGHT = "displayBright";
-    const char* const PREF_DISPLAY_ABC_MIN = "autoBrightMin";
-    const char* const PREF_DISPLAY_ABC_MAX = "autoBrightMax";
-    const char* const PREF_LDR_PIN = "ldrPin";
-    const char* const PREF_TIME_ZONE = "timeZone";
-    const char* const PREF_WIFI_SSID = "wifiSsid";
-    const char* const PREF_WIFI_PASSWORD = "wifiPwd";
-    const char* const PREF_NTP_SERVER = "ntpServer";
-    const char* const PREF_CANVAS_FILE = "canvasFile";
-    const char* const PREF_CANVAS_SERVER = "canvasServer";
-    const char* const PREF_MANUAL_POSIX = "manualPosix";
-    const char* const PREF_DISPLAY_ROTATION = "displayRotation";
-
-    bool swapBlueGreen;
-    bool use24hFormat;
-    uint8_t displayBright;
-    uint16_t autoBrightMin;
-    uint16_t autoBrightMax;
-    uint8_t ldrPin;
-    String timeZone;
-    String wifiSsid;
-    String wifiPwd;
-    String ntpServer;
-    String canvasFile;
-    String canvasServer;
-    String manualPosix;
-    uint8_t displayRotation;
+#define SETTING_FIELD(id, field, key, type, def, min, max, flags) SettingField<SETTING_##type>::Type field;
+    CW_SETTINGS(SETTING_FIELD)
+#undef SETTING_FIELD
+
+    // NVS is only read once, after that the fields above are the source of truth.
+    // Changes must go through set()/parse() so save() knows which keys to write.
+    bool loaded = false;
+    uint32_t dirty = 0;
+    bool commitPending = false;
+    unsigned long commitAt = 0;
+    SettingHook hooks[PARAM_COUNT] = {nullptr};
 
 
     ClockwiseParams() {
-        preferences.begin("clockwise", false); 
+        preferences.begin(CW_PREF_DB_NAME, false);
         //preferences.clear();
     }
 
@@ -52,41 +89,345 @@ struct ClockwiseParams
         return &base;
     }
 
-   
+    static const SettingDescriptor &describe(ClockwiseParam param)
+    {
+        return SETTINGS[param];
+    }
+
+    void *fieldOf(ClockwiseParam param)
+    {
+        switch (param)
+        {
+#define SETTING_CASE(id, field, key, type, def, min, max, flags) case PARAM_##id: return &field;
+            CW_SETTINGS(SETTING_CASE)
+#undef SETTING_CASE
+            default: return nullptr;
+        }
+    }
+
+    uint32_t getNumber(ClockwiseParam param)
+    {
+        void *field = fieldOf(param);
+
+        switch (describe(param).type)
+        {
+            case SETTING_BOOL: return *(bool *)field;
+            case SETTING_UINT8: return *(uint8_t *)field;
+            case SETTING_UINT16: return *(uint16_t *)field;
+            default: return 0;
+        }
+    }
+
+    const String &getText(ClockwiseParam param)
+    {
+        return *(String *)fieldOf(param);
+    }
+
+    // Called with the setting whenever a SETTING_LIVE value changes
+    void onChange(ClockwiseParam param, SettingHook hook)
+    {
+        hooks[param] = hook;
+    }
+
+    void changed(ClockwiseParam param)
+    {
+        dirty |= (1UL << param);
+
+        if ((describe(param).flags & SETTING_LIVE) && hooks[param] != nullptr)
+            hooks[param](param);
+    }
+
+    // Setters return false when the value is out of the setting range
+    bool set(ClockwiseParam param, uint32_t value)
+    {
+        const SettingDescriptor &setting = describe(param);
+        if (setting.type == SETTING_STRING || value < setting.min || value > setting.max)
+            return false;
+
+        if (getNumber(param) != value)
+        {
+            void *field = fieldOf(param);
+            switch (setting.type)
+            {
+                case SETTING_BOOL: *(bool *)field = value; break;
+                case SETTING_UINT8: *(uint8_t *)field = value; break;
+                case SETTING_UINT16: *(uint16_t *)field = value; break;
+                default: break;
+            }
+            changed(param);
+        }
+        return true;
+    }
+
+    bool set(ClockwiseParam param, const String &value)
+    {
+        const SettingDescriptor &setting = describe(param);
+        if (setting.type != SETTING_STRING || value.length() > setting.max)
+            return false;
+
+        String &field = *(String *)fieldOf(param);
+        if (field != value)
+        {
+            field = value;
+            changed(param);
+        }
+        return true;
+    }
+
+    // Text as received by /set: booleans are 0/1, numbers are decimal
+    bool parse(ClockwiseParam param, const String &text)
+    {
+        if (param >= PARAM_COUNT)
+            return false;
+
+        if (describe(param).type == SETTING_STRING)
+            return set(param, text);
+
+        if (text.isEmpty())
+            return false;
+
+        for (size_t i = 0; i < text.length(); i++)
+        {
+            if (!isdigit(text.charAt(i)))
+                return false;
+        }
+        return set(param, (uint32_t)text.toInt());
+    }
+
+    String toString(ClockwiseParam param)
+    {
+        return (describe(param).type == SETTING_STRING ? getText(param) : String(getNumber(param)));
+    }
+
+    bool isDirty(ClockwiseParam param)
+    {
+        return dirty & (1UL << param);
+    }
+
+    void setDefault(ClockwiseParam param)
+    {
+        const SettingDescriptor &setting = describe(param);
+        void *field = fieldOf(param);
+
+        switch (setting.type)
+        {
+            case SETTING_BOOL: *(bool *)field = setting.defaultNumber; break;
+            case SETTING_UINT8: *(uint8_t *)field = setting.defaultNumber; break;
+            case SETTING_UINT16: *(uint16_t *)field = setting.defaultNumber; break;
+            case SETTING_STRING: *(String *)field = setting.defaultText; break;
+        }
+    }
+
+    void setDefaults()
+    {
+        for (uint8_t i = 0; i < PARAM_COUNT; i++)
+            setDefault((ClockwiseParam)i);
+    }
+
+    // Returns the blob length, 0 if it does not fit
+    size_t serialize(uint8_t *blob, size_t size)
+    {
+        size_t pos = SETTINGS_BLOB_HEADER_SIZE;
+
+        for (uint8_t i = 0; i < PARAM_COUNT; i++)
+        {
+            const SettingDescriptor &setting = describe((ClockwiseParam)i);
+            size_t keyLength = strlen(setting.key);
+            const String *text = (setting.type == SETTING_STRING ? &getText((ClockwiseParam)i) : nullptr);
+            size_t valueLength = (text ? 1 + text->length() : setting.type == SETTING_UINT16 ? 2 : 1);
+
+            if (pos + 2 + keyLength + valueLength > size || (text && text->length() > 0xFF))
+                return 0;
+
+            blob[pos++] = keyLength;
+            memcpy(&blob[pos], setting.key, keyLength);
+            pos += keyLength;
+            blob[pos++] = setting.type;
+
+            if (text) {
+                blob[pos++] = text->length();
+                memcpy(&blob[pos], text->c_str(), text->length());
+                pos += text->length();
+            } else {
+                uint32_t value = getNumber((ClockwiseParam)i);
+                blob[pos++] = value & 0xFF;
+                if (setting.type == SETTING_UINT16)
+                    blob[pos++] = value >> 8;
+            }
+        }
+
+        size_t bodyLength = pos - SETTINGS_BLOB_HEADER_SIZE;
+        uint32_t crc = settingsCrc32(&blob[SETTINGS_BLOB_HEADER_SIZE], bodyLength);
+
+        blob[0] = SETTINGS_BLOB_VERSION;
+        blob[1] = PARAM_COUNT;
+        blob[2] = bodyLength & 0xFF;
+        blob[3] = bodyLength >> 8;
+        for (uint8_t i = 0; i < 4; i++)
+            blob[4 + i] = crc >> (8 * i);
+
+        return pos;
+    }
+
+    // Settings missing from the blob (or out of range) keep their default. A blob that is
+    // truncated, fails the CRC or has an unknown layout leaves everything at the defaults.
+    bool deserialize(const uint8_t *blob, size_t length)
+    {
+        setDefaults();
+
+        if (length < SETTINGS_BLOB_HEADER_SIZE || blob[0] != SETTINGS_BLOB_VERSION)
+            return false;
+
+        size_t bodyLength = blob[2] | (blob[3] << 8);
+        uint32_t crc = blob[4] | (blob[5] << 8) | (blob[6] << 16) | ((uint32_t)blob[7] << 24);
+        if (bodyLength != length - SETTINGS_BLOB_HEADER_SIZE || crc != settingsCrc32(&blob[SETTINGS_BLOB_HEADER_SIZE], bodyLength))
+            return false;
+
+        size_t pos = SETTINGS_BLOB_HEADER_SIZE;
+        for (uint8_t entry = 0; entry < blob[1]; entry++)
+        {
+            if (pos + 1 > length || pos + 1 + blob[pos] + 2 > length)
+                break;
+
+            char key[16] = {0};
+            uint8_t keyLength = blob[pos++];
+            if (keyLength < sizeof(key))
+                memcpy(key, &blob[pos], keyLength);
+            pos += keyLength;
+
+            uint8_t type = blob[pos++];
+            size_t valueLength = (type == SETTING_STRING ? 1 + blob[pos] : type == SETTING_UINT16 ? 2 : 1);
+            if (pos + valueLength > length)
+                break;
+
+            ClockwiseParam param = findSetting(key);
+            if (param != PARAM_COUNT && describe(param).type == type)
+            {
+                if (type == SETTING_STRING) {
+                    String value;
+                    value.reserve(blob[pos]);
+                    for (uint8_t i = 0; i < blob[pos]; i++)
+                        value += (char)blob[pos + 1 + i];
+                    set(param, value);
+                } else {
+                    set(param, (uint32_t)(type == SETTING_UINT16 ? blob[pos] | (blob[pos + 1] << 8) : blob[pos]));
+                }
+            }
+            pos += valueLength;
+        }
+
+        if (pos != length)
+        {
+            setDefaults();
+            return false;
+        }
+        return true;
+    }
+
+    // Settings used to be stored one NVS key each
+    bool readLegacy()
+    {
+        bool found = false;
+
+        for (uint8_t i = 0; i < PARAM_COUNT; i++)
+        {
+            const SettingDescriptor &setting = describe((ClockwiseParam)i);
+            void *field = fieldOf((ClockwiseParam)i);
+
+            if (!preferences.isKey(setting.key))
+                continue;
+
+            found = true;
+            switch (setting.type)
+            {
+                case SETTING_BOOL: *(bool *)field = preferences.getBool(setting.key, setting.defaultNumber); break;
+                case SETTING_UINT8: *(uint8_t *)field = preferences.getUInt(setting.key, setting.defaultNumber); break;
+                case SETTING_UINT16: *(uint16_t *)field = preferences.getUInt(setting.key, setting.defaultNumber); break;
+                case SETTING_STRING: *(String *)field = preferences.getString(setting.key, setting.defaultText); break;
+            }
+        }
+        return found;
+    }
+
+    void removeLegacy()
+    {
+        for (uint8_t i = 0; i < PARAM_COUNT; i++)
+        {
+            if (preferences.isKey(describe((ClockwiseParam)i).key))
+                preferences.remove(describe((ClockwiseParam)i).key);
+        }
+    }
+
+    // Writes all settings as one blob, NVS replaces it atomically
+    bool write()
+    {
+        uint8_t blob[SETTINGS_BLOB_MAX_SIZE];
+        size_t length = serialize(blob, sizeof(blob));
+
+        return (length > 0 && preferences.putBytes(CW_PREF_BLOB_KEY, blob, length) == length);
+    }
+
+    // Writes the settings if any changed since the last save
     void save()
     {
-        preferences.putBool(PREF_SWAP_BLUE_GREEN, swapBlueGreen);
-        preferences.putBool(PREF_USE_24H_FORMAT, use24hFormat);
-        preferences.putUInt(PREF_DISPLAY_BRIGHT, displayBright);
-        preferences.putUInt(PREF_DISPLAY_ABC_MIN, autoBrightMin);
-        preferences.putUInt(PREF_DISPLAY_ABC_MAX, autoBrightMax);
-        preferences.putUInt(PREF_LDR_PIN, ldrPin);        
-        preferences.putString(PREF_TIME_ZONE, timeZone);
-        preferences.putString(PREF_WIFI_SSID, wifiSsid);
-        preferences.putString(PREF_WIFI_PASSWORD, wifiPwd);
-        preferences.putString(PREF_NTP_SERVER, ntpServer);
-        preferences.putString(PREF_CANVAS_FILE, canvasFile);
-        preferences.putString(PREF_CANVAS_SERVER, canvasServer);
-        preferences.putString(PREF_MANUAL_POSIX, manualPosix);
-        preferences.putUInt(PREF_DISPLAY_ROTATION, displayRotation);
+        if (dirty != 0 && !write())
+            return;
+
+        dirty = 0;
+        commitPending = false;
+    }
+
+    // Coalesces bursts of changes (e.g. a script adjusting the brightness) into one write
+    void saveLater(unsigned long delayMs = CW_PREF_COMMIT_DELAY)
+    {
+        if (dirty == 0)
+            return;
+
+        commitPending = true;
+        commitAt = millis() + delayMs;
+    }
+
+    // Called from the main loop to write deferred changes once they are due
+    void handle()
+    {
+        if (commitPending && (long)(millis() - commitAt) >= 0)
+            save();
     }
 
     void load()
     {
-        swapBlueGreen = preferences.getBool(PREF_SWAP_BLUE_GREEN, false);
-        use24hFormat = preferences.getBool(PREF_USE_24H_FORMAT, true);
-        displayBright = preferences.getUInt(PREF_DISPLAY_BRIGHT, 32);
-        autoBrightMin = preferences.getUInt(PREF_DISPLAY_ABC_MIN, 0);
-        autoBrightMax = preferences.getUInt(PREF_DISPLAY_ABC_MAX, 0);
-        ldrPin = preferences.getUInt(PREF_LDR_PIN, 35);        
-        timeZone = preferences.getString(PREF_TIME_ZONE, "America/Sao_Paulo");
-        wifiSsid = preferences.getString(PREF_WIFI_SSID, "");
-        wifiPwd = preferences.getString(PREF_WIFI_PASSWORD, "");
-        ntpServer = preferences.getString(PREF_NTP_SERVER, "time.google.com");
-        canvasFile = preferences.getString(PREF_CANVAS_FILE, "");
-        canvasServer = preferences.getString(PREF_CANVAS_SERVER, "raw.githubusercontent.com");
-        manualPosix = preferences.getString(PREF_MANUAL_POSIX, "");
-        displayRotation = preferences.getUInt(PREF_DISPLAY_ROTATION, 0);
+        if (loaded)
+            return;
+
+        reload();
+    }
+
+    void reload()
+    {
+        size_t length = preferences.getBytesLength(CW_PREF_BLOB_KEY);
+
+        if (length > 0)
+        {
+            uint8_t blob[SETTINGS_BLOB_MAX_SIZE];
+            if (length > sizeof(blob) || preferences.getBytes(CW_PREF_BLOB_KEY, blob, length) != length || !deserialize(blob, length))
+            {
+                Serial.println("[Settings] Stored settings are corrupted, using defaults");
+                setDefaults();
+            }
+        }
+        else
+        {
+            setDefaults();
+            if (readLegacy() && write())
+            {
+                removeLegacy();
+                Serial.println("[Settings] Migrated settings to a single blob");
+            }
+        }
+
+        loaded = true;
+        dirty = 0;
+        commitPending = false;
     }
 
 };
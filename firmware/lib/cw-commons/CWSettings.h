@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+enum SettingType : uint8_t
+{
+    SETTING_BOOL,
+    SETTING_UINT8,
+    SETTING_UINT16,
+    SETTING_STRING
+};
+
+// Flags
+const uint8_t SETTING_SECRET = 0x01;  // never reported by /get
+const uint8_t SETTING_LIVE = 0x02;    // applied right away by its change hook, the others need a restart
+
+// Every setting is declared once here:
+// X(id, field, key, type, default, min, max, flags)
+// key is both the NVS key (15 chars max) and the /set parameter, max is the max length for strings
+#define CW_SETTINGS(X) \
+    X(SWAP_BLUE_GREEN,  swapBlueGreen,   "swapBlueGreen",   BOOL,   false,                       0, 1,    0) \
+    X(USE_24H_FORMAT,   use24hFormat,    "use24hFormat",    BOOL,   true,                        0, 1,    0) \
+    X(DISPLAY_BRIGHT,   displayBright,   "displayBright",   UINT8,  32,                          0, 255,  SETTING_LIVE) \
+    X(DISPLAY_ABC_MIN,  autoBrightMin,   "autoBrightMin",   UINT16, 0,                           0, 4095, SETTING_LIVE) \
+    X(DISPLAY_ABC_MAX,  autoBrightMax,   "autoBrightMax",   UINT16, 0,                           0, 4095, SETTING_LIVE) \
+    X(LDR_PIN,          ldrPin,          "ldrPin",          UINT8,  35,                          0, 39,   0) \
+    X(TIME_ZONE,        timeZone,        "timeZone",        STRING, "America/Sao_Paulo",         0, 64,   0) \
+    X(WIFI_SSID,        wifiSsid,        "wifiSsid",        STRING, "",                          0, 32,   0) \
+    X(WIFI_PASSWORD,    wifiPwd,         "wifiPwd",         STRING, "",                          0, 64,   SETTING_SECRET) \
+    X(NTP_SERVER,       ntpServer,       "ntpServer",       STRING, "time.google.com",           0, 64,   0) \
+    X(CANVAS_FILE,      canvasFile,      "canvasFile",      STRING, "",                          0, 24,   0) \
+    X(CANVAS_SERVER,    canvasServer,    "canvasServer",    STRING, "raw.githubusercontent.com", 0, 64,   0) \
+    X(CANVAS_REFRESH,   canvasRefresh,   "canvasRefresh",   UINT16, 60,                          0, 1440, SETTING_LIVE) \
+    X(CANVAS_PLAYLIST,  canvasPlaylist,  "canvasPlaylist",  STRING, "",                          0, 128,  SETTING_LIVE) \
+    X(CANVAS_ROTATE,    canvasRotate,    "canvasRotate",    UINT16, 0,                           0, 1440, SETTING_LIVE) \
+    X(MANUAL_POSIX,     manualPosix,     "manualPosix",     STRING, "",                          0, 64,   0) \
+    X(DISPLAY_ROTATION, displayRotation, "displayRotation", UINT8,  0,                           0, 3,    0)
+
+enum ClockwiseParam : uint8_t
+{
+#define SETTING_ENUM(id, field, key, type, def, min, max, flags) PARAM_##id,
+    CW_SETTINGS(SETTING_ENUM)
+#undef SETTING_ENUM
+    PARAM_COUNT
+};
+
+static_assert(PARAM_COUNT <= 32, "Dirty bits are kept in a uint32_t");
+
+struct SettingDescriptor
+{
+    const char *key;
+    SettingType type;
+    uint32_t defaultNumber;
+    const char *defaultText;
+    uint32_t min;
+    uint32_t max;
+    uint8_t flags;
+};
+
+// Lets the default column hold either a number or a string
+constexpr uint32_t settingNumber(int value) { return value; }
+constexpr uint32_t settingNumber(const char *) { return 0; }
+constexpr const char *settingText(int) { return nullptr; }
+constexpr const char *settingText(const char *value) { return value; }
+
+constexpr SettingDescriptor SETTINGS[] = {
+#define SETTING_DESCRIPTOR(id, field, key, type, def, min, max, flags) \
+    {key, SETTING_##type, settingNumber(def), settingText(def), min, max, flags},
+    CW_SETTINGS(SETTING_DESCRIPTOR)
+#undef SETTING_DESCRIPTOR
+};
+
+
+// Key lookup uses a perfect hash built by the compiler: FNV-1a with the first seed that
+// puts every key in its own slot, so a lookup is one hash and one strcmp.
+const uint8_t SETTINGS_HASH_SIZE = 64;
+const uint32_t SETTINGS_HASH_MAX_SEED = 4096;
+
+constexpr uint32_t settingHash(const char *key, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    while (*key)
+    {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+struct SettingsHash
+{
+    uint32_t seed;
+    uint8_t slots[SETTINGS_HASH_SIZE];  // setting index + 1, 0 for an empty slot
+};
+
+constexpr SettingsHash buildSettingsHash()
+{
+    for (uint32_t seed = 0; seed < SETTINGS_HASH_MAX_SEED; seed++)
+    {
+        SettingsHash table = {seed, {0}};
+        bool collision = false;
+
+        for (uint8_t i = 0; i < PARAM_COUNT && !collision; i++)
+        {
+            uint8_t slot = settingHash(SETTINGS[i].key, seed) % SETTINGS_HASH_SIZE;
+            if (table.slots[slot] != 0)
+                collision = true;
+            else
+                table.slots[slot] = i + 1;
+        }
+
+        if (!collision)
+            return table;
+    }
+    return {SETTINGS_HASH_MAX_SEED, {0}};
+}
+
+constexpr SettingsHash SETTINGS_HASH = buildSettingsHash();
+static_assert(SETTINGS_HASH.seed < SETTINGS_HASH_MAX_SEED, "No perfect hash for the setting keys, increase SETTINGS_HASH_SIZE");
+
+// Returns PARAM_COUNT when the key is unknown
+inline ClockwiseParam findSetting(const char *key)
+{
+    uint8_t index = SETTINGS_HASH.slots[settingHash(key, SETTINGS_HASH.seed) % SETTINGS_HASH_SIZE];
+
+    if (index == 0 || strcmp(SETTINGS[index - 1].key, key) != 0)
+        return PARAM_COUNT;
+
+    return (ClockwiseParam)(index - 1);
+}
@@ -4,6 +4,12 @@
 #include <CWPreferences.h>
 #include "StatusController.h"
 #include "SettingsWebPage.h"
+#include "MirrorWebPage.h"
+#include "CWMirror.h"
+#include "CWFramePush.h"
+#include "CWMetrics.h"
+#include "CWCanvasStore.h"
+#include "CWCanvasRefresh.h"
 
 #ifndef CLOCKFACE_NAME
   #define CLOCKFACE_NAME "UNKNOWN"
@@ -11,6 +17,14 @@
 
 WiFiServer server(80);
 
+struct HttpRequestHeaders
+{
+  int32_t contentLength = -1;
+  String contentType;
+  String rect;
+  uint16_t ttl = 0;
+};
+
 struct ClockwiseWebServer
 {
   String httpBuffer;
@@ -37,13 +51,16 @@ struct ClockwiseWebServer
 
   void handleHttpRequest()
   {
-    if (force_restart)
+    if (force_restart) {
+      ClockwiseParams::getInstance()->save();
       StatusController::getInstance()->forceRestart();
+    }
 
 
     WiFiClient client = server.available();
     if (client)
     {
+      unsigned long start = micros();
       StatusController::getInstance()->blink_led(100, 1);
 
       while (client.connected())
@@ -78,6 +95,7 @@ struct ClockwiseWebServer
       }
       delay(1);
       client.stop();
+      ClockwiseMetrics::getInstance()->recordHttpRequest(micros() - start);
     }
   }
 
@@ -88,56 +106,169 @@ struct ClockwiseWebServer
       client.println("Content-Type: text/html");
       client.println();
       client.println(SETTINGS_PAGE);
+    } else if (method == "GET" && path == "/mirror") {
+      client.println("HTTP/1.0 200 OK");
+      client.println("Content-Type: text/html");
+      client.println();
+      client.println(MIRROR_PAGE);
+    } else if (method == "GET" && path == "/mirror/stream") {
+      client.println("HTTP/1.1 200 OK");
+      client.println("Content-Type: text/event-stream");
+      client.println("Cache-Control: no-cache");
+      client.println("Connection: keep-alive");
+      client.println();
+      ClockwiseMirror::getInstance()->attach(client, (key == "fps" ? value.toInt() : 0));
+    } else if (method == "GET" && path == "/metrics") {
+      client.println("HTTP/1.0 200 OK");
+      client.println("Content-Type: text/plain; version=0.0.4");
+      client.println();
+      ClockwiseMetrics::getInstance()->print(client);
     } else if (method == "GET" && path == "/get") {
       getCurrentSettings(client);
     } else if (method == "GET" && path == "/read") {
       if (key == "pin") {
         readPin(client, key, value.toInt());
       }
+    } else if (method == "POST" && path == "/push") {
+      pushFrame(client);
+    } else if (method == "POST" && path == "/canvas/refresh") {
+      ClockwiseCanvasRefresh::getInstance()->request();
+      client.println("HTTP/1.0 202 Accepted");
+    } else if (method == "POST" && path == "/canvas") {
+      uploadCanvas(client, (key == "name" ? value : ClockwiseParams::getInstance()->canvasFile));
+    } else if (method == "POST" && path == "/canvas/bundle") {
+      uploadCanvas(client, (key == "name" ? value : ClockwiseParams::getInstance()->canvasFile), true);
     } else if (method == "POST" && path == "/restart") {
       client.println("HTTP/1.0 204 No Content");
       force_restart = true;
     } else if (method == "POST" && path == "/set") {
-      ClockwiseParams::getInstance()->load();
-      //a baby seal has died due this ifs
-      if (key == ClockwiseParams::getInstance()->PREF_DISPLAY_BRIGHT) {
-        ClockwiseParams::getInstance()->displayBright = value.toInt();
-      } else if (key == ClockwiseParams::getInstance()->PREF_WIFI_SSID) {
-        ClockwiseParams::getInstance()->wifiSsid = value;
-      } else if (key == ClockwiseParams::getInstance()->PREF_WIFI_PASSWORD) {
-        ClockwiseParams::getInstance()->wifiPwd = value;
-      } else if (key == "autoBright") {   //autoBright=0010,0800
-        ClockwiseParams::getInstance()->autoBrightMin = value.substring(0,4).toInt();
-        ClockwiseParams::getInstance()->autoBrightMax = value.substring(5,9).toInt();
-      } else if (key == ClockwiseParams::getInstance()->PREF_SWAP_BLUE_GREEN) {
-        ClockwiseParams::getInstance()->swapBlueGreen = (value == "1");
-      } else if (key == ClockwiseParams::getInstance()->PREF_USE_24H_FORMAT) {
-        ClockwiseParams::getInstance()->use24hFormat = (value == "1");
-      } else if (key == ClockwiseParams::getInstance()->PREF_LDR_PIN) {
-        ClockwiseParams::getInstance()->ldrPin = value.toInt();
-      } else if (key == ClockwiseParams::getInstance()->PREF_TIME_ZONE) {
-        ClockwiseParams::getInstance()->timeZone = value;
-      } else if (key == ClockwiseParams::getInstance()->PREF_NTP_SERVER) {
-        ClockwiseParams::getInstance()->ntpServer = value;
-      } else if (key == ClockwiseParams::getInstance()->PREF_CANVAS_FILE) {
-        ClockwiseParams::getInstance()->canvasFile = value;
-      } else if (key == ClockwiseParams::getInstance()->PREF_CANVAS_SERVER) {
-        ClockwiseParams::getInstance()->canvasServer = value;
-      } else if (key == ClockwiseParams::getInstance()->PREF_MANUAL_POSIX) {
-        ClockwiseParams::getInstance()->manualPosix = value;
-      } else if (key == ClockwiseParams::getInstance()->PREF_DISPLAY_ROTATION) {
-        ClockwiseParams::getInstance()->displayRotation = value.toInt();
+      bool valid;
+      if (key == "autoBright") {   //autoBright=0010,0800
+        valid = ClockwiseParams::getInstance()->parse(PARAM_DISPLAY_ABC_MIN, value.substring(0,4));
+        valid &= ClockwiseParams::getInstance()->parse(PARAM_DISPLAY_ABC_MAX, value.substring(5,9));
+      } else {
+        valid = ClockwiseParams::getInstance()->parse(findSetting(key.c_str()), value);
       }
-      ClockwiseParams::getInstance()->save();
+
+      if (!valid) {
+        client.println("HTTP/1.0 400 Bad Request");
+        return;
+      }
+      ClockwiseParams::getInstance()->saveLater();
       client.println("HTTP/1.0 204 No Content");
     }
   }
 
 
 
-  void readPin(WiFiClient client, String key, uint16_t pin) {
-    ClockwiseParams::getInstance()->load();
+  // Consumes the request headers, keeping only the ones used by the endpoints
+  void readHeaders(WiFiClient &client, HttpRequestHeaders &headers)
+  {
+    while (client.connected())
+    {
+      String line = client.readStringUntil('\n');
+      line.trim();
+      if (line.isEmpty())
+        break;
+
+      int sep = line.indexOf(':');
+      if (sep < 0)
+        continue;
+
+      String name = line.substring(0, sep);
+      String value = line.substring(sep + 1);
+      name.toLowerCase();
+      value.trim();
+
+      if (name == "content-length") {
+        headers.contentLength = value.toInt();
+      } else if (name == "content-type") {
+        headers.contentType = value;
+      } else if (name == "x-rect") {
+        headers.rect = value;
+      } else if (name == "x-ttl") {
+        headers.ttl = value.toInt();
+      }
+    }
+  }
+
+  //X-Rect: x,y,w,h (full frame when missing), X-TTL: seconds
+  void pushFrame(WiFiClient client)
+  {
+    HttpRequestHeaders headers;
+    readHeaders(client, headers);
+
+    PushRequest req;
+    req.format = (headers.contentType == "image/png" ? PUSH_PNG : PUSH_RGB565);
+    req.contentLength = headers.contentLength;
+    req.ttl = headers.ttl;
+    req.x = 0;
+    req.y = 0;
+    req.w = DISPLAY_WIDTH;
+    req.h = DISPLAY_HEIGHT;
 
+    if (!headers.rect.isEmpty())
+    {
+      int rect[4] = {0};
+      int start = 0;
+      uint8_t fields = 0;
+      while (fields < 4 && start >= 0)
+      {
+        int end = headers.rect.indexOf(',', start);
+        rect[fields++] = headers.rect.substring(start, (end < 0 ? headers.rect.length() : end)).toInt();
+        start = (end < 0 ? -1 : end + 1);
+      }
+
+      // Checked while still int, a value past 255 or below 0 would wrap into the panel
+      if (fields != 4 || start >= 0 || rect[0] < 0 || rect[1] < 0 || rect[2] <= 0 || rect[3] <= 0 ||
+          rect[0] + rect[2] > DISPLAY_WIDTH || rect[1] + rect[3] > DISPLAY_HEIGHT)
+      {
+        client.println("HTTP/1.0 400 Bad Request");
+        client.println();
+        return;
+      }
+
+      req.x = rect[0];
+      req.y = rect[1];
+      req.w = rect[2];
+      req.h = rect[3];
+    }
+
+    uint16_t status = ClockwiseFramePush::getInstance()->accept(client, req);
+    if (status != 0)
+    {
+      client.printf("HTTP/1.0 %d %s\r\n", status, (status == 409 ? "Conflict" : status == 400 ? "Bad Request" : "Service Unavailable"));
+      client.println();
+    }
+  }
+
+  //POST /canvas?name=<file> (current canvasFile when missing), body is the canvas JSON
+  //POST /canvas/bundle?name=<file>, body is a bundle made by the canvas bundler
+  void uploadCanvas(WiFiClient client, String name, bool bundle = false)
+  {
+    HttpRequestHeaders headers;
+    readHeaders(client, headers);
+
+    String error;
+    uint16_t status = ClockwiseCanvasStore::getInstance()->receive(client, name, headers.contentLength, error, bundle);
+
+    if (status == 201) {
+      client.println("HTTP/1.0 201 Created");
+      client.println();
+
+      // The current canvas is replaced without a restart
+      if (ClockwiseCanvasRefresh::getInstance()->isCurrent(name))
+        ClockwiseCanvasRefresh::getInstance()->request(true);
+    } else {
+      client.printf("HTTP/1.0 %d Error\r\n", status);
+      client.println("Content-Type: text/plain");
+      client.println();
+      client.println(error);
+      Serial.printf("[Canvas] Upload of '%s' refused: %s\n", name.c_str(), error.c_str());
+    }
+  }
+
+  void readPin(WiFiClient client, String key, uint16_t pin) {
     client.println("HTTP/1.0 204 No Content");
     client.printf(HEADER_TEMPLATE_D, key, analogRead(pin));
     
@@ -146,23 +277,13 @@ struct ClockwiseWebServer
 
 
   void getCurrentSettings(WiFiClient client) {
-    ClockwiseParams::getInstance()->load();
-
     client.println("HTTP/1.0 204 No Content");
 
-    client.printf(HEADER_TEMPLATE_D, ClockwiseParams::getInstance()->PREF_DISPLAY_BRIGHT, ClockwiseParams::getInstance()->displayBright);
-    client.printf(HEADER_TEMPLATE_D, ClockwiseParams::getInstance()->PREF_DISPLAY_ABC_MIN, ClockwiseParams::getInstance()->autoBrightMin);
-    client.printf(HEADER_TEMPLATE_D, ClockwiseParams::getInstance()->PREF_DISPLAY_ABC_MAX, ClockwiseParams::getInstance()->autoBrightMax);
-    client.printf(HEADER_TEMPLATE_D, ClockwiseParams::getInstance()->PREF_SWAP_BLUE_GREEN, ClockwiseParams::getInstance()->swapBlueGreen);
-    client.printf(HEADER_TEMPLATE_D, ClockwiseParams::getInstance()->PREF_USE_24H_FORMAT, ClockwiseParams::getInstance()->use24hFormat);
-    client.printf(HEADER_TEMPLATE_D, ClockwiseParams::getInstance()->PREF_LDR_PIN, ClockwiseParams::getInstance()->ldrPin);    
-    client.printf(HEADER_TEMPLATE_S, ClockwiseParams::getInstance()->PREF_TIME_ZONE, ClockwiseParams::getInstance()->timeZone.c_str());
-    client.printf(HEADER_TEMPLATE_S, ClockwiseParams::getInstance()->PREF_WIFI_SSID, ClockwiseParams::getInstance()->wifiSsid.c_str());
-    client.printf(HEADER_TEMPLATE_S, ClockwiseParams::getInstance()->PREF_NTP_SERVER, ClockwiseParams::getInstance()->ntpServer.c_str());
-    client.printf(HEADER_TEMPLATE_S, ClockwiseParams::getInstance()->PREF_CANVAS_FILE, ClockwiseParams::getInstance()->canvasFile.c_str());
-    client.printf(HEADER_TEMPLATE_S, ClockwiseParams::getInstance()->PREF_CANVAS_SERVER, ClockwiseParams::getInstance()->canvasServer.c_str());
-    client.printf(HEADER_TEMPLATE_S, ClockwiseParams::getInstance()->PREF_MANUAL_POSIX, ClockwiseParams::getInstance()->manualPosix.c_str());
-    client.printf(HEADER_TEMPLATE_D, ClockwiseParams::getInstance()->PREF_DISPLAY_ROTATION, ClockwiseParams::getInstance()->displayRotation);
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+      ClockwiseParam param = (ClockwiseParam)i;
+      if (!(SETTINGS[i].flags & SETTING_SECRET))
+        client.printf(HEADER_TEMPLATE_S, SETTINGS[i].key, ClockwiseParams::getInstance()->toString(param).c_str());
+    }
 
     client.printf(HEADER_TEMPLATE_S, "CW_FW_VERSION", CW_FW_VERSION);
     client.printf(HEADER_TEMPLATE_S, "CW_FW_NAME", CW_FW_NAME);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+
+const char MIRROR_PAGE[] PROGMEM = R""""(
+<!DOCTYPE html>
+<html>
+<title>Clockwise Mirror</title>
+<meta name="viewport" content="width=device-width, initial-scale=1">
+<style>
+  body { background: #222; color: #ccc; font-family: sans-serif; text-align: center; }
+  canvas { width: 384px; height: 384px; image-rendering: pixelated; background: #000; margin-top: 16px; }
+</style>
+<body>
+  <canvas id="panel" width="64" height="64"></canvas>
+  <p id="status">Connecting...</p>
+<script>
+  const ctx = document.getElementById("panel").getContext("2d");
+  const img = ctx.createImageData(64, 64);
+  const fps = new URLSearchParams(location.search).get("fps") || 5;
+  const source = new EventSource("/mirror/stream?fps=" + fps);
+
+  function draw(e) {
+    const raw = Uint8Array.from(atob(e.data), c => c.charCodeAt(0));
+    let i = 0;
+    while (i < raw.length) {
+      const x = raw[i], y = raw[i + 1], w = raw[i + 2], h = raw[i + 3];
+      i += 4;
+      let p = 0;
+      while (p < w * h) {
+        const count = raw[i], color = raw[i + 1] | (raw[i + 2] << 8);
+        i += 3;
+        for (let n = 0; n < count; n++, p++) {
+          const o = ((y + Math.floor(p / w)) * 64 + x + (p % w)) * 4;
+          img.data[o] = ((color >> 11) & 0x1F) << 3;
+          img.data[o + 1] = ((color >> 5) & 0x3F) << 2;
+          img.data[o + 2] = (color & 0x1F) << 3;
+          img.data[o + 3] = 255;
+        }
+      }
+    }
+    ctx.putImageData(img, 0, 0);
+  }
+
+  source.addEventListener("key", e => { document.getElementById("status").innerText = "Live"; draw(e); });
+  source.addEventListener("delta", draw);
+  source.onerror = () => document.getElementById("status").innerText = "Disconnected";
+</script>
+</body>
+</html>
+)"""";
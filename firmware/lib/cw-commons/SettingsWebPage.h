@@ -129,6 +129,33 @@ const char SETTINGS_PAGE[] PROGMEM = R""""(
           property: "canvasServer",
           exclusive: "cw-cf-0x07"
         },
+        {
+          title: "[Canvas] Refresh interval",
+          description: "Minutes between checks for an updated description file on the server, applied without restarting. Use 0 to only check at startup. default: 60 | <a href='#' onclick='refreshCanvas();'>Refresh now</a>",
+          formInput: "<input id='canvasRefresh' class='w3-input w3-light-grey' name='canvasRefresh' type='number' min='0' max='1440' value='" + settings.canvasrefresh + "'>",
+          icon: "fa-refresh",
+          save: "updatePreference('canvasRefresh', canvasRefresh.value)",
+          property: "canvasRefresh",
+          exclusive: "cw-cf-0x07"
+        },
+        {
+          title: "[Canvas] Playlist",
+          description: "Description files to cycle through, separated by commas (e.g. \"vespa,snoopy\"). The next one is loaded while the current one is shown. Leave empty to always show the description file above.",
+          formInput: "<input id='canvasPlaylist' class='w3-input w3-light-grey' name='canvasPlaylist' type='text' placeholder='Playlist' value='" + settings.canvasplaylist + "'>",
+          icon: "fa-list",
+          save: "updatePreference('canvasPlaylist', canvasPlaylist.value)",
+          property: "canvasPlaylist",
+          exclusive: "cw-cf-0x07"
+        },
+        {
+          title: "[Canvas] Playlist rotation",
+          description: "Minutes each canvas of the playlist is shown, counted from midnight (60 switches on the hour). Use 0 to stay on the current one. default: 0",
+          formInput: "<input id='canvasRotate' class='w3-input w3-light-grey' name='canvasRotate' type='number' min='0' max='1440' value='" + settings.canvasrotate + "'>",
+          icon: "fa-random",
+          save: "updatePreference('canvasRotate', canvasRotate.value)",
+          property: "canvasRotate",
+          exclusive: "cw-cf-0x07"
+        },
         {
           title: "Posix Timezone String",
           description: "To avoid remote lookups, provide a Posix string that corresponds to your timezone. Leave empty to obtain this automatically from the server. <a href=\"https://github.com/nayarsystems/posix_tz_db/blob/master/zones.csv\">Click here for a list.</a>",
@@ -230,6 +257,12 @@ const char SETTINGS_PAGE[] PROGMEM = R""""(
       xhr.send();
     }
 
+    function refreshCanvas() {
+      const xhr = new XMLHttpRequest();
+      xhr.open('POST', '/canvas/refresh');
+      xhr.send();
+    }
+
     function resetwifi() {
       var domanda = confirm("Reset WiFi configuration. Are you sure?");
       if (domanda === true) {
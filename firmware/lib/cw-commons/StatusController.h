@@ -167,11 +167,8 @@ struct StatusController
 	{
 		int16_t x1, y1;
 		uint16_t w, h;
-		Locator::getDisplay()->setFont(&Picopixel);
-		Locator::getDisplay()->getTextBounds(buf, 0, y, &x1, &y1, &w, &h);
-		Locator::getDisplay()->setCursor(32 - (w / 2), y);
-		Locator::getDisplay()->setTextColor(0xffff);
-		Locator::getDisplay()->print(buf);
+		Locator::getGlyphCache()->getTextBounds(Locator::getDisplay(), &Picopixel, buf, 0, y, &x1, &y1, &w, &h);
+		Locator::getGlyphCache()->print(Locator::getDisplay(), &Picopixel, buf, 32 - (w / 2), y, 0xffff);
 	}
 
 	void blink_led(int d, int times)
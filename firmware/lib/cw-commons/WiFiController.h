@@ -23,8 +23,8 @@ struct WiFiController
   static void onImprovWiFiConnectedCb(const char *ssid, const char *password)
   {
     ClockwiseParams::getInstance()->load();
-    ClockwiseParams::getInstance()->wifiSsid = String(ssid);
-    ClockwiseParams::getInstance()->wifiPwd = String(password);
+    ClockwiseParams::getInstance()->set(PARAM_WIFI_SSID, String(ssid));
+    ClockwiseParams::getInstance()->set(PARAM_WIFI_PASSWORD, String(password));
     ClockwiseParams::getInstance()->save();
 
     ClockwiseWebServer::getInstance()->startWebServer();
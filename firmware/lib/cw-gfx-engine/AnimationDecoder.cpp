@@ -0,0 +1,585 @@
+#include "AnimationDecoder.h"
+#include <PNGdec.h>
+
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static const uint16_t LZW_MAX_CODES = 4096;
+
+uint32_t AnimationDecoder::readBE32(const uint8_t* bytes) {
+  return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+uint16_t AnimationDecoder::readLE16(const uint8_t* bytes) {
+  return bytes[0] | (bytes[1] << 8);
+}
+
+uint16_t AnimationDecoder::toRGB565(const uint8_t* rgb) {
+  return ((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3);
+}
+
+bool AnimationDecoder::isAnimation(const uint8_t* data, size_t length) {
+  if (length >= 6 && (memcmp(data, "GIF87a", 6) == 0 || memcmp(data, "GIF89a", 6) == 0))
+    return true;
+
+  // An APNG has an acTL before its first IDAT
+  if (length < sizeof(PNG_SIGNATURE) || memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0)
+    return false;
+
+  for (size_t position = sizeof(PNG_SIGNATURE); position + 8 <= length;) {
+    uint32_t size = readBE32(&data[position]);
+    if (memcmp(&data[position + 4], "acTL", 4) == 0)
+      return true;
+    if (memcmp(&data[position + 4], "IDAT", 4) == 0 || size > length)
+      return false;
+    position += size + 12;
+  }
+  return false;
+}
+
+bool AnimationDecoder::open(const uint8_t* data, size_t length, PNG* png, std::vector<uint16_t>* delays) {
+  close();
+  _data = data;
+  _length = length;
+  _png = png;
+
+  if (length >= 6 && memcmp(data, "GIF", 3) == 0)
+    _format = FORMAT_GIF;
+  else if (length >= sizeof(PNG_SIGNATURE) && memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)
+    _format = FORMAT_APNG;
+
+  if (delays != nullptr)
+    delays->clear();
+
+  bool valid = (_format == FORMAT_GIF ? scanGif(delays) : _format == FORMAT_APNG ? scanPng(delays) : false);
+  if (!valid || _width == 0 || _height == 0) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void AnimationDecoder::close() {
+  _data = nullptr;
+  _length = 0;
+  _format = FORMAT_NONE;
+  _width = _height = 0;
+  _hasMask = false;
+  _first = true;
+  _disposal = DISPOSE_NONE;
+  _pixels = std::vector<uint16_t>();
+  _mask = std::vector<uint8_t>();
+  _previousPixels = std::vector<uint16_t>();
+  _previousMask = std::vector<uint8_t>();
+  _prefix = std::vector<uint16_t>();
+  _suffix = std::vector<uint8_t>();
+  _stack = std::vector<uint8_t>();
+}
+
+bool AnimationDecoder::next() {
+  // Opening only scans, so reading the frame count costs no memory
+  if (_pixels.empty()) {
+    _pixels.assign(_width * _height, 0);
+    _mask.assign(maskStride() * _height, 0);
+    if (_format == FORMAT_GIF) {
+      _prefix.resize(LZW_MAX_CODES);
+      _suffix.resize(LZW_MAX_CODES);
+      _stack.resize(LZW_MAX_CODES + 1);
+    }
+  }
+
+  return (_format == FORMAT_GIF ? nextGif() : _format == FORMAT_APNG ? nextPng() : false);
+}
+
+// Undoes what the previous frame asked for, then keeps the canvas when this one will
+// have to be undone the same way
+void AnimationDecoder::beginFrame(Region frame, Disposal disposal) {
+  if (!_first && _disposal == DISPOSE_BACKGROUND) {
+    for (uint16_t y = _region.y; y < _region.y + _region.height && y < _height; y++)
+      for (uint16_t x = _region.x; x < _region.x + _region.width && x < _width; x++)
+        clearPixel(x, y);
+  } else if (!_first && _disposal == DISPOSE_PREVIOUS && !_previousPixels.empty()) {
+    _pixels = _previousPixels;
+    _mask = _previousMask;
+  }
+
+  if (disposal == DISPOSE_PREVIOUS) {
+    _previousPixels = _pixels;
+    _previousMask = _mask;
+  }
+
+  _region = frame;
+  _disposal = disposal;
+  _first = false;
+}
+
+void AnimationDecoder::setPixel(uint16_t x, uint16_t y, uint16_t color) {
+  _pixels[y * _width + x] = color;
+  _mask[y * maskStride() + x / 8] |= (0x80 >> (x & 7));
+}
+
+void AnimationDecoder::clearPixel(uint16_t x, uint16_t y) {
+  _pixels[y * _width + x] = 0;
+  _mask[y * maskStride() + x / 8] &= ~(0x80 >> (x & 7));
+}
+
+// GIF
+
+bool AnimationDecoder::skipSubBlocks(size_t& position) {
+  while (position < _length) {
+    uint8_t size = _data[position++];
+    if (size == 0)
+      return true;
+    position += size;
+  }
+  return false;
+}
+
+bool AnimationDecoder::scanGif(std::vector<uint16_t>* delays) {
+  if (_length < 13)
+    return false;
+
+  uint16_t width = readLE16(&_data[6]);
+  uint16_t height = readLE16(&_data[8]);
+  uint8_t packed = _data[10];
+
+  if (width > UINT8_MAX || height > UINT8_MAX)
+    return false;
+
+  _width = width;
+  _height = height;
+  _position = 13;
+  _globalColors = 0;
+
+  if (packed & 0x80) {
+    _globalColors = 2 << (packed & 0x07);
+    if (_position + _globalColors * 3 > _length)
+      return false;
+
+    for (uint16_t i = 0; i < _globalColors; i++)
+      _globalPalette[i] = toRGB565(&_data[_position + i * 3]);
+    _position += _globalColors * 3;
+  }
+
+  uint16_t delay = 0;
+  uint16_t frames = 0;
+  size_t position = _position;
+
+  while (position < _length) {
+    uint8_t block = _data[position++];
+
+    if (block == 0x21 && position < _length) {
+      uint8_t label = _data[position++];
+      if (label == 0xF9 && position + 5 <= _length && _data[position] == 4) {
+        delay = readLE16(&_data[position + 2]) * 10;
+        _hasMask = _hasMask || (_data[position + 1] & 0x01);
+      }
+      if (!skipSubBlocks(position))
+        return false;
+    } else if (block == 0x2C && position + 10 <= _length) {
+      uint8_t imagePacked = _data[position + 8];
+      bool partial = (readLE16(&_data[position]) > 0 || readLE16(&_data[position + 2]) > 0 ||
+                      readLE16(&_data[position + 4]) < width || readLE16(&_data[position + 6]) < height);
+      _hasMask = _hasMask || partial;
+
+      position += 9;
+      if (imagePacked & 0x80)
+        position += (2 << (imagePacked & 0x07)) * 3;
+      position++;   // LZW minimum code size
+      if (!skipSubBlocks(position))
+        return false;
+
+      if (delays != nullptr)
+        delays->push_back(delay);
+      delay = 0;
+
+      if (++frames > CW_ANIMATION_MAX_FRAMES)
+        return false;
+    } else {
+      break;
+    }
+  }
+
+  return frames > 0;
+}
+
+bool AnimationDecoder::nextGif() {
+  Disposal disposal = DISPOSE_NONE;
+  int16_t transparent = -1;
+  uint16_t delay = 0;
+
+  while (_position < _length) {
+    uint8_t block = _data[_position++];
+
+    if (block == 0x21 && _position < _length) {
+      uint8_t label = _data[_position++];
+      if (label == 0xF9 && _position + 5 <= _length && _data[_position] == 4) {
+        uint8_t packed = _data[_position + 1];
+        uint8_t method = (packed >> 2) & 0x07;
+        disposal = (method == 2 ? DISPOSE_BACKGROUND : method == 3 ? DISPOSE_PREVIOUS : DISPOSE_NONE);
+        delay = readLE16(&_data[_position + 2]) * 10;
+        transparent = (packed & 0x01 ? _data[_position + 4] : -1);
+      }
+      if (!skipSubBlocks(_position))
+        return false;
+    } else if (block == 0x2C && _position + 10 <= _length) {
+      Region frame = {readLE16(&_data[_position]), readLE16(&_data[_position + 2]), readLE16(&_data[_position + 4]), readLE16(&_data[_position + 6])};
+      uint8_t packed = _data[_position + 8];
+      _position += 9;
+
+      uint16_t localPalette[256];
+      const uint16_t* palette = _globalPalette;
+      uint16_t colors = _globalColors;
+
+      if (packed & 0x80) {
+        colors = 2 << (packed & 0x07);
+        if (_position + colors * 3 > _length)
+          return false;
+
+        for (uint16_t i = 0; i < colors; i++)
+          localPalette[i] = toRGB565(&_data[_position + i * 3]);
+        palette = localPalette;
+        _position += colors * 3;
+      }
+
+      beginFrame(frame, disposal);
+      _delay = delay;
+      return decodeGifImage(frame, palette, colors, transparent, packed & 0x40);
+    } else {
+      return false;
+    }
+  }
+  return false;
+}
+
+// Variable length codes, least significant bit first, split over data sub-blocks
+struct GifCodeReader {
+  const uint8_t* data;
+  size_t length;
+  size_t position;
+  uint8_t blockLeft = 0;
+  bool ended = false;
+  uint32_t bits = 0;
+  uint8_t bitCount = 0;
+
+  bool read(uint8_t size, uint16_t& code) {
+    while (bitCount < size) {
+      if (blockLeft == 0) {
+        if (position >= length || data[position] == 0) {
+          ended = true;
+          return false;
+        }
+        blockLeft = data[position++];
+      }
+      if (position >= length)
+        return false;
+
+      bits |= (uint32_t)data[position++] << bitCount;
+      bitCount += 8;
+      blockLeft--;
+    }
+
+    code = bits & ((1 << size) - 1);
+    bits >>= size;
+    bitCount -= size;
+    return true;
+  }
+};
+
+bool AnimationDecoder::decodeGifImage(Region frame, const uint16_t* palette, uint16_t colors, int16_t transparent, bool interlaced) {
+  static const uint8_t PASS_START[4] = {0, 4, 2, 1};
+  static const uint8_t PASS_STEP[4] = {8, 8, 4, 2};
+
+  if (_position >= _length)
+    return false;
+
+  uint8_t minimumSize = _data[_position++];
+  if (minimumSize < 2 || minimumSize > 11)
+    return false;
+
+  GifCodeReader reader = {_data, _length, _position};
+  uint16_t clear = 1 << minimumSize;
+  uint16_t end = clear + 1;
+  uint16_t nextCode = end + 1;
+  uint8_t codeSize = minimumSize + 1;
+  int32_t previous = -1;
+  uint8_t first = 0;
+
+  for (uint16_t i = 0; i < clear; i++) {
+    _prefix[i] = 0;
+    _suffix[i] = i;
+  }
+
+  uint32_t total = (uint32_t)frame.width * frame.height;
+  uint32_t written = 0;
+  uint16_t row = 0, column = 0;
+  uint8_t pass = 0;
+  uint16_t code;
+
+  while (written < total && reader.read(codeSize, code)) {
+    if (code == clear) {
+      codeSize = minimumSize + 1;
+      nextCode = end + 1;
+      previous = -1;
+      continue;
+    }
+    if (code == end)
+      break;
+
+    uint16_t depth = 0;
+    uint16_t current = code;
+
+    if (previous < 0) {
+      if (code >= clear)
+        return false;
+      _stack[depth++] = code;
+      first = code;
+    } else {
+      // A code not in the table yet is the previous string plus its own first byte
+      if (code > nextCode)
+        return false;
+      if (code == nextCode) {
+        _stack[depth++] = first;
+        current = previous;
+      }
+
+      while (current >= clear && depth < LZW_MAX_CODES) {
+        _stack[depth++] = _suffix[current];
+        current = _prefix[current];
+      }
+      first = current;
+      _stack[depth++] = first;
+
+      if (nextCode < LZW_MAX_CODES) {
+        _prefix[nextCode] = previous;
+        _suffix[nextCode] = first;
+        nextCode++;
+        if (nextCode == (1 << codeSize) && codeSize < 12)
+          codeSize++;
+      }
+    }
+    previous = code;
+
+    while (depth > 0 && written < total) {
+      uint8_t index = _stack[--depth];
+      uint16_t x = frame.x + column;
+      uint16_t y = frame.y + (interlaced ? row : written / frame.width);
+
+      if (index != transparent && index < colors && x < _width && y < _height)
+        setPixel(x, y, palette[index]);
+
+      written++;
+      if (++column == frame.width) {
+        column = 0;
+        if (interlaced) {
+          row += PASS_STEP[pass];
+          while (row >= frame.height && pass < 3)
+            row = PASS_START[++pass];
+        }
+      }
+    }
+  }
+
+  // Whatever is left of the image data, e.g. when it held more pixels than the frame
+  _position = reader.position;
+  if (!reader.ended) {
+    _position += reader.blockLeft;
+    skipSubBlocks(_position);
+  } else if (_position < _length) {
+    _position++;
+  }
+  return written > 0;
+}
+
+// APNG
+
+bool AnimationDecoder::scanPng(std::vector<uint16_t>* delays) {
+  uint16_t frames = 0;
+  bool animated = false;
+
+  _position = sizeof(PNG_SIGNATURE);
+  _header = _palette = _alpha = 0;
+
+  for (size_t position = _position; position + 12 <= _length;) {
+    uint32_t size = readBE32(&_data[position]);
+    const uint8_t* type = &_data[position + 4];
+    const uint8_t* chunk = &_data[position + 8];
+
+    if (size > _length - position - 12)
+      return false;
+
+    if (memcmp(type, "IHDR", 4) == 0 && size == 13) {
+      if (readBE32(chunk) > UINT8_MAX || readBE32(chunk + 4) > UINT8_MAX || chunk[12] != 0)
+        return false;
+      _header = position;
+      _width = readBE32(chunk);
+      _height = readBE32(chunk + 4);
+      _hasMask = (chunk[9] == 4 || chunk[9] == 6);
+    } else if (memcmp(type, "PLTE", 4) == 0) {
+      _palette = position;
+    } else if (memcmp(type, "tRNS", 4) == 0) {
+      _alpha = position;
+      _hasMask = true;
+    } else if (memcmp(type, "acTL", 4) == 0) {
+      animated = true;
+    } else if (memcmp(type, "fcTL", 4) == 0 && size == 26) {
+      uint16_t numerator = (chunk[20] << 8) | chunk[21];
+      uint16_t denominator = (chunk[22] << 8) | chunk[23];
+      bool partial = (readBE32(chunk + 12) > 0 || readBE32(chunk + 16) > 0 || readBE32(chunk + 4) < _width || readBE32(chunk + 8) < _height);
+      _hasMask = _hasMask || partial || chunk[24] != 0;
+
+      if (delays != nullptr)
+        delays->push_back(min((uint32_t)numerator * 1000 / (denominator ?: 100), (uint32_t)UINT16_MAX));
+
+      if (++frames > CW_ANIMATION_MAX_FRAMES)
+        return false;
+    } else if (memcmp(type, "IEND", 4) == 0) {
+      break;
+    }
+    position += size + 12;
+  }
+
+  return animated && _header > 0 && frames > 0;
+}
+
+bool AnimationDecoder::nextPng() {
+  while (_position + 12 <= _length) {
+    uint32_t size = readBE32(&_data[_position]);
+    const uint8_t* type = &_data[_position + 4];
+    const uint8_t* chunk = &_data[_position + 8];
+
+    if (size > _length - _position - 12 || memcmp(type, "IEND", 4) == 0)
+      return false;
+
+    _position += size + 12;
+    if (memcmp(type, "fcTL", 4) != 0 || size != 26)
+      continue;
+
+    uint32_t width = readBE32(chunk + 4), height = readBE32(chunk + 8);
+    uint32_t x = readBE32(chunk + 12), y = readBE32(chunk + 16);
+    if (width == 0 || height == 0 || x + width > _width || y + height > _height)
+      return false;
+
+    uint16_t numerator = (chunk[20] << 8) | chunk[21];
+    uint16_t denominator = (chunk[22] << 8) | chunk[23];
+    Disposal disposal = (chunk[24] == 1 ? DISPOSE_BACKGROUND : chunk[24] == 2 ? DISPOSE_PREVIOUS : DISPOSE_NONE);
+
+    // Restoring the canvas from before the first frame is clearing it
+    if (_first && disposal == DISPOSE_PREVIOUS)
+      disposal = DISPOSE_BACKGROUND;
+
+    Region frame = {(uint16_t)x, (uint16_t)y, (uint16_t)width, (uint16_t)height};
+    beginFrame(frame, disposal);
+    _delay = min((uint32_t)numerator * 1000 / (denominator ?: 100), (uint32_t)UINT16_MAX);
+    return decodePngFrame(frame, chunk[25] == 1);
+  }
+  return false;
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static void appendBE32(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+// Type and data are already in out from start on, the length goes before them
+static void closeChunk(std::vector<uint8_t>& out, size_t start) {
+  uint32_t crc = crc32(0, &out[start], out.size() - start);
+  uint32_t size = out.size() - start - 4;
+  uint8_t length[4] = {(uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size};
+  out.insert(out.begin() + start, length, length + 4);
+  appendBE32(out, crc);
+}
+
+struct PngFrameTarget {
+  PNG* png;
+  uint16_t* pixels;
+  uint8_t* mask;
+  bool alpha;
+};
+
+static void decodePngFrameLine(PNGDRAW* draw) {
+  PngFrameTarget* target = (PngFrameTarget*)draw->pUser;
+
+  target->png->getLineAsRGB565(draw, target->pixels + draw->y * draw->iWidth, PNG_RGB565_LITTLE_ENDIAN, 0xffffffff);
+  if (target->alpha)
+    target->png->getAlphaMask(draw, target->mask + draw->y * ((draw->iWidth + 7) / 8), 128);
+}
+
+// The frame's data chunks (IDAT or fdAT) as the only IDAT of a PNG of the frame's size
+bool AnimationDecoder::decodePngFrame(Region frame, bool blend) {
+  std::vector<uint8_t> png(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+  size_t start = png.size();
+  png.insert(png.end(), &_data[_header + 4], &_data[_header + 8 + 13]);
+  for (uint8_t i = 4; i < 12; i++)
+    png[start + i] = 0;
+  png[start + 7] = frame.width;
+  png[start + 11] = frame.height;
+  closeChunk(png, start);
+
+  if (_palette > 0)
+    png.insert(png.end(), &_data[_palette], &_data[_palette + 12 + readBE32(&_data[_palette])]);
+  if (_alpha > 0)
+    png.insert(png.end(), &_data[_alpha], &_data[_alpha + 12 + readBE32(&_data[_alpha])]);
+
+  start = png.size();
+  png.insert(png.end(), {'I', 'D', 'A', 'T'});
+
+  while (_position + 12 <= _length) {
+    uint32_t size = readBE32(&_data[_position]);
+    const uint8_t* type = &_data[_position + 4];
+    const uint8_t* chunk = &_data[_position + 8];
+
+    if (size > _length - _position - 12 || memcmp(type, "fcTL", 4) == 0 || memcmp(type, "IEND", 4) == 0)
+      break;
+
+    if (memcmp(type, "IDAT", 4) == 0)
+      png.insert(png.end(), chunk, chunk + size);
+    else if (memcmp(type, "fdAT", 4) == 0 && size >= 4)
+      png.insert(png.end(), chunk + 4, chunk + size);
+    _position += size + 12;
+  }
+
+  if (png.size() == start + 4)
+    return false;
+  closeChunk(png, start);
+
+  start = png.size();
+  png.insert(png.end(), {'I', 'E', 'N', 'D'});
+  closeChunk(png, start);
+
+  std::vector<uint16_t> pixels(frame.width * frame.height);
+  std::vector<uint8_t> mask(((frame.width + 7) / 8) * frame.height, 0xFF);
+
+  if (_png->openRAM(png.data(), png.size(), decodePngFrameLine) != PNG_SUCCESS)
+    return false;
+
+  PngFrameTarget target = {_png, pixels.data(), mask.data(), _png->hasAlpha() != 0};
+  int rc = _png->decode(&target, 0);
+  _png->close();
+  if (rc != PNG_SUCCESS)
+    return false;
+
+  // Blending over keeps the canvas where the frame is transparent
+  for (uint16_t y = 0; y < frame.height; y++) {
+    for (uint16_t x = 0; x < frame.width; x++) {
+      bool opaque = mask[y * ((frame.width + 7) / 8) + x / 8] & (0x80 >> (x & 7));
+      if (opaque)
+        setPixel(frame.x + x, frame.y + y, pixels[y * frame.width + x]);
+      else if (!blend)
+        clearPixel(frame.x + x, frame.y + y);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+class PNG;
+
+// Most frames an animation may have, a sprite counts its frames in a uint8_t
+#define CW_ANIMATION_MAX_FRAMES 255
+
+// Largest file taken, a canvas holds at most 64KB of base64
+#define CW_ANIMATION_MAX_SIZE 49152
+
+// Frames of an animated GIF or APNG, composed one after the other into a canvas of the
+// animation's size (disposal and blending included), so every frame comes out as a whole
+// image ready to be cached or drawn. Transparent pixels are black, with a 1 bit mask laid
+// out like the SpriteCache's.
+// GIFs are decoded here; each APNG frame is rewrapped as a plain PNG for PNGdec.
+class AnimationDecoder {
+  private:
+    enum Format : uint8_t { FORMAT_NONE, FORMAT_GIF, FORMAT_APNG };
+
+    // What the previous frame leaves behind once it was shown
+    enum Disposal : uint8_t { DISPOSE_NONE, DISPOSE_BACKGROUND, DISPOSE_PREVIOUS };
+
+    struct Region {
+      uint16_t x, y, width, height;
+    };
+
+    const uint8_t* _data = nullptr;
+    size_t _length = 0;
+    size_t _position = 0;
+    Format _format = FORMAT_NONE;
+    PNG* _png = nullptr;
+
+    uint8_t _width = 0;
+    uint8_t _height = 0;
+    bool _hasMask = false;
+    uint16_t _delay = 0;
+
+    std::vector<uint16_t> _pixels;
+    std::vector<uint8_t> _mask;
+    std::vector<uint16_t> _previousPixels;
+    std::vector<uint8_t> _previousMask;
+    Region _region = {};
+    Disposal _disposal = DISPOSE_NONE;
+    bool _first = true;
+
+    // GIF, the LZW tables are only allocated for GIFs
+    uint16_t _globalPalette[256];
+    uint16_t _globalColors = 0;
+    std::vector<uint16_t> _prefix;
+    std::vector<uint8_t> _suffix;
+    std::vector<uint8_t> _stack;
+
+    // APNG, chunks every frame needs: IHDR, PLTE and tRNS
+    size_t _header = 0;
+    size_t _palette = 0;
+    size_t _alpha = 0;
+
+    static uint32_t readBE32(const uint8_t* bytes);
+    static uint16_t readLE16(const uint8_t* bytes);
+    static uint16_t toRGB565(const uint8_t* rgb);
+
+    bool scanGif(std::vector<uint16_t>* delays);
+    bool scanPng(std::vector<uint16_t>* delays);
+    bool skipSubBlocks(size_t& position);
+
+    bool nextGif();
+    bool decodeGifImage(Region frame, const uint16_t* palette, uint16_t colors, int16_t transparent, bool interlaced);
+    bool nextPng();
+    bool decodePngFrame(Region frame, bool blend);
+
+    void beginFrame(Region frame, Disposal disposal);
+    void setPixel(uint16_t x, uint16_t y, uint16_t color);
+    void clearPixel(uint16_t x, uint16_t y);
+
+  public:
+    AnimationDecoder() {}
+    AnimationDecoder(const AnimationDecoder&) = delete;
+    AnimationDecoder& operator=(const AnimationDecoder&) = delete;
+
+    static bool isAnimation(const uint8_t* data, size_t length);
+
+    // Frame count, delay of each frame in ms (0 when the file has none) and size, without
+    // decoding any pixel. data must stay valid while the decoder is open, png is only
+    // needed to decode APNG frames
+    bool open(const uint8_t* data, size_t length, PNG* png, std::vector<uint16_t>* delays = nullptr);
+    // Composes the next frame, false after the last one or on a corrupt file
+    bool next();
+    void close();
+
+    uint8_t width() const { return _width; }
+    uint8_t height() const { return _height; }
+    bool hasMask() const { return _hasMask; }
+    uint16_t delay() const { return _delay; }
+    const uint16_t* pixels() const { return _pixels.data(); }
+    const uint8_t* mask() const { return _mask.data(); }
+    size_t maskStride() const { return (_width + 7) / 8; }
+};
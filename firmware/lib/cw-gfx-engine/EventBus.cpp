@@ -1,20 +1,125 @@
-
 #include "EventBus.h"
 
-void EventBus::broadcast(EventType event, Sprite* sender) {
-  for (uint8_t i = 0; i < _subNum; i++) {
-    _subscriptions[i]->execute(event, sender);
+EventBus::EventBus() {
+  for (uint8_t i = 0; i < EVENT_TYPES; i++) {
+    _first[i] = -1;
+  }
+
+  for (uint8_t i = 0; i < EVENTBUS_SUBSCRIPTIONS; i++) {
+    _subscriptions[i].task = nullptr;
+    _subscriptions[i].next = (i + 1 < EVENTBUS_SUBSCRIPTIONS ? i + 1 : -1);
   }
 }
 
 
-void EventBus::subscribe(EventTask* task) {
-  
-  if (_subNum < 5) {
-    _subscriptions[_subNum] = task;
-    _subNum++;
+void EventBus::deliver(EventType event, Sprite* sender, EventTask* task) {
+  _delivering = true;
+
+  if (task != nullptr) {
+    task->execute(event, sender);
   } else {
-    Serial.println("Out of space");
+    // A slot unsubscribed meanwhile keeps its link until the end, only its task is gone
+    for (int8_t i = _first[event]; i >= 0; i = _subscriptions[i].next) {
+      if (_subscriptions[i].task != nullptr) {
+        _subscriptions[i].task->execute(event, sender);
+      }
+    }
+  }
+
+  _delivering = false;
+
+  if (_unsubscribed) {
+    _unsubscribed = false;
+    release(nullptr);
   }
+}
+
+
+void EventBus::broadcast(EventType event, Sprite* sender) {
+  send(event, sender, nullptr);
+}
+
+
+void EventBus::send(EventType event, Sprite* sender, EventTask* task) {
+  if (_delivering) {
+    post(event, sender, task);
+  } else {
+    deliver(event, sender, task);
+  }
+}
+
+
+void EventBus::post(EventType event, Sprite* sender, EventTask* task) {
+  if (_queued == EVENTBUS_QUEUE_SIZE) {
+    Serial.println("[EventBus] Queue full, event dropped");
+    return;
+  }
+
+  _queue[(_queueStart + _queued) % EVENTBUS_QUEUE_SIZE] = {event, sender, task};
+  _queued++;
+}
 
+
+void EventBus::dispatch() {
+  for (uint8_t pending = _queued; pending > 0; pending--) {
+    Event queued = _queue[_queueStart];
+    _queueStart = (_queueStart + 1) % EVENTBUS_QUEUE_SIZE;
+    _queued--;
+
+    deliver(queued.type, queued.sender, queued.task);
+  }
+}
+
+
+void EventBus::subscribe(EventTask* task, EventType event) {
+  if (_free < 0) {
+    Serial.println("[EventBus] Out of subscriptions");
+    return;
+  }
+
+  // Appended, tasks keep getting events in the order they subscribed
+  int8_t slot = _free;
+  _free = _subscriptions[slot].next;
+  _subscriptions[slot] = {task, -1};
+
+  int8_t* link = &_first[event];
+  while (*link >= 0) {
+    link = &_subscriptions[*link].next;
+  }
+  *link = slot;
+}
+
+
+void EventBus::unsubscribe(EventTask* task) {
+  if (!_delivering) {
+    release(task);
+    return;
+  }
+
+  for (uint8_t i = 0; i < EVENTBUS_SUBSCRIPTIONS; i++) {
+    if (task != nullptr && _subscriptions[i].task == task) {
+      _subscriptions[i].task = nullptr;
+      _unsubscribed = true;
+    }
+  }
+}
+
+
+// Unlinks the subscriptions of that task and gives their slots back to the pool
+void EventBus::release(EventTask* task) {
+  for (uint8_t event = 0; event < EVENT_TYPES; event++) {
+    int8_t* link = &_first[event];
+
+    while (*link >= 0) {
+      int8_t slot = *link;
+
+      if (_subscriptions[slot].task == task) {
+        *link = _subscriptions[slot].next;
+        _subscriptions[slot] = {nullptr, _free};
+        _free = slot;
+      } else {
+        link = &_subscriptions[slot].next;
+      }
+    }
+  }
 }
@@ -4,15 +4,61 @@
 #include "EventTask.h"
 #include "Sprite.h"
 
+// Subscriptions of all the event types together, taken from one pool
+#ifndef EVENTBUS_SUBSCRIPTIONS
+#define EVENTBUS_SUBSCRIPTIONS 16
+#endif
+
+// Events waiting for the next dispatch()
+#ifndef EVENTBUS_QUEUE_SIZE
+#define EVENTBUS_QUEUE_SIZE 16
+#endif
+
+// Each event type has its own list of subscribers, so an event only reaches the tasks
+// that asked for it. An event sent while another one is being delivered is queued
+// instead of delivered recursively, the queue is drained once per frame by dispatch().
 class EventBus {
   private:
-    EventTask* _subscriptions[5];
-    uint8_t _subNum = 0;
+    struct Subscription {
+      EventTask* task;
+      int8_t next;
+    };
+
+    struct Event {
+      EventType type;
+      Sprite* sender;
+      EventTask* task;   // nullptr for all the subscribers
+    };
+
+    Subscription _subscriptions[EVENTBUS_SUBSCRIPTIONS];
+    int8_t _first[EVENT_TYPES];
+    int8_t _free = 0;
+
+    Event _queue[EVENTBUS_QUEUE_SIZE];
+    uint8_t _queueStart = 0;
+    uint8_t _queued = 0;
+
+    bool _delivering = false;
+    bool _unsubscribed = false;   // slots left in their list by an unsubscribe while delivering
+
+    void deliver(EventType event, Sprite* sender, EventTask* task);
+    void release(EventTask* task);
 
   public:
+    EventBus();
+
+    // Delivered right away, or at the next dispatch() when sent from a task's execute
     void broadcast(EventType event, Sprite* sender);
-    void subscribe(EventTask* task);
-    
+    // Delivered at the next dispatch()
+    void post(EventType event, Sprite* sender, EventTask* task = nullptr);
+    // To that task only, subscribed or not, delivered like a broadcast
+    void send(EventType event, Sprite* sender, EventTask* task);
+    // Delivers the events queued so far, the ones they cause wait for the next frame
+    void dispatch();
+
+    void subscribe(EventTask* task, EventType event);
+    // Safe from a task's execute, the task gets no more events from then on
+    void unsubscribe(EventTask* task);
 };
 
 
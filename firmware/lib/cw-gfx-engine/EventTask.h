@@ -5,7 +5,8 @@
 
 enum EventType {
     MOVE, 
-    COLLISION
+    COLLISION,
+    EVENT_TYPES
 };
 
 class EventTask {
@@ -14,4 +15,3 @@ class EventTask {
 };
 
 
-
@@ -0,0 +1,200 @@
+#include "FontRegistry.h"
+
+FontRegistry::~FontRegistry() {
+  for (Entry& entry : _entries)
+    free(entry.pack);
+}
+
+// FNV-1a
+uint32_t FontRegistry::hash(const char* name) {
+  uint32_t hash = 2166136261UL;
+  for (uint8_t i = 0; name[i] && i < CW_FONT_NAME_MAX; i++) {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+static void skip(Stream& input, uint32_t size) {
+  while (size-- > 0 && input.read() >= 0);
+}
+
+uint8_t FontRegistry::intern(const char* name) {
+  std::lock_guard<std::mutex> guard(_mutex);
+  return internLocked(name);
+}
+
+uint8_t FontRegistry::internLocked(const char* name) {
+  if (name == nullptr || name[0] == 0)
+    return DEFAULT_FONT;
+
+  uint32_t nameHash = hash(name);
+
+  for (uint8_t probe = 0; probe < SLOTS; probe++) {
+    uint8_t& slot = _slots[(nameHash + probe) % SLOTS];
+
+    if (slot == 0) {
+      if (_count >= MAX_FONTS)
+        return DEFAULT_FONT;
+
+      Entry& entry = _entries[_count];
+      entry.hash = nameHash;
+      strncpy(entry.name, name, CW_FONT_NAME_MAX);
+      slot = _count + 1;
+      return _count++;
+    }
+
+    Entry& entry = _entries[slot - 1];
+    if (entry.hash == nameHash && strncmp(entry.name, name, CW_FONT_NAME_MAX) == 0)
+      return slot - 1;
+  }
+  return DEFAULT_FONT;
+}
+
+// Names are never changed once interned, the pointer stays valid
+const char* FontRegistry::name(uint8_t id) {
+  std::lock_guard<std::mutex> guard(_mutex);
+  return (id < _count ? _entries[id].name : "");
+}
+
+void FontRegistry::add(const char* name, const GFXfont* font) {
+  std::lock_guard<std::mutex> guard(_mutex);
+  uint8_t id = internLocked(name);
+  if (id != DEFAULT_FONT && _entries[id].pack == nullptr)
+    _entries[id].font = font;
+}
+
+bool FontRegistry::load(const char* name, Stream& pack, uint32_t size, String& error) {
+  FontPackHeader header;
+
+  if (size < sizeof(header) || pack.readBytes((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+    skip(pack, size);
+    error = "Not a font pack";
+    return false;
+  }
+
+  uint16_t glyphCount = header.last - header.first + 1;
+  uint32_t remaining = size - sizeof(header);
+  size_t bytes = sizeof(GFXfont) + glyphCount * sizeof(GFXglyph) + header.bitmapSize;
+  uint8_t id = DEFAULT_FONT;
+  bool loaded = false;
+  const char* problem = nullptr;
+
+  // Failures still consume the pack, so a stream holding more after it stays readable
+  if (header.magic != CW_FONT_PACK_MAGIC || header.first > header.last || header.last > UINT8_MAX ||
+      remaining != glyphCount * sizeof(FontPackGlyph) + header.bitmapSize)
+    problem = "Invalid font pack";
+
+  // The memory is reserved now and the font published once read, so the lock is not
+  // held while the stream is
+  if (problem == nullptr) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    id = internLocked(name);
+    loaded = (id != DEFAULT_FONT && _entries[id].font != nullptr);
+
+    if (id == DEFAULT_FONT)
+      problem = "Too many fonts";
+    else if (!loaded && _packBytes + bytes > CW_FONT_PACK_BUDGET)
+      problem = "Font packs exceed the memory budget";
+    else if (!loaded)
+      _packBytes += bytes;
+  }
+
+  // One block: the GFXfont, its glyphs and the bitmap they point into
+  uint8_t* memory = (problem == nullptr && !loaded ? (uint8_t*)malloc(bytes) : nullptr);
+  if (memory == nullptr) {
+    if (problem == nullptr && !loaded) {
+      release(bytes);
+      problem = "Font packs exceed the memory budget";
+    }
+    skip(pack, remaining);
+    if (problem != nullptr)
+      error = problem;
+    return problem == nullptr;
+  }
+
+  GFXfont* font = (GFXfont*)memory;
+  GFXglyph* glyphs = (GFXglyph*)(memory + sizeof(GFXfont));
+  uint8_t* bitmap = (uint8_t*)(glyphs + glyphCount);
+  bool valid = true;
+
+  for (uint16_t i = 0; i < glyphCount; i++) {
+    FontPackGlyph record = {};
+    valid = (pack.readBytes((uint8_t*)&record, sizeof(record)) == sizeof(record)) && valid &&
+            (uint32_t)(record.bitmapOffset + (record.width * record.height + 7) / 8) <= header.bitmapSize;
+    glyphs[i] = {record.bitmapOffset, record.width, record.height, record.xAdvance, record.xOffset, record.yOffset};
+  }
+
+  if (pack.readBytes(bitmap, header.bitmapSize) != header.bitmapSize || !valid) {
+    free(memory);
+    release(bytes);
+    error = "Invalid font pack";
+    return false;
+  }
+
+  *font = {bitmap, glyphs, header.first, header.last, header.yAdvance};
+
+  std::lock_guard<std::mutex> guard(_mutex);
+  // Another task loaded the same name meanwhile, the first one stays
+  if (_entries[id].font != nullptr) {
+    free(memory);
+    _packBytes -= bytes;
+    return true;
+  }
+
+  _entries[id].pack = memory;
+  _entries[id].bitmapSize = header.bitmapSize;
+  _entries[id].font = font;
+  return true;
+}
+
+void FontRegistry::release(size_t bytes) {
+  std::lock_guard<std::mutex> guard(_mutex);
+  _packBytes -= bytes;
+}
+
+bool FontRegistry::isPack(uint8_t id) {
+  std::lock_guard<std::mutex> guard(_mutex);
+  return id < _count && _entries[id].pack != nullptr;
+}
+
+// A loaded pack is never changed, it is written without the lock
+size_t FontRegistry::save(uint8_t id, Print& out) {
+  if (!isPack(id))
+    return 0;
+
+  _mutex.lock();
+  const GFXfont* font = _entries[id].font;
+  uint32_t bitmapSize = _entries[id].bitmapSize;
+  _mutex.unlock();
+
+  FontPackHeader header = {CW_FONT_PACK_MAGIC, font->first, font->last, font->yAdvance, 0, bitmapSize};
+  size_t written = out.write((const uint8_t*)&header, sizeof(header));
+
+  for (uint16_t i = 0; i <= font->last - font->first; i++) {
+    const GFXglyph& glyph = font->glyph[i];
+    FontPackGlyph record = {glyph.bitmapOffset, glyph.width, glyph.height, glyph.xAdvance, glyph.xOffset, glyph.yOffset};
+    written += out.write((const uint8_t*)&record, sizeof(record));
+  }
+
+  written += out.write(font->bitmap, header.bitmapSize);
+  return written;
+}
+
+void FontRegistry::require(uint8_t id) {
+  _mutex.lock();
+  bool ask = (id != DEFAULT_FONT && id < _count && _entries[id].font == nullptr && !_entries[id].tried && _loader != nullptr);
+  if (ask)
+    _entries[id].tried = true;
+  const char* fontName = _entries[id < _count ? id : DEFAULT_FONT].name;
+  _mutex.unlock();
+
+  // The loader calls load(), which takes the lock again
+  if (ask)
+    _loader(fontName);
+}
+
+const GFXfont* FontRegistry::get(uint8_t id) {
+  std::lock_guard<std::mutex> guard(_mutex);
+  return (id == DEFAULT_FONT || id >= _count ? nullptr : _entries[id].font);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+#include <gfxfont.h>
+#include <mutex>
+
+#define CW_FONT_PACK_MAGIC 0x31465743UL   // "CWF1"
+
+#ifndef CW_FONT_PACK_BUDGET
+  #define CW_FONT_PACK_BUDGET 32768
+#endif
+
+#define CW_FONT_NAME_MAX 15
+
+// A GFXfont serialised to be stored on flash or shipped in a canvas, little endian:
+//
+//   FontPackHeader
+//   glyphs      (last - first + 1) x FontPackGlyph
+//   bitmap      bitmapSize bytes, as in the GFXfont
+//
+// tools/font-pack converts the header written by Adafruit's fontconvert.
+struct __attribute__((packed)) FontPackHeader {
+  uint32_t magic;
+  uint16_t first;
+  uint16_t last;
+  uint8_t yAdvance;
+  uint8_t reserved;
+  uint32_t bitmapSize;
+};
+
+struct __attribute__((packed)) FontPackGlyph {
+  uint16_t bitmapOffset;
+  uint8_t width, height;
+  uint8_t xAdvance;
+  int8_t xOffset, yOffset;
+};
+
+// Reads the pack of a font nobody registered yet, e.g. from flash. Returns false when there is none
+typedef bool (*FontPackLoader)(const char* name);
+
+// Fonts by name, interned to a small id when a canvas is loaded so drawing with a font is
+// an array index. Fonts built into the firmware are added by pointer; any other name is
+// looked up once through the loader when a canvas using it is compiled. Loaded packs are
+// immutable and stay in memory, so an id keeps pointing to the same font while canvases
+// come and go.
+// Canvases are compiled on the refresh task while the render loop draws, so every method
+// takes the registry's lock. A pack is read from its stream without it.
+class FontRegistry {
+  private:
+    static constexpr uint8_t MAX_FONTS = 32;
+    static constexpr uint8_t SLOTS = 64;
+
+    struct Entry {
+      uint32_t hash;
+      char name[CW_FONT_NAME_MAX + 1];
+      const GFXfont* font;
+      uint8_t* pack;      // memory of a loaded pack
+      uint32_t bitmapSize;
+      bool tried;         // the loader was already asked
+    };
+
+    Entry _entries[MAX_FONTS] = {};
+    uint8_t _count = 1;
+    uint8_t _slots[SLOTS] = {};   // id + 1, 0 when free
+    FontPackLoader _loader = nullptr;
+    size_t _packBytes = 0;
+    std::mutex _mutex;
+
+    static uint32_t hash(const char* name);
+    uint8_t internLocked(const char* name);
+    void release(size_t bytes);
+
+  public:
+    static const uint8_t DEFAULT_FONT = 0;
+
+    FontRegistry(const FontRegistry&) = delete;
+    FontRegistry& operator=(const FontRegistry&) = delete;
+    FontRegistry() {}
+    ~FontRegistry();
+
+    // DEFAULT_FONT for nullptr, "" and once the registry is full
+    uint8_t intern(const char* name);
+    const char* name(uint8_t id);
+
+    // A font built into the firmware
+    void add(const char* name, const GFXfont* font);
+    // Reads the size bytes of a pack, also when it fails. A name that already has a font keeps it
+    bool load(const char* name, Stream& pack, uint32_t size, String& error);
+    // Writes the pack of a loaded font back, 0 for built-in fonts
+    size_t save(uint8_t id, Print& out);
+    bool isPack(uint8_t id);
+
+    void setLoader(FontPackLoader loader) { _loader = loader; }
+    // Asks the loader for a font that has none yet, once per name. Loading reads the file
+    // system, so it is done where a canvas is compiled and never by get()
+    void require(uint8_t id);
+
+    // nullptr is the default font, also for names that were never found
+    const GFXfont* get(uint8_t id);
+};
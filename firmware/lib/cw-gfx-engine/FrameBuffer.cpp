@@ -0,0 +1,143 @@
+#include "FrameBuffer.h"
+
+FrameBuffer::FrameBuffer(Adafruit_GFX* target) : Adafruit_GFX(DISPLAY_WIDTH, DISPLAY_HEIGHT) {
+  _target = target;
+  _outputEnabled = true;
+  memset(_pixels, 0, sizeof(_pixels));
+
+  for (uint8_t row = 0; row < FB_TILE_ROWS; row++) {
+    _dirtyTiles[row] = 0;
+  }
+}
+
+void FrameBuffer::markDirty(int16_t x, int16_t y, int16_t w, int16_t h) {
+  uint8_t firstCol = x / FB_TILE_SIZE;
+  uint8_t lastCol = (x + w - 1) / FB_TILE_SIZE;
+  uint8_t bits = (0xFF >> (7 - (lastCol - firstCol))) << firstCol;
+
+  for (uint8_t row = y / FB_TILE_SIZE; row <= (y + h - 1) / FB_TILE_SIZE; row++) {
+    // Skip the atomic write when the tiles are already waiting to be read
+    if ((_dirtyTiles[row].load(std::memory_order_relaxed) & bits) != bits) {
+      _dirtyTiles[row].fetch_or(bits);
+    }
+  }
+}
+
+// Clipped to the display, only the pixels of the panel make tiles dirty
+void FrameBuffer::store(uint16_t* pixels, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > DISPLAY_WIDTH) w = DISPLAY_WIDTH - x;
+  if (y + h > DISPLAY_HEIGHT) h = DISPLAY_HEIGHT - y;
+  if (w <= 0 || h <= 0)
+    return;
+
+  for (int16_t yy = y; yy < y + h; yy++) {
+    uint16_t *line = &pixels[yy * DISPLAY_WIDTH + x];
+    for (int16_t xx = 0; xx < w; xx++) {
+      line[xx] = color;
+    }
+  }
+
+  if (pixels == _pixels)
+    markDirty(x, y, w, h);
+}
+
+void FrameBuffer::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (_outputEnabled)
+    _target->drawPixel(x, y, color);
+
+  store(_outputEnabled || _hidden == nullptr ? _pixels : _hidden, x, y, 1, 1, color);
+}
+
+void FrameBuffer::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (_outputEnabled)
+    _target->fillRect(x, y, w, h, color);
+
+  store(_outputEnabled || _hidden == nullptr ? _pixels : _hidden, x, y, w, h, color);
+}
+
+void FrameBuffer::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  fillRect(x, y, w, 1, color);
+}
+
+void FrameBuffer::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
+
+void FrameBuffer::fillScreen(uint16_t color) {
+  fillRect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, color);
+}
+
+void FrameBuffer::setRotation(uint8_t r) {
+  // The panel applies the rotation itself, the buffer keeps logical coordinates
+  _target->setRotation(r);
+}
+
+Adafruit_GFX* FrameBuffer::getTarget() {
+  return _target;
+}
+
+const uint16_t* FrameBuffer::getPixels() {
+  return _pixels;
+}
+
+uint16_t FrameBuffer::getPixel(int16_t x, int16_t y) {
+  if (x < 0 || y < 0 || x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT)
+    return 0;
+
+  return _pixels[y * DISPLAY_WIDTH + x];
+}
+
+uint8_t FrameBuffer::takeDirtyTiles(uint8_t tileRow) {
+  return _dirtyTiles[tileRow].exchange(0);
+}
+
+void FrameBuffer::markAllDirty() {
+  for (uint8_t row = 0; row < FB_TILE_ROWS; row++) {
+    _dirtyTiles[row] = 0xFF;
+  }
+}
+
+// Without the memory for a hidden copy, what is drawn meanwhile lands in the visible one
+void FrameBuffer::suspendOutput() {
+  _hidden = (uint16_t*)malloc(sizeof(_pixels));
+  if (_hidden != nullptr)
+    memcpy(_hidden, _pixels, sizeof(_pixels));
+
+  _outputEnabled = false;
+}
+
+void FrameBuffer::resumeOutput() {
+  if (_hidden != nullptr) {
+    memcpy(_pixels, _hidden, sizeof(_pixels));
+    free(_hidden);
+    _hidden = nullptr;
+    markAllDirty();
+  }
+
+  _outputEnabled = true;
+  _target->drawRGBBitmap(0, 0, _pixels, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+FrameBufferOverlay::FrameBufferOverlay(FrameBuffer* frameBuffer) : Adafruit_GFX(DISPLAY_WIDTH, DISPLAY_HEIGHT) {
+  _frameBuffer = frameBuffer;
+}
+
+void FrameBufferOverlay::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  _frameBuffer->_target->drawPixel(x, y, color);
+  _frameBuffer->store(_frameBuffer->_pixels, x, y, 1, 1, color);
+}
+
+void FrameBufferOverlay::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  _frameBuffer->_target->fillRect(x, y, w, h, color);
+  _frameBuffer->store(_frameBuffer->_pixels, x, y, w, h, color);
+}
+
+void FrameBufferOverlay::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  fillRect(x, y, w, 1, color);
+}
+
+void FrameBufferOverlay::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <atomic>
+#include "Game.h"
+
+// Tiles are 8x8 pixels, so one tile row fits in a single byte of dirty bits
+const uint8_t FB_TILE_SIZE = 8;
+const uint8_t FB_TILE_COLS = DISPLAY_WIDTH / FB_TILE_SIZE;
+const uint8_t FB_TILE_ROWS = DISPLAY_HEIGHT / FB_TILE_SIZE;
+
+// Forwards every draw call to the real panel and keeps a RGB565 copy of what
+// was drawn, so the screen content can be read back (e.g. by the web mirror).
+class FrameBuffer : public Adafruit_GFX {
+  friend class FrameBufferOverlay;
+
+  private:
+    Adafruit_GFX* _target;
+    uint16_t _pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+    uint16_t* _hidden = nullptr;   // what is drawn while suspended, _pixels keeps the panel
+    std::atomic<uint8_t> _dirtyTiles[FB_TILE_ROWS];
+    std::atomic<bool> _outputEnabled;
+
+    void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+    void store(uint16_t* pixels, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+  public:
+    FrameBuffer(Adafruit_GFX* target);
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void fillScreen(uint16_t color) override;
+    void setRotation(uint8_t r) override;
+
+    Adafruit_GFX* getTarget();
+    const uint16_t* getPixels();
+    uint16_t getPixel(int16_t x, int16_t y);
+
+    // Returns the dirty bits of a tile row (bit n = tile column n) and clears them
+    uint8_t takeDirtyTiles(uint8_t tileRow);
+    void markAllDirty();
+
+    // While suspended draws only update a hidden copy, leaving the panel to someone else
+    // (e.g. an image pushed over HTTP) who draws through a FrameBufferOverlay. Resuming
+    // repaints the panel from the hidden copy.
+    void suspendOutput();
+    void resumeOutput();
+};
+
+// Draws on the panel of a suspended FrameBuffer, and in the copy the mirror reads
+class FrameBufferOverlay : public Adafruit_GFX {
+  private:
+    FrameBuffer* _frameBuffer;
+
+  public:
+    FrameBufferOverlay(FrameBuffer* frameBuffer);
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+};
@@ -0,0 +1,284 @@
+#include "GlyphCache.h"
+
+GlyphCache::GlyphCache(size_t budget) {
+  _budget = budget;
+}
+
+// Runs of set bits, row by row. GFX glyph bitmaps are packed without row padding
+void GlyphCache::rasterise(const GFXfont* font, const GFXglyph* glyph, std::vector<uint8_t>& spans) {
+  const uint8_t* bitmap = font->bitmap + glyph->bitmapOffset;
+  uint32_t bit = 0;
+
+  for (uint8_t row = 0; row < glyph->height; row++) {
+    int16_t start = -1;
+
+    for (uint16_t column = 0; column <= glyph->width; column++) {
+      bool set = false;
+      if (column < glyph->width) {
+        set = bitmap[bit >> 3] & (0x80 >> (bit & 7));
+        bit++;
+      }
+
+      if (set && start < 0) {
+        start = column;
+      } else if (!set && start >= 0) {
+        spans.push_back(row);
+        spans.push_back(start);
+        spans.push_back(column - start);
+        start = -1;
+      }
+    }
+  }
+}
+
+// FNV-1a
+uint32_t GlyphCache::hash(const char* text) {
+  uint32_t hash = 2166136261UL;
+  while (*text) {
+    hash ^= (uint8_t)*text++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+const GFXglyph* GlyphCache::glyphOf(const GFXfont* font, char c) {
+  uint8_t code = c;
+  if (code < font->first || code > font->last)
+    return nullptr;
+  return &font->glyph[code - font->first];
+}
+
+int16_t GlyphCache::find(const GFXfont* font, char c) {
+  const GFXglyph* glyph = glyphOf(font, c);
+  if (glyph == nullptr)
+    return OVER_BUDGET;
+
+  FontGlyphs* entry = nullptr;
+  for (FontGlyphs& candidate : _fonts) {
+    if (candidate.font == font)
+      entry = &candidate;
+  }
+
+  if (entry == nullptr) {
+    size_t indexBytes = (font->last - font->first + 1) * sizeof(int16_t);
+    if (_used + indexBytes > _budget)
+      return OVER_BUDGET;
+
+    _fonts.push_back({font, std::vector<int16_t>(font->last - font->first + 1, NOT_CACHED)});
+    _used += indexBytes;
+    entry = &_fonts.back();
+  }
+
+  int16_t& index = entry->glyphs[(uint8_t)c - font->first];
+  if (index != NOT_CACHED)
+    return index;
+
+  size_t start = _spans.size();
+  rasterise(font, glyph, _spans);
+
+  size_t bytes = _spans.size() - start + sizeof(Glyph);
+  if (_used + bytes > _budget || _glyphs.size() >= INT16_MAX || _spans.size() / 3 > UINT16_MAX) {
+    _spans.resize(start);
+    index = OVER_BUDGET;
+    return index;
+  }
+
+  _glyphs.push_back({(uint16_t)(start / 3), (uint16_t)((_spans.size() - start) / 3)});
+  _used += bytes;
+  index = _glyphs.size() - 1;
+  return index;
+}
+
+const GlyphCache::Measure& GlyphCache::measure(const GFXfont* font, const char* text) {
+  uint32_t textHash = hash(text);
+  for (const Measure& cached : _measures) {
+    if (cached.font == font && cached.hash == textHash && cached.text == text)
+      return cached;
+  }
+
+  int16_t x = 0, y = 0;
+  int16_t minX = INT16_MAX, minY = INT16_MAX, maxX = INT16_MIN, maxY = INT16_MIN;
+
+  for (const char* c = text; *c; c++) {
+    if (*c == '\n') {
+      x = 0;
+      y += font->yAdvance;
+      continue;
+    }
+
+    const GFXglyph* glyph = glyphOf(font, *c);
+    if (glyph == nullptr)
+      continue;
+
+    int16_t x1 = x + glyph->xOffset, y1 = y + glyph->yOffset;
+    minX = min(minX, x1);
+    minY = min(minY, y1);
+    maxX = max(maxX, (int16_t)(x1 + glyph->width - 1));
+    maxY = max(maxY, (int16_t)(y1 + glyph->height - 1));
+    x += glyph->xAdvance;
+  }
+
+  Measure& result = _measures[_nextMeasure];
+  _nextMeasure = (_nextMeasure + 1) % MEASURE_SLOTS;
+
+  result.font = font;
+  result.hash = textHash;
+  result.text = text;
+  result.x1 = result.y1 = 0;
+  result.w = result.h = 0;
+  if (maxX >= minX) {
+    result.x1 = minX;
+    result.w = maxX - minX + 1;
+  }
+  if (maxY >= minY) {
+    result.y1 = minY;
+    result.h = maxY - minY + 1;
+  }
+  return result;
+}
+
+void GlyphCache::getTextBounds(Adafruit_GFX* display, const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+  if (font == nullptr) {
+    display->setFont(nullptr);
+    display->getTextBounds(text, x, y, x1, y1, w, h);
+    return;
+  }
+
+  const Measure& bounds = measure(font, text);
+  *x1 = x + bounds.x1;
+  *y1 = y + bounds.y1;
+  *w = bounds.w;
+  *h = bounds.h;
+}
+
+void GlyphCache::drawSpans(Adafruit_GFX* display, const uint8_t* spans, uint16_t count, int16_t x, int16_t y, uint16_t color) {
+  for (uint16_t i = 0; i < count; i++, spans += 3)
+    display->drawFastHLine(x + spans[1], y + spans[0], spans[2], color);
+}
+
+void GlyphCache::print(Adafruit_GFX* display, const GFXfont* font, const char* text, int16_t x, int16_t y, uint16_t color) {
+  if (font == nullptr) {
+    display->setFont(nullptr);
+    display->setCursor(x, y);
+    display->setTextColor(color);
+    display->print(text);
+    return;
+  }
+
+  int16_t cursorX = x;
+
+  for (const char* c = text; *c; c++) {
+    if (*c == '\n') {
+      cursorX = x;
+      y += font->yAdvance;
+      continue;
+    }
+
+    const GFXglyph* glyph = glyphOf(font, *c);
+    if (glyph == nullptr)
+      continue;
+
+    int16_t originX = cursorX + glyph->xOffset;
+    int16_t originY = y + glyph->yOffset;
+    int16_t index = find(font, *c);
+
+    if (index >= 0) {
+      const Glyph& cached = _glyphs[index];
+      drawSpans(display, &_spans[cached.firstSpan * 3], cached.spanCount, originX, originY, color);
+    } else {
+      _scratch.clear();
+      rasterise(font, glyph, _scratch);
+      drawSpans(display, _scratch.data(), _scratch.size() / 3, originX, originY, color);
+    }
+
+    cursorX += glyph->xAdvance;
+  }
+}
+
+// Pixels a glyph covers when drawn at the cursor, false when it draws none. The default
+// font is 5x8 from the cursor, which is its top left corner
+bool GlyphCache::glyphBox(const GFXfont* font, char c, int16_t cursorX, int16_t y, Box& box, int16_t& advance) {
+  if (font == nullptr) {
+    box = {cursorX, y, (int16_t)(cursorX + 4), (int16_t)(y + 7)};
+    advance = 6;
+    return true;
+  }
+
+  const GFXglyph* glyph = glyphOf(font, c);
+  advance = (glyph != nullptr ? glyph->xAdvance : 0);
+  if (glyph == nullptr || glyph->width == 0 || glyph->height == 0)
+    return false;
+
+  box.left = cursorX + glyph->xOffset;
+  box.top = y + glyph->yOffset;
+  box.right = box.left + glyph->width - 1;
+  box.bottom = box.top + glyph->height - 1;
+  return true;
+}
+
+// Grows box by the glyphs of text, returns the cursor after them
+int16_t GlyphCache::extend(const GFXfont* font, const char* text, int16_t cursorX, int16_t y, Box& box) {
+  for (const char* c = text; *c; c++) {
+    Box glyph;
+    int16_t advance;
+
+    if (glyphBox(font, *c, cursorX, y, glyph, advance)) {
+      box.left = min(box.left, glyph.left);
+      box.top = min(box.top, glyph.top);
+      box.right = max(box.right, glyph.right);
+      box.bottom = max(box.bottom, glyph.bottom);
+    }
+    cursorX += advance;
+  }
+  return cursorX;
+}
+
+void GlyphCache::reprint(Adafruit_GFX* display, const GFXfont* font, const char* previous, const char* text, int16_t x, int16_t y, uint16_t color, uint16_t bgColor) {
+  size_t first = 0;
+  int16_t cursorX = x;
+  Box glyph;
+  int16_t advance;
+
+  // Both are drawn from the same cursor up to the first difference
+  while (text[first] != 0 && text[first] == previous[first]) {
+    glyphBox(font, text[first], cursorX, y, glyph, advance);
+    cursorX += advance;
+    first++;
+  }
+
+  if (text[first] == 0 && previous[first] == 0)
+    return;
+
+  Box cleared = {INT16_MAX, INT16_MAX, INT16_MIN, INT16_MIN};
+  extend(font, previous + first, cursorX, y, cleared);
+  extend(font, text + first, cursorX, y, cleared);
+
+  // Glyphs before the difference that reach into the cleared area are drawn again too
+  while (first > 0) {
+    glyphBox(font, text[first - 1], cursorX, y, glyph, advance);
+    int16_t start = cursorX - advance;
+
+    if (!glyphBox(font, text[first - 1], start, y, glyph, advance) || glyph.right < cleared.left)
+      break;
+
+    first--;
+    cursorX = start;
+  }
+
+  if (cleared.right >= cleared.left)
+    display->fillRect(cleared.left, cleared.top, cleared.right - cleared.left + 1, cleared.bottom - cleared.top + 1, bgColor);
+
+  print(display, font, text + first, cursorX, y, color);
+}
+
+void GlyphCache::clear() {
+  _fonts.clear();
+  _glyphs.clear();
+  _spans.clear();
+  _spans.shrink_to_fit();
+  _scratch.clear();
+  _scratch.shrink_to_fit();
+  for (Measure& cached : _measures)
+    cached = {};
+  _used = 0;
+}
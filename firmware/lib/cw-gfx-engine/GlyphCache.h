@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <vector>
+
+#ifndef CW_GLYPH_CACHE_BUDGET
+  #define CW_GLYPH_CACHE_BUDGET 4096
+#endif
+
+// Glyphs of GFX fonts rasterised once into horizontal spans, so text is drawn with one
+// drawFastHLine per run instead of a writePixel per set bit. Spans carry no colour, one
+// entry serves every colour. Past the budget glyphs are still drawn as spans, decoded
+// from the font each time.
+// Bounds of the last strings measured are kept, so a layout repeated every tick is free.
+// Text is never wrapped and a '\n' starts the next line at x. The default font (nullptr)
+// goes through Adafruit_GFX as before.
+class GlyphCache {
+  private:
+    static constexpr int16_t NOT_CACHED = -1;
+    static constexpr int16_t OVER_BUDGET = -2;
+    static constexpr uint8_t MEASURE_SLOTS = 8;
+
+    struct Glyph {
+      uint16_t firstSpan;   // in _spans, 3 bytes each: row, column, length
+      uint16_t spanCount;
+    };
+
+    struct FontGlyphs {
+      const GFXfont* font;
+      std::vector<int16_t> glyphs;   // index in _glyphs by code - font->first
+    };
+
+    struct Box {
+      int16_t left, top, right, bottom;   // inclusive
+    };
+
+    struct Measure {
+      const GFXfont* font;
+      uint32_t hash;
+      String text;   // compared too, two strings may share a hash
+      int16_t x1, y1;
+      uint16_t w, h;
+    };
+
+    std::vector<FontGlyphs> _fonts;
+    std::vector<Glyph> _glyphs;
+    std::vector<uint8_t> _spans;
+    std::vector<uint8_t> _scratch;
+    Measure _measures[MEASURE_SLOTS] = {};
+    uint8_t _nextMeasure = 0;
+    size_t _budget;
+    size_t _used = 0;
+
+    static void rasterise(const GFXfont* font, const GFXglyph* glyph, std::vector<uint8_t>& spans);
+    static uint32_t hash(const char* text);
+
+    const GFXglyph* glyphOf(const GFXfont* font, char c);
+    int16_t find(const GFXfont* font, char c);
+    const Measure& measure(const GFXfont* font, const char* text);
+    bool glyphBox(const GFXfont* font, char c, int16_t cursorX, int16_t y, Box& box, int16_t& advance);
+    int16_t extend(const GFXfont* font, const char* text, int16_t cursorX, int16_t y, Box& box);
+    void drawSpans(Adafruit_GFX* display, const uint8_t* spans, uint16_t count, int16_t x, int16_t y, uint16_t color);
+
+  public:
+    GlyphCache(size_t budget = CW_GLYPH_CACHE_BUDGET);
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    // Like Adafruit_GFX::getTextBounds with the cursor at x,y
+    void getTextBounds(Adafruit_GFX* display, const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h);
+    // Draws like setFont/setCursor/setTextColor/print
+    void print(Adafruit_GFX* display, const GFXfont* font, const char* text, int16_t x, int16_t y, uint16_t color);
+    // Draws text over previous, printed at the same place: only the glyphs from the first
+    // one that changed are cleared and drawn again. Both are a single line
+    void reprint(Adafruit_GFX* display, const GFXfont* font, const char* previous, const char* text, int16_t x, int16_t y, uint16_t color, uint16_t bgColor);
+
+    void clear();
+    size_t usedBytes() { return _used; }
+};
@@ -2,6 +2,9 @@
 
 Adafruit_GFX* Locator::_display;
 EventBus* Locator::_eventBus;
+GlyphCache Locator::_glyphCache;
+FontRegistry Locator::_fontRegistry;
+SpatialGrid Locator::_spatialGrid;
 
 void Locator::provide(Adafruit_GFX* display)
 {
@@ -22,3 +25,18 @@ EventBus* Locator::getEventBus()
 { 
   return _eventBus; 
 }
+
+GlyphCache* Locator::getGlyphCache() 
+{ 
+  return &_glyphCache; 
+}
+
+FontRegistry* Locator::getFontRegistry() 
+{ 
+  return &_fontRegistry; 
+}
+
+SpatialGrid* Locator::getSpatialGrid() 
+{ 
+  return &_spatialGrid; 
+}
@@ -3,15 +3,24 @@
 #include <Arduino.h>
 #include <Adafruit_GFX.h>
 #include "EventBus.h"
+#include "GlyphCache.h"
+#include "FontRegistry.h"
+#include "SpatialGrid.h"
 
 class Locator {
   private: 
     static Adafruit_GFX* _display;
     static EventBus* _eventBus;
+    static GlyphCache _glyphCache;
+    static FontRegistry _fontRegistry;
+    static SpatialGrid _spatialGrid;
 
   public:    
     static Adafruit_GFX* getDisplay();
     static EventBus* getEventBus();
+    static GlyphCache* getGlyphCache();
+    static FontRegistry* getFontRegistry();
+    static SpatialGrid* getSpatialGrid();
     static void provide(Adafruit_GFX* display);
     static void provide(EventBus* eventBus);
 };
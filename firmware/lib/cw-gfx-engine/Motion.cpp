@@ -0,0 +1,77 @@
+#include "Motion.h"
+
+// Easing curves sampled at progress 0, 4, 8 ... 256, values in 1/256
+static const uint8_t EASING_STEPS = 64;
+static const uint16_t EASING_TABLES[EASING_COUNT - 1][EASING_STEPS + 1] = {
+  // in, t^2
+  {   0,   0,   0,   1,   1,   2,   2,   3,   4,   5,   6,   8,   9,
+     11,  12,  14,  16,  18,  20,  23,  25,  28,  30,  33,  36,  39,
+     42,  46,  49,  53,  56,  60,  64,  68,  72,  77,  81,  86,  90,
+     95, 100, 105, 110, 116, 121, 127, 132, 138, 144, 150, 156, 163,
+    169, 176, 182, 189, 196, 203, 210, 218, 225, 233, 240, 248, 256 },
+  // out, 1 - (1 - t)^2
+  {   0,   8,  16,  23,  31,  38,  46,  53,  60,  67,  74,  80,  87,
+     93, 100, 106, 112, 118, 124, 129, 135, 140, 146, 151, 156, 161,
+    166, 170, 175, 179, 184, 188, 192, 196, 200, 203, 207, 210, 214,
+    217, 220, 223, 226, 228, 231, 233, 236, 238, 240, 242, 244, 245,
+    247, 248, 250, 251, 252, 253, 254, 254, 255, 255, 256, 256, 256 },
+  // in-out, quadratic
+  {   0,   0,   0,   1,   2,   3,   4,   6,   8,  10,  12,  15,  18,
+     21,  24,  28,  32,  36,  40,  45,  50,  55,  60,  66,  72,  78,
+     84,  91,  98, 105, 112, 120, 128, 136, 144, 151, 158, 165, 172,
+    178, 184, 190, 196, 201, 206, 211, 216, 220, 224, 228, 232, 235,
+    238, 241, 244, 246, 248, 250, 252, 253, 254, 255, 256, 256, 256 },
+  // bounce, three rebounds before settling
+  {   0,   0,   2,   4,   8,  12,  17,  23,  30,  38,  47,  57,  68,
+     80,  93, 106, 121, 137, 153, 171, 189, 208, 229, 250, 248, 238,
+    230, 222, 215, 209, 203, 199, 196, 194, 192, 192, 193, 194, 197,
+    200, 204, 210, 216, 223, 231, 240, 250, 254, 249, 245, 243, 241,
+    240, 240, 241, 243, 246, 250, 255, 254, 253, 252, 252, 254, 256 },
+};
+
+uint16_t Motion::ease(Easing easing, uint16_t progress) {
+  if (progress >= FIXED_ONE)
+    return FIXED_ONE;
+
+  if (easing == EASING_LINEAR || easing >= EASING_COUNT)
+    return progress;
+
+  // Linear between the two nearest samples
+  const uint16_t* table = EASING_TABLES[easing - 1];
+  uint8_t index = progress >> 2;
+  int16_t step = table[index + 1] - table[index];
+
+  return table[index] + step * (progress & 3) / 4;
+}
+
+void Motion::start(int8_t fromX, int8_t fromY, const Keyframe* path, uint8_t count, unsigned long now) {
+  _path = path;
+  _count = count;
+  _segment = 0;
+  _segmentStart = now;
+  x = _fromX = TO_FIXED(fromX);
+  y = _fromY = TO_FIXED(fromY);
+}
+
+bool Motion::update(unsigned long now) {
+  while (_segment < _count) {
+    const Keyframe& keyframe = _path[_segment];
+    unsigned long elapsed = now - _segmentStart;
+    fixed_t toX = TO_FIXED(keyframe.x);
+    fixed_t toY = TO_FIXED(keyframe.y);
+
+    if (elapsed < keyframe.duration) {
+      int32_t eased = ease(keyframe.easing, (elapsed << FIXED_SHIFT) / keyframe.duration);
+      x = _fromX + (toX - _fromX) * eased / FIXED_ONE;
+      y = _fromY + (toY - _fromY) * eased / FIXED_ONE;
+      return true;
+    }
+
+    // The next segment starts where this one ended, late frames skip ahead
+    x = _fromX = toX;
+    y = _fromY = toY;
+    _segmentStart += keyframe.duration;
+    _segment++;
+  }
+  return false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Q8.8 fixed point: a pixel position with 8 bits of sub-pixel precision
+typedef int16_t fixed_t;
+
+#define FIXED_SHIFT 8
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define TO_FIXED(v) ((fixed_t)((v) * FIXED_ONE))
+
+enum Easing : uint8_t {
+  EASING_LINEAR,
+  EASING_IN,
+  EASING_OUT,
+  EASING_IN_OUT,
+  EASING_BOUNCE,
+  EASING_COUNT
+};
+
+// A point of a path, reached duration ms after the previous one
+struct Keyframe {
+  int8_t x, y;
+  Easing easing;
+  uint16_t duration;
+};
+
+// Moves a position along a path of keyframes with integer math only: progress is a
+// fraction of 256, eased through a precomputed table, and positions are Q8.8 so slow
+// moves advance by fractions of a pixel instead of stalling on truncation.
+class Motion {
+  private:
+    const Keyframe* _path = nullptr;
+    uint8_t _count = 0;
+    uint8_t _segment = 0;
+    unsigned long _segmentStart = 0;
+    fixed_t _fromX = 0;
+    fixed_t _fromY = 0;
+
+  public:
+    fixed_t x = 0;
+    fixed_t y = 0;
+
+    // progress and result are fractions of FIXED_ONE (0..256)
+    static uint16_t ease(Easing easing, uint16_t progress);
+
+    // The path is not copied, it has to outlive the motion
+    void start(int8_t fromX, int8_t fromY, const Keyframe* path, uint8_t count, unsigned long now);
+    // Advances to now, false once the last keyframe was reached
+    bool update(unsigned long now);
+    void stop() { _segment = _count; }
+    bool isMoving() const { return _segment < _count; }
+
+    int8_t pixelX() { return (x + FIXED_ONE / 2) >> FIXED_SHIFT; }
+    int8_t pixelY() { return (y + FIXED_ONE / 2) >> FIXED_SHIFT; }
+};
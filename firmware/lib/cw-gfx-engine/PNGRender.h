@@ -0,0 +1,387 @@
+#pragma once
+
+#include <Locator.h>
+#include <PNGdec.h>
+#include <vector>
+#include "SpriteCache.h"
+#include "AnimationDecoder.h"
+
+static PNG png;
+
+typedef struct png_position
+{
+  uint8_t xoff, yoff;
+  PNG *decoder;
+  Adafruit_GFX *display;
+  uint16_t *line;     // one row of the image, drawn as soon as it is decoded
+  uint16_t *pixels;   // decoding into memory instead of a display
+  uint8_t *mask;      // the whole mask in memory, or one row of it when drawing
+} PNG_POSITION;
+
+
+static void PNGDraw(PNGDRAW *pDraw)
+{
+  PNG_POSITION *pPos = (PNG_POSITION *)pDraw->pUser;
+
+  pPos->decoder->getLineAsRGB565(pDraw, pPos->line, PNG_RGB565_LITTLE_ENDIAN, 0xffffffff);
+
+  if (pPos->mask != nullptr && pPos->decoder->getAlphaMask(pDraw, pPos->mask, 128))
+    pPos->display->drawRGBBitmap(pPos->xoff, pPos->yoff + pDraw->y, pPos->line, pPos->mask, pDraw->iWidth, 1);
+  else
+    pPos->display->drawRGBBitmap(pPos->xoff, pPos->yoff + pDraw->y, pPos->line, pDraw->iWidth, 1);
+}
+
+
+static void PNGDecodeLine(PNGDRAW *pDraw)
+{
+  PNG_POSITION *pPos = (PNG_POSITION *)pDraw->pUser;
+
+  pPos->decoder->getLineAsRGB565(pDraw, pPos->pixels + pDraw->y * pDraw->iWidth, PNG_RGB565_LITTLE_ENDIAN, 0xffffffff);
+
+  if (pPos->mask != nullptr)
+    pPos->decoder->getAlphaMask(pDraw, pPos->mask + pDraw->y * SpriteCache::maskStride(pDraw->iWidth), 128);
+}
+
+
+// A base64 string read by PNGdec as if it was the PNG file: bytes are decoded as they are
+// read, straight into PNGdec's own buffer. Byte n comes from characters 4 * (n / 3)
+// onwards, so a seek costs nothing and no copy of the file is ever made.
+struct Base64Source
+{
+  const char *text;
+  int32_t size;   // decoded bytes
+};
+
+
+static int8_t base64Value(char c)
+{
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == '+' || c == '/')
+    return (c == '+' ? 62 : 63);
+  return -1;
+}
+
+
+static void *Base64Open(const char *source, int32_t *pFileSize)
+{
+  Base64Source *src = (Base64Source *)source;
+  *pFileSize = src->size;
+  return (void *)src;
+}
+
+
+static void Base64Close(void *pHandle)
+{
+}
+
+
+// An invalid character ends the file early, PNGdec then fails on a truncated image
+static int32_t Base64Read(PNGFILE *pFile, uint8_t *pBuf, int32_t iLen)
+{
+  Base64Source *src = (Base64Source *)pFile->fHandle;
+  int32_t count = 0;
+
+  if (iLen > pFile->iSize - pFile->iPos)
+    iLen = pFile->iSize - pFile->iPos;
+
+  for (; count < iLen; count++)
+  {
+    int32_t position = pFile->iPos + count;
+    const char *quad = src->text + position / 3 * 4;
+    uint8_t part = position % 3;
+    int8_t high = base64Value(quad[part]);
+    int8_t low = base64Value(quad[part + 1]);
+
+    if (high < 0 || low < 0)
+      break;
+
+    pBuf[count] = (high << (2 + 2 * part)) | (low >> (4 - 2 * part));
+  }
+
+  pFile->iPos += count;
+  return count;
+}
+
+
+static int32_t Base64Seek(PNGFILE *pFile, int32_t iPosition)
+{
+  pFile->iPos = iPosition;
+  return iPosition;
+}
+
+
+static Base64Source imageSource;
+
+static Base64Source base64Source(const char *base64)
+{
+  int32_t length = strlen(base64);
+  while (length > 0 && base64[length - 1] == '=')
+    length--;
+
+  return {base64, length * 3 / 4};
+}
+
+
+static bool openImage(const char *base64Image, PNG_DRAW_CALLBACK *drawCallback = PNGDraw)
+{
+  imageSource = base64Source(base64Image);
+
+  int rc = png.open((const char *)&imageSource, Base64Open, Base64Close, Base64Read, Base64Seek, drawCallback);
+
+  return (rc == PNG_SUCCESS);
+}
+
+
+// masked leaves the transparent pixels of the image as they are, like a cached sprite
+static void renderImage(const char *base64Image, const uint8_t x, const uint8_t y, bool masked = false)
+{
+  PNG_POSITION pos = {};
+
+  if (openImage(base64Image))
+  {
+    std::vector<uint16_t> line(png.getWidth());
+    std::vector<uint8_t> mask(masked && png.hasAlpha() ? SpriteCache::maskStride(png.getWidth()) : 0);
+
+    pos.xoff = x;
+    pos.yoff = y;
+    pos.line = line.data();
+    pos.mask = (mask.empty() ? nullptr : mask.data());
+    pos.decoder = &png;
+    pos.display = Locator::getDisplay();
+    int rc = png.decode((void *)&pos, 0);
+
+    png.close();
+  }
+}
+
+
+static void getImageDimensions(const char *base64Image, uint8_t &width, uint8_t &height)
+{
+  if (openImage(base64Image)) {
+    width = png.getWidth();
+    height = png.getHeight();
+
+    png.close();
+  }
+}
+
+
+// Decodes an image once into the cache, or finds it there when the same image was already
+// added. Returns the cache handle, -1 when it does not fit (then keep using renderImage()).
+static int16_t cacheImage(SpriteCache &cache, const char *base64Image)
+{
+  uint64_t hash = SpriteCache::hash(base64Image);
+  int16_t handle = cache.find(hash);
+  if (handle >= 0 || !openImage(base64Image, PNGDecodeLine))
+    return handle;
+
+  PNG_POSITION pos = {};
+  if (png.getWidth() <= UINT8_MAX && png.getHeight() <= UINT8_MAX)
+    handle = cache.insert(hash, png.getWidth(), png.getHeight(), png.hasAlpha(), &pos.pixels, &pos.mask);
+
+  if (handle >= 0)
+  {
+    pos.decoder = &png;
+    if (png.decode((void *)&pos, 0) != PNG_SUCCESS)
+    {
+      cache.discardLast();
+      handle = -1;
+    }
+  }
+
+  png.close();
+  return handle;
+}
+
+
+// A GIF is read back and forth by the decoder, an animation is decoded to memory while it is used
+static bool openAnimation(AnimationDecoder &animation, const char *base64, std::vector<uint8_t> &data)
+{
+  Base64Source source = base64Source(base64);
+  PNGFILE file = {0, source.size, nullptr, &source};
+  data.resize(source.size);
+
+  if (Base64Read(&file, data.data(), source.size) != source.size)
+    return false;
+
+  return animation.open(data.data(), data.size(), &png);
+}
+
+
+// Decodes all the frames of an animation in a single pass, each one cached as an image of
+// its own. handles gets count entries, -1 for the frames that did not fit.
+static void cacheAnimation(SpriteCache &cache, const char *base64, int16_t *handles, uint8_t count)
+{
+  AnimationDecoder animation;
+  std::vector<uint8_t> data;
+  uint64_t hash = SpriteCache::hash(base64);
+
+  for (uint8_t i = 0; i < count; i++)
+    handles[i] = -1;
+
+  if (!openAnimation(animation, base64, data))
+    return;
+
+  for (uint8_t i = 0; i < count && animation.next(); i++)
+  {
+    // The frames share the animation's hash, told apart by their index in the top byte
+    uint64_t key = hash ^ ((uint64_t)(i + 1) << 56);
+    uint16_t *pixels;
+    uint8_t *mask;
+
+    handles[i] = cache.find(key);
+    if (handles[i] >= 0)
+      continue;
+
+    // Frames all have the same size, once one does not fit the next ones will not either
+    handles[i] = cache.insert(key, animation.width(), animation.height(), animation.hasMask(), &pixels, &mask);
+    if (handles[i] < 0)
+      break;
+
+    memcpy(pixels, animation.pixels(), animation.width() * animation.height() * sizeof(uint16_t));
+    if (mask != nullptr)
+      memcpy(mask, animation.mask(), animation.maskStride() * animation.height());
+  }
+}
+
+
+// A frame that did not fit in the cache, every frame before it is decoded again
+static void renderAnimationFrame(const char *base64, uint8_t index, const uint8_t x, const uint8_t y)
+{
+  AnimationDecoder animation;
+  std::vector<uint8_t> data;
+
+  if (!openAnimation(animation, base64, data))
+    return;
+
+  for (uint8_t i = 0; i <= index; i++)
+    if (!animation.next())
+      return;
+
+  if (animation.hasMask())
+    Locator::getDisplay()->drawRGBBitmap(x, y, animation.pixels(), animation.mask(), animation.width(), animation.height());
+  else
+    Locator::getDisplay()->drawRGBBitmap(x, y, animation.pixels(), animation.width(), animation.height());
+}
+
+
+// Feeds PNGdec straight from a Stream (e.g. a socket), without staging the whole file.
+// PNGdec seeks back to re-read chunk headers that straddle its own read buffer, so the
+// last PNG_FILE_BUF_SIZE bytes received are kept to replay them.
+struct PNGStreamSource
+{
+  Stream *stream;
+  int32_t size;
+  int32_t received;
+  uint8_t history[PNG_FILE_BUF_SIZE];
+};
+
+
+static void *PNGStreamOpen(const char *source, int32_t *pFileSize)
+{
+  PNGStreamSource *src = (PNGStreamSource *)source;
+  *pFileSize = src->size;
+  return (void *)src;
+}
+
+
+static void PNGStreamClose(void *pHandle)
+{
+}
+
+
+static int32_t PNGStreamRead(PNGFILE *pFile, uint8_t *pBuf, int32_t iLen)
+{
+  PNGStreamSource *src = (PNGStreamSource *)pFile->fHandle;
+  int32_t count = 0;
+
+  if (iLen > pFile->iSize - pFile->iPos)
+    iLen = pFile->iSize - pFile->iPos;
+
+  // Replay bytes already taken from the stream
+  while (count < iLen && pFile->iPos < src->received)
+  {
+    if (src->received - pFile->iPos > PNG_FILE_BUF_SIZE)
+      return count;
+
+    pBuf[count++] = src->history[pFile->iPos % PNG_FILE_BUF_SIZE];
+    pFile->iPos++;
+  }
+
+  // A forward seek skips bytes, they are only kept in the history
+  while (src->received < pFile->iPos)
+  {
+    uint8_t c;
+    if (src->stream->readBytes(&c, 1) != 1)
+      return count;
+
+    src->history[src->received % PNG_FILE_BUF_SIZE] = c;
+    src->received++;
+  }
+
+  if (count < iLen)
+  {
+    int32_t n = src->stream->readBytes(pBuf + count, iLen - count);
+
+    for (int32_t i = 0; i < n; i++)
+      src->history[(src->received + i) % PNG_FILE_BUF_SIZE] = pBuf[count + i];
+
+    src->received += n;
+    pFile->iPos += n;
+    count += n;
+  }
+
+  return count;
+}
+
+
+static int32_t PNGStreamSeek(PNGFILE *pFile, int32_t iPosition)
+{
+  pFile->iPos = iPosition;
+  return iPosition;
+}
+
+
+static bool openImageStream(PNG *decoder, PNGStreamSource *source)
+{
+  source->received = 0;
+
+  int rc = decoder->open((const char *)source, PNGStreamOpen, PNGStreamClose, PNGStreamRead, PNGStreamSeek, PNGDraw);
+
+  return (rc == PNG_SUCCESS);
+}
+
+
+// Decodes a PNG from a stream onto the given display, refused when it is larger than
+// maxWidth x maxHeight
+static bool renderImageStream(PNG *decoder, PNGStreamSource *source, Adafruit_GFX *display, const uint8_t x, const uint8_t y,
+                              uint8_t maxWidth = UINT8_MAX, uint8_t maxHeight = UINT8_MAX)
+{
+  PNG_POSITION pos = {};
+
+  if (!openImageStream(decoder, source))
+    return false;
+
+  if (decoder->getWidth() > maxWidth || decoder->getHeight() > maxHeight)
+  {
+    decoder->close();
+    return false;
+  }
+
+  std::vector<uint16_t> line(decoder->getWidth());
+
+  pos.xoff = x;
+  pos.yoff = y;
+  pos.line = line.data();
+  pos.decoder = decoder;
+  pos.display = display;
+  int rc = decoder->decode((void *)&pos, 0);
+
+  decoder->close();
+  return (rc == PNG_SUCCESS);
+}
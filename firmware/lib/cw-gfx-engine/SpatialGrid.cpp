@@ -0,0 +1,148 @@
+#include "SpatialGrid.h"
+#include "Locator.h"
+
+void SpatialGrid::mark(uint8_t slot, bool set) {
+  const Entry& entry = _entries[slot];
+  uint64_t bit = (uint64_t)1 << slot;
+
+  for (uint8_t row = entry.top; row <= entry.bottom && entry.left <= entry.right; row++) {
+    for (uint8_t column = entry.left; column <= entry.right; column++) {
+      if (set) {
+        _cells[row * COLUMNS + column] |= bit;
+      } else {
+        _cells[row * COLUMNS + column] &= ~bit;
+      }
+    }
+  }
+}
+
+// Slots of the sprites overlapping the area, only the ones in the cells it covers are tested
+uint64_t SpatialGrid::overlapping(int16_t x, int16_t y, int16_t width, int16_t height) const {
+  int16_t left = max(x, (int16_t)0) >> CELL_SHIFT;
+  int16_t top = max(y, (int16_t)0) >> CELL_SHIFT;
+  int16_t right = min((int16_t)(x + width - 1), (int16_t)((COLUMNS << CELL_SHIFT) - 1)) >> CELL_SHIFT;
+  int16_t bottom = min((int16_t)(y + height - 1), (int16_t)((ROWS << CELL_SHIFT) - 1)) >> CELL_SHIFT;
+  uint64_t candidates = 0;
+  uint64_t found = 0;
+
+  if (width <= 0 || height <= 0) {
+    return 0;
+  }
+
+  for (int16_t row = top; row <= bottom; row++) {
+    for (int16_t column = left; column <= right; column++) {
+      candidates |= _cells[row * COLUMNS + column];
+    }
+  }
+
+  for (uint8_t i = 0; candidates != 0; i++, candidates >>= 1) {
+    const Sprite* sprite = _entries[i].sprite;
+
+    if ((candidates & 1) &&
+        x < sprite->_x + sprite->_width && x + width > sprite->_x &&
+        y < sprite->_y + sprite->_height && y + height > sprite->_y) {
+      found |= (uint64_t)1 << i;
+    }
+  }
+  return found;
+}
+
+// Forgets the pairs the slot made with the others, both ways
+void SpatialGrid::separate(uint8_t slot, uint64_t others) {
+  _touching[slot] &= ~others;
+
+  for (uint8_t i = 0; others != 0; i++, others >>= 1) {
+    if (others & 1) {
+      _touching[i] &= ~((uint64_t)1 << slot);
+    }
+  }
+}
+
+bool SpatialGrid::add(Sprite* sprite, EventTask* task) {
+  if (sprite->_gridSlot >= 0) {
+    update(sprite);
+    return true;
+  }
+
+  for (uint8_t i = 0; i < SPATIALGRID_MAX_SPRITES; i++) {
+    if (_entries[i].sprite == nullptr) {
+      _entries[i] = {sprite, task, 1, 0, 0, 0};
+      sprite->_gridSlot = i;
+      update(sprite);
+      return true;
+    }
+  }
+
+  Serial.println("[SpatialGrid] Out of space");
+  return false;
+}
+
+void SpatialGrid::remove(Sprite* sprite) {
+  int8_t slot = sprite->_gridSlot;
+
+  if (slot >= 0) {
+    mark(slot, false);
+    separate(slot, _touching[slot]);
+    _entries[slot] = {};
+    sprite->_gridSlot = -1;
+  }
+}
+
+void SpatialGrid::update(Sprite* sprite) {
+  int8_t slot = sprite->_gridSlot;
+  if (slot < 0) {
+    return;
+  }
+
+  Entry& entry = _entries[slot];
+  int16_t right = min(sprite->_x + sprite->_width - 1, (COLUMNS << CELL_SHIFT) - 1);
+  int16_t bottom = min(sprite->_y + sprite->_height - 1, (ROWS << CELL_SHIFT) - 1);
+
+  mark(slot, false);
+  if (sprite->_width == 0 || sprite->_height == 0 || right < 0 || bottom < 0) {
+    entry.left = 1;
+    entry.right = 0;
+  } else {
+    entry.left = max((int16_t)sprite->_x, (int16_t)0) >> CELL_SHIFT;
+    entry.top = max((int16_t)sprite->_y, (int16_t)0) >> CELL_SHIFT;
+    entry.right = right >> CELL_SHIFT;
+    entry.bottom = bottom >> CELL_SHIFT;
+  }
+  mark(slot, true);
+
+  uint64_t bit = (uint64_t)1 << slot;
+  uint64_t others = overlapping(sprite->_x, sprite->_y, sprite->_width, sprite->_height) & ~bit;
+  uint64_t started = others & ~_touching[slot];
+
+  separate(slot, _touching[slot] & ~others);
+  _touching[slot] = others;
+
+  for (uint8_t i = 0; started != 0; i++, started >>= 1) {
+    if (!(started & 1)) {
+      continue;
+    }
+
+    Sprite* other = _entries[i].sprite;
+    EventTask* task = entry.task;
+    _touching[i] |= bit;
+
+    if (_entries[i].task != nullptr) {
+      Locator::getEventBus()->send(COLLISION, sprite, _entries[i].task);
+    }
+    if (task != nullptr) {
+      Locator::getEventBus()->send(COLLISION, other, task);
+    }
+  }
+}
+
+uint8_t SpatialGrid::query(int16_t x, int16_t y, int16_t width, int16_t height, Sprite** found, uint8_t max, const Sprite* except) const {
+  uint64_t slots = overlapping(x, y, width, height);
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; slots != 0 && count < max; i++, slots >>= 1) {
+    if ((slots & 1) && _entries[i].sprite != except) {
+      found[count++] = _entries[i].sprite;
+    }
+  }
+  return count;
+}
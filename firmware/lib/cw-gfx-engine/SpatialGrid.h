@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Sprite.h"
+#include "EventTask.h"
+
+// Sprites the grid can hold, one bit each in every cell
+#ifndef SPATIALGRID_MAX_SPRITES
+  #define SPATIALGRID_MAX_SPRITES 64
+#endif
+
+// Broadphase for sprite collisions: the 64x64 display cut in 8x8 cells, each one knowing
+// which sprites cover it. A query only tests the sprites found in the cells it covers, so
+// the cost follows the sprites nearby instead of all of them.
+// Sprites are indexed by the part of them on the display, one entirely off it collides
+// with nothing. Sprites tell the grid when they move; it then sends a COLLISION through
+// the EventBus to both sprites of every pair that starts to overlap. A pair still
+// overlapping after the move is not sent again until it has been apart.
+class SpatialGrid {
+  private:
+    static constexpr uint8_t CELL_SHIFT = 3;
+    static constexpr uint8_t COLUMNS = 8;
+    static constexpr uint8_t ROWS = 8;
+
+    struct Entry {
+      Sprite* sprite;
+      EventTask* task;
+      uint8_t left, top, right, bottom;   // cells covered, inclusive, left > right when none
+    };
+
+    uint64_t _cells[COLUMNS * ROWS] = {};
+    Entry _entries[SPATIALGRID_MAX_SPRITES] = {};
+    uint64_t _touching[SPATIALGRID_MAX_SPRITES] = {};   // slots each sprite overlapped when last checked
+
+    void mark(uint8_t slot, bool set);
+    void separate(uint8_t slot, uint64_t others);
+    uint64_t overlapping(int16_t x, int16_t y, int16_t width, int16_t height) const;
+
+  public:
+    // task gets the COLLISION events of the sprite, nullptr when nobody listens
+    bool add(Sprite* sprite, EventTask* task = nullptr);
+    void remove(Sprite* sprite);
+    // To be called once the sprite moved or changed size
+    void update(Sprite* sprite);
+
+    // Sprites overlapping the area, up to max of them, except the one given
+    uint8_t query(int16_t x, int16_t y, int16_t width, int16_t height, Sprite** found, uint8_t max, const Sprite* except = nullptr) const;
+};
@@ -12,3 +12,7 @@ void Sprite::logPosition() {
   Serial.print("x = "); Serial.print(_x); Serial.print(", y = "); Serial.print(_y); 
   Serial.print(", w = "); Serial.print(_width); Serial.print(", h = "); Serial.println(_height);
 }
+
+const char* Sprite::name() {
+  return "Sprite";
+}
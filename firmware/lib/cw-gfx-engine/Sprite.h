@@ -3,12 +3,14 @@
 #include <Arduino.h>
 
 class Sprite {
+  friend class SpatialGrid;
 
   protected:
     int8_t _x = 0;
     int8_t _y = 0;
     uint8_t _width = 0;
     uint8_t _height = 0;
+    int8_t _gridSlot = -1;
 
   public:
     boolean collidedWith(Sprite* sprite);
@@ -0,0 +1,149 @@
+#include "SpriteAnimator.h"
+
+void SpriteAnimator::begin(const SpriteAnimation* table, SpriteRenderer* renderer) {
+  clear();
+  _table = table;
+  _renderer = renderer;
+}
+
+void SpriteAnimator::clear() {
+  _animation.clear();
+  _x.clear();
+  _y.clear();
+  _width.clear();
+  _height.clear();
+  _motion.clear();
+  _frame.clear();
+  _framesShown.clear();
+  _lastFrame.clear();
+  _lastLoop.clear();
+  _lastMove.clear();
+  _due.clear();
+  _moved.clear();
+}
+
+uint16_t SpriteAnimator::add(uint16_t animation, int8_t x, int8_t y, uint8_t width, uint8_t height) {
+  _animation.push_back(animation);
+  _x.push_back(x);
+  _y.push_back(y);
+  _width.push_back(width);
+  _height.push_back(height);
+  _motion.emplace_back();
+  _frame.push_back(0);
+  _framesShown.push_back(0);
+  _lastFrame.push_back(0);
+  _lastLoop.push_back(0);
+  _lastMove.push_back(0);
+  _due.push_back(false);
+  _moved.push_back(false);
+
+  return _animation.size() - 1;
+}
+
+void SpriteAnimator::play(uint16_t sprite, uint16_t animation, unsigned long now) {
+  const SpriteAnimation& row = _table[animation];
+
+  _animation[sprite] = animation;
+  _framesShown[sprite] = 0;
+  _lastLoop[sprite] = now;
+  _lastMove[sprite] = now;
+
+  // The update advances before drawing, so the first frame shown is frame 0, right away
+  _frame[sprite] = row.frameCount - 1;
+  _lastFrame[sprite] = now - frameDelay(row, _frame[sprite]);
+
+  if (row.keyframeCount > 0) {
+    _motion[sprite].start(_x[sprite], _y[sprite], row.path, row.keyframeCount, now);
+  } else {
+    _motion[sprite].stop();
+  }
+}
+
+void SpriteAnimator::moveTo(uint16_t sprite, int8_t x, int8_t y) {
+  if (x == _x[sprite] && y == _y[sprite]) {
+    return;
+  }
+
+  _renderer->eraseSprite(_x[sprite], _y[sprite], _width[sprite], _height[sprite]);
+  _x[sprite] = x;
+  _y[sprite] = y;
+  _moved[sprite] = true;
+}
+
+bool SpriteAnimator::playing(uint16_t sprite) const {
+  const SpriteAnimation& animation = _table[_animation[sprite]];
+
+  return (_framesShown[sprite] < animation.frameCount || animation.loopDelay == SPRITE_LOOP_ENDLESS || _motion[sprite].isMoving());
+}
+
+bool SpriteAnimator::onTime(uint32_t delay, unsigned long since, uint8_t second) {
+  return (delay > 0 && since >= delay && (second * 1000UL) % delay == 0);
+}
+
+uint32_t SpriteAnimator::frameDelay(const SpriteAnimation& animation, uint8_t frame) {
+  if (animation.frameDelays != nullptr && animation.frameDelays[frame] > 0) {
+    return animation.frameDelays[frame];
+  }
+  return animation.frameDelay;
+}
+
+void SpriteAnimator::update(unsigned long now, uint8_t second) {
+  size_t count = _animation.size();
+
+  for (size_t i = 0; i < count; i++) {
+    const SpriteAnimation& animation = _table[_animation[i]];
+
+    _due[i] = (now - _lastFrame[i] >= frameDelay(animation, _frame[i]) && (_framesShown[i] < animation.frameCount || animation.loopDelay == SPRITE_LOOP_ENDLESS));
+  }
+
+  // Every sprite is erased before any is drawn, so one moving off another does not cut it
+  for (size_t i = 0; i < count; i++) {
+    if (!_due[i]) {
+      continue;
+    }
+
+    Motion& motion = _motion[i];
+    if (motion.isMoving()) {
+      motion.update(now);
+
+      int8_t newX = motion.pixelX();
+      int8_t newY = motion.pixelY();
+
+      // Sub-pixel steps only need a redraw once they add up to a pixel
+      if (newX != _x[i] || newY != _y[i]) {
+        int8_t originX = min(_x[i], newX);
+        int8_t originY = min(_y[i], newY);
+
+        _renderer->eraseSprite(originX, originY, _width[i] + max(_x[i], newX) - originX, _height[i] + max(_y[i], newY) - originY);
+        _x[i] = newX;
+        _y[i] = newY;
+      }
+    }
+
+    const SpriteAnimation& animation = _table[_animation[i]];
+    if (animation.keyframeCount > 0 && !motion.isMoving() && onTime(animation.moveStartTime, now - _lastMove[i], second)) {
+      _lastMove[i] = now;
+      motion.start(_x[i], _y[i], animation.path, animation.keyframeCount, now);
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (_due[i]) {
+      _frame[i] = (_frame[i] + 1 < _table[_animation[i]].frameCount ? _frame[i] + 1 : 0);
+      _framesShown[i]++;
+      _lastFrame[i] = now;
+    } else if (!_moved[i]) {
+      continue;
+    }
+
+    _renderer->drawSprite(i, _frame[i], _x[i], _y[i]);
+    _moved[i] = false;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (onTime(_table[_animation[i]].loopDelay, now - _lastLoop[i], second)) {
+      _framesShown[i] = 0;
+      _lastLoop[i] = now;
+    }
+  }
+}
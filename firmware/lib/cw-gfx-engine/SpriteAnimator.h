@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+#include "Motion.h"
+
+// loopDelay of frames that keep playing one after the other
+const uint32_t SPRITE_LOOP_ENDLESS = UINT32_MAX;
+
+// One row of an animation table: how a sprite steps through its frames and moves. Rows
+// are described once and shared by every sprite playing them, they must outlive the
+// animator.
+struct SpriteAnimation {
+  uint8_t frameCount;
+  uint32_t frameDelay;           // ms each frame stays
+  const uint16_t* frameDelays;   // ms of each frame, 0 or nullptr for frameDelay
+  uint32_t loopDelay;            // frames play again every loopDelay ms, 0 to play them once
+  const Keyframe* path;          // followed from wherever the sprite is
+  uint8_t keyframeCount;
+  uint32_t moveStartTime;        // path started every moveStartTime ms, 0 only by play()
+};
+
+// Does the drawing for the animator, which only knows sprites by their index
+class SpriteRenderer {
+  public:
+    virtual void eraseSprite(int16_t x, int16_t y, int16_t width, int16_t height) = 0;
+    virtual void drawSprite(uint16_t sprite, uint8_t frame, int16_t x, int16_t y) = 0;
+};
+
+// Plays the animations of many sprites at once. The state of the sprites is kept field
+// by field in arrays and each update goes over them in passes (timers, then movement,
+// then drawing, then loops), so its cost grows linearly with the sprites without any
+// virtual call per sprite.
+// Timers follow the clock: a loop or a move starts on the seconds that are a multiple
+// of its delay.
+class SpriteAnimator {
+  private:
+    const SpriteAnimation* _table = nullptr;
+    SpriteRenderer* _renderer = nullptr;
+
+    std::vector<uint16_t> _animation;
+    std::vector<int8_t> _x;
+    std::vector<int8_t> _y;
+    std::vector<uint8_t> _width;
+    std::vector<uint8_t> _height;
+    std::vector<Motion> _motion;
+    std::vector<uint8_t> _frame;
+    std::vector<uint8_t> _framesShown;
+    std::vector<unsigned long> _lastFrame;
+    std::vector<unsigned long> _lastLoop;
+    std::vector<unsigned long> _lastMove;
+    std::vector<uint8_t> _due;   // the sprites showing their next frame in this update
+    std::vector<uint8_t> _moved;   // moved by moveTo(), drawn again even when no frame is due
+
+    static bool onTime(uint32_t delay, unsigned long since, uint8_t second);
+    static uint32_t frameDelay(const SpriteAnimation& animation, uint8_t frame);
+
+  public:
+    void begin(const SpriteAnimation* table, SpriteRenderer* renderer);
+    void clear();
+    // Index of the sprite, the one given to the renderer
+    uint16_t add(uint16_t animation, int8_t x, int8_t y, uint8_t width, uint8_t height);
+    // Plays another row from its first frame, its path starting right away from where the sprite is
+    void play(uint16_t sprite, uint16_t animation, unsigned long now);
+    // For sprites moved by their own code: erased now, drawn there at the next update
+    void moveTo(uint16_t sprite, int8_t x, int8_t y);
+
+    void update(unsigned long now, uint8_t second);
+
+    size_t size() const { return _animation.size(); }
+    bool empty() const { return _animation.empty(); }
+    int8_t x(uint16_t sprite) const { return _x[sprite]; }
+    int8_t y(uint16_t sprite) const { return _y[sprite]; }
+    uint8_t frame(uint16_t sprite) const { return _frame[sprite]; }
+    // Frames left to show or a path not finished yet
+    bool playing(uint16_t sprite) const;
+};
@@ -0,0 +1,92 @@
+#include "SpriteCache.h"
+
+SpriteCache::SpriteCache(size_t budget) {
+  _budget = budget;
+}
+
+SpriteCache::~SpriteCache() {
+  clear();
+}
+
+// FNV-1a, 64 bits so distinct frames of a canvas do not realistically collide
+uint64_t SpriteCache::hash(const char* data) {
+  uint64_t hash = 14695981039346656037ULL;
+  while (*data) {
+    hash ^= (uint8_t)*data++;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+int16_t SpriteCache::find(uint64_t hash) {
+  for (size_t i = 0; i < _entries.size(); i++) {
+    if (_entries[i].hash == hash)
+      return i;
+  }
+  return -1;
+}
+
+int16_t SpriteCache::insert(uint64_t hash, uint8_t width, uint8_t height, bool withMask, uint16_t** pixels, uint8_t** mask) {
+  size_t pixelBytes = width * height * sizeof(uint16_t);
+  size_t maskBytes = (withMask ? maskStride(width) * height : 0);
+
+  if (width == 0 || height == 0 || _entries.size() >= INT16_MAX || _used + pixelBytes + maskBytes > _budget)
+    return -1;
+
+  Entry entry = {hash, (uint16_t*)malloc(pixelBytes), (withMask ? (uint8_t*)malloc(maskBytes) : nullptr), width, height};
+  if (entry.pixels == nullptr || (withMask && entry.mask == nullptr)) {
+    free(entry.pixels);
+    free(entry.mask);
+    return -1;
+  }
+
+  _entries.push_back(entry);
+  _used += pixelBytes + maskBytes;
+
+  *pixels = entry.pixels;
+  *mask = entry.mask;
+  return _entries.size() - 1;
+}
+
+void SpriteCache::discardLast() {
+  if (_entries.empty())
+    return;
+
+  Entry& entry = _entries.back();
+  _used -= entry.width * entry.height * sizeof(uint16_t) + (entry.mask != nullptr ? maskStride(entry.width) * entry.height : 0);
+  free(entry.pixels);
+  free(entry.mask);
+  _entries.pop_back();
+}
+
+bool SpriteCache::getDimensions(int16_t handle, uint8_t& width, uint8_t& height) {
+  if (handle < 0 || handle >= (int16_t)_entries.size())
+    return false;
+
+  width = _entries[handle].width;
+  height = _entries[handle].height;
+  return true;
+}
+
+bool SpriteCache::draw(int16_t handle, Adafruit_GFX* display, int16_t x, int16_t y, bool masked) {
+  if (handle < 0 || handle >= (int16_t)_entries.size())
+    return false;
+
+  Entry& entry = _entries[handle];
+  if (masked && entry.mask != nullptr)
+    display->drawRGBBitmap(x, y, entry.pixels, entry.mask, entry.width, entry.height);
+  else
+    display->drawRGBBitmap(x, y, entry.pixels, entry.width, entry.height);
+
+  return true;
+}
+
+void SpriteCache::clear() {
+  for (Entry& entry : _entries) {
+    free(entry.pixels);
+    free(entry.mask);
+  }
+  _entries.clear();
+  _entries.shrink_to_fit();
+  _used = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <vector>
+
+#ifndef CW_SPRITE_CACHE_BUDGET
+  #define CW_SPRITE_CACHE_BUDGET 32768
+#endif
+
+// Already decoded images (RGB565, plus a 1 bit mask when the image has transparency),
+// so an animation frame is drawn with a blit instead of base64 + inflate every time.
+// Images are found by a hash of their encoded content, so repeated frames share one entry.
+// Everything is allocated against a fixed budget; when it is exhausted insert() fails
+// and the caller keeps decoding that image on the fly.
+class SpriteCache {
+  private:
+    struct Entry {
+      uint64_t hash;
+      uint16_t* pixels;
+      uint8_t* mask;
+      uint8_t width;
+      uint8_t height;
+    };
+
+    std::vector<Entry> _entries;
+    size_t _budget;
+    size_t _used = 0;
+
+  public:
+    SpriteCache(size_t budget = CW_SPRITE_CACHE_BUDGET);
+    SpriteCache(const SpriteCache&) = delete;
+    SpriteCache& operator=(const SpriteCache&) = delete;
+    ~SpriteCache();
+
+    static uint64_t hash(const char* data);
+    static size_t maskStride(uint8_t width) { return (width + 7) / 8; }
+
+    int16_t find(uint64_t hash);
+
+    // Reserves a width x height image, the caller decodes into pixels/mask. Returns -1 past the budget
+    int16_t insert(uint64_t hash, uint8_t width, uint8_t height, bool withMask, uint16_t** pixels, uint8_t** mask);
+    // Drops an entry whose decoding failed, only valid for the last one inserted
+    void discardLast();
+
+    bool getDimensions(int16_t handle, uint8_t& width, uint8_t& height);
+    bool draw(int16_t handle, Adafruit_GFX* display, int16_t x, int16_t y, bool masked = false);
+
+    void clear();
+    // Applies to the next inserts, entries already cached stay
+    void setBudget(size_t budget) { _budget = budget; }
+    size_t usedBytes() { return _used; }
+    size_t count() { return _entries.size(); }
+};
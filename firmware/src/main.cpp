@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
+#include <FrameBuffer.h>
 
 // Clockface
 #include <Clockface.h>
@@ -9,6 +10,11 @@
 #include <CWPreferences.h>
 #include <CWWebServer.h>
 #include <StatusController.h>
+#include <CWMirror.h>
+#include <CWFramePush.h>
+#include <CWMetrics.h>
+#include <CWCanvasStore.h>
+#include <CWCanvasRefresh.h>
 
 #define MIN_BRIGHT_DISPLAY_ON 4
 #define MIN_BRIGHT_DISPLAY_OFF 0
@@ -16,6 +22,7 @@
 #define ESP32_LED_BUILTIN 2
 
 MatrixPanel_I2S_DMA *dma_display = nullptr;
+FrameBuffer *frameBuffer = nullptr;
 
 Clockface *clockface;
 
@@ -66,6 +73,11 @@ void displaySetup(bool swapBlueGreen, uint8_t displayBright, uint8_t displayRota
   dma_display->setBrightness8(displayBright);
   dma_display->clearScreen();
   dma_display->setRotation(displayRotation);
+
+  // Every draw goes through the framebuffer so the screen can be mirrored
+  frameBuffer = new FrameBuffer(dma_display);
+  ClockwiseMirror::getInstance()->begin(frameBuffer);
+  ClockwiseFramePush::getInstance()->begin(frameBuffer);
 }
 
 void automaticBrightControl()
@@ -96,6 +108,25 @@ void automaticBrightControl()
   }
 }
 
+void onBrightnessChanged(ClockwiseParam param)
+{
+  autoBrightEnabled = (ClockwiseParams::getInstance()->autoBrightMax > 0);
+
+  if (autoBrightEnabled) {
+    // Re-evaluated on the next automaticBrightControl() run
+    currentBrightSlot = -1;
+    autoBrightMillis = 0;
+  } else {
+    dma_display->setBrightness8(ClockwiseParams::getInstance()->displayBright);
+  }
+}
+
+// The refresh task picks up the new interval when it wakes up
+void onCanvasRefreshChanged(ClockwiseParam param)
+{
+  ClockwiseCanvasRefresh::getInstance()->request();
+}
+
 void setup()
 {
   Serial.begin(115200);
@@ -104,13 +135,19 @@ void setup()
   StatusController::getInstance()->blink_led(5, 100);
 
   ClockwiseParams::getInstance()->load();
+  ClockwiseMetrics::getInstance()->begin();
+  ClockwiseCanvasStore::getInstance()->begin();
 
   pinMode(ClockwiseParams::getInstance()->ldrPin, INPUT);
 
   displaySetup(ClockwiseParams::getInstance()->swapBlueGreen, ClockwiseParams::getInstance()->displayBright, ClockwiseParams::getInstance()->displayRotation);
-  clockface = new Clockface(dma_display);
+  clockface = new Clockface(frameBuffer);
 
   autoBrightEnabled = (ClockwiseParams::getInstance()->autoBrightMax > 0);
+  ClockwiseParams::getInstance()->onChange(PARAM_DISPLAY_BRIGHT, onBrightnessChanged);
+  ClockwiseParams::getInstance()->onChange(PARAM_DISPLAY_ABC_MIN, onBrightnessChanged);
+  ClockwiseParams::getInstance()->onChange(PARAM_DISPLAY_ABC_MAX, onBrightnessChanged);
+  ClockwiseParams::getInstance()->onChange(PARAM_CANVAS_REFRESH, onCanvasRefreshChanged);
 
   StatusController::getInstance()->clockwiseLogo();
   delay(1000);
@@ -129,6 +166,8 @@ void setup()
 
 void loop()
 {
+  unsigned long loopStart = micros();
+
   wifi.handleImprovWiFi();
 
   if (wifi.isConnected())
@@ -140,7 +179,12 @@ void loop()
   if (wifi.connectionSucessfulOnce)
   {
     clockface->update();
+    ClockwiseMetrics::getInstance()->recordFrame();
   }
 
+  ClockwiseFramePush::getInstance()->handle();
+  ClockwiseParams::getInstance()->handle();
   automaticBrightControl();
+
+  ClockwiseMetrics::getInstance()->recordLoop(micros() - loopStart);
 }
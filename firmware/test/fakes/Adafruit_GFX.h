@@ -0,0 +1,121 @@
+#pragma once
+
+// Adafruit GFX as far as the engine uses it, for host builds. Every primitive ends in
+// drawPixel like the library's defaults do; text in the default font only moves the cursor.
+
+#include <Arduino.h>
+#include <gfxfont.h>
+
+class Adafruit_GFX : public Print
+{
+protected:
+  int16_t _width, _height;
+  uint8_t rotation = 0;
+  int16_t cursor_x = 0, cursor_y = 0;
+  uint16_t textcolor = 0xFFFF;
+  const GFXfont *gfxFont = nullptr;
+
+public:
+  Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+  {
+    for (int16_t i = 0; i < w; i++)
+      drawPixel(x + i, y, color);
+  }
+
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+  {
+    for (int16_t i = 0; i < h; i++)
+      drawPixel(x, y + i, color);
+  }
+
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+  {
+    for (int16_t i = 0; i < h; i++)
+      drawFastHLine(x, y + i, w, color);
+  }
+
+  virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+  virtual void setRotation(uint8_t r) { rotation = r; }
+  uint8_t getRotation() const { return rotation; }
+
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+  {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+  }
+
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+  {
+    int16_t dx = abs(x1 - x0), dy = -abs(y1 - y0);
+    int16_t sx = (x0 < x1 ? 1 : -1), sy = (y0 < y1 ? 1 : -1);
+    int16_t error = dx + dy;
+
+    while (true) {
+      drawPixel(x0, y0, color);
+      if (x0 == x1 && y0 == y1)
+        break;
+      int16_t e2 = 2 * error;
+      if (e2 >= dy) {
+        error += dy;
+        x0 += sx;
+      }
+      if (e2 <= dx) {
+        error += dx;
+        y0 += sy;
+      }
+    }
+  }
+
+  void drawRGBBitmap(int16_t x, int16_t y, const uint16_t *bitmap, int16_t w, int16_t h)
+  {
+    for (int16_t j = 0; j < h; j++)
+      for (int16_t i = 0; i < w; i++)
+        drawPixel(x + i, y + j, bitmap[j * w + i]);
+  }
+
+  void drawRGBBitmap(int16_t x, int16_t y, const uint16_t *bitmap, const uint8_t *mask, int16_t w, int16_t h)
+  {
+    int16_t stride = (w + 7) / 8;
+    for (int16_t j = 0; j < h; j++)
+      for (int16_t i = 0; i < w; i++)
+        if (mask[j * stride + i / 8] & (0x80 >> (i & 7)))
+          drawPixel(x + i, y + j, bitmap[j * w + i]);
+  }
+
+  void setFont(const GFXfont *font) { gfxFont = font; }
+  void setCursor(int16_t x, int16_t y)
+  {
+    cursor_x = x;
+    cursor_y = y;
+  }
+  void setTextColor(uint16_t color) { textcolor = color; }
+
+  size_t write(uint8_t c) override
+  {
+    if (c == '\n') {
+      cursor_x = 0;
+      cursor_y += 8;
+    } else {
+      cursor_x += 6;
+    }
+    return 1;
+  }
+
+  // The default font only, 6x8 per character
+  void getTextBounds(const char *text, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h)
+  {
+    *x1 = x;
+    *y1 = y;
+    *w = strlen(text) * 6;
+    *h = (*w > 0 ? 8 : 0);
+  }
+
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+// Just enough of the Arduino core to build cw-commons headers in the native tests
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define F(text) text
+#define PROGMEM
+
+typedef bool boolean;
+
+using std::min;
+using std::max;
+
+class String
+{
+private:
+  std::string _value;
+
+public:
+  String(const char *value = "") : _value(value ? value : "") {}
+  String(const std::string &value) : _value(value) {}
+  explicit String(int value) : _value(std::to_string(value)) {}
+  explicit String(unsigned int value) : _value(std::to_string(value)) {}
+  explicit String(long value) : _value(std::to_string(value)) {}
+  explicit String(unsigned long value) : _value(std::to_string(value)) {}
+
+  const char *c_str() const { return _value.c_str(); }
+  unsigned int length() const { return _value.length(); }
+  bool isEmpty() const { return _value.empty(); }
+  char charAt(unsigned int index) const { return index < _value.length() ? _value[index] : 0; }
+  long toInt() const { return atol(_value.c_str()); }
+  bool reserve(unsigned int size) { _value.reserve(size); return true; }
+
+  bool startsWith(const char *prefix) const { return _value.compare(0, strlen(prefix), prefix) == 0; }
+  void toLowerCase() { for (char &c : _value) c = tolower(c); }
+
+  void trim()
+  {
+    size_t start = _value.find_first_not_of(" \t\r\n");
+    size_t end = _value.find_last_not_of(" \t\r\n");
+    _value = (start == std::string::npos ? "" : _value.substr(start, end - start + 1));
+  }
+
+  int indexOf(char c, unsigned int from = 0) const
+  {
+    size_t pos = _value.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+
+  String substring(unsigned int from) const { return from < _value.length() ? String(_value.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const { return from < to && from < _value.length() ? String(_value.substr(from, to - from)) : String(); }
+
+  String &operator+=(char c) { _value += c; return *this; }
+  String &operator+=(const String &other) { _value += other._value; return *this; }
+  String operator+(const String &other) const { return String(_value + other._value); }
+  bool operator==(const String &other) const { return _value == other._value; }
+  bool operator!=(const String &other) const { return _value != other._value; }
+  bool operator==(const char *other) const { return _value == other; }
+  bool operator!=(const char *other) const { return _value != other; }
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+      write(buffer[i]);
+    return size;
+  }
+
+  size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t print(const String &text) { return print(text.c_str()); }
+  size_t print(int value) { return printf("%d", value); }
+  size_t println(const char *text = "") { return print(text) + print("\r\n"); }
+  size_t println(const String &text) { return println(text.c_str()); }
+  size_t println(int value) { return print(value) + print("\r\n"); }
+
+  size_t printf(const char *format, ...)
+  {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return write((const uint8_t *)buffer, length < (int)sizeof(buffer) ? length : sizeof(buffer) - 1);
+  }
+};
+
+class Stream : public Print
+{
+protected:
+  unsigned long _timeout = 1000;
+
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+  // No blocking here: the fakes hand over everything they have right away
+  virtual size_t readBytes(char *buffer, size_t length)
+  {
+    size_t count = 0;
+    int c;
+    while (count < length && (c = read()) >= 0)
+      buffer[count++] = c;
+    return count;
+  }
+
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+  String readStringUntil(char terminator)
+  {
+    String text;
+    int c;
+    while ((c = read()) >= 0 && c != terminator)
+      text += (char)c;
+    return text;
+  }
+};
+
+class FakeSerial : public Print
+{
+public:
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+static FakeSerial Serial;
+
+// Tests can move time forward by changing fakeMillisOffset
+static unsigned long fakeMillisOffset = 0;
+
+inline void delay(unsigned long ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline unsigned long millis()
+{
+  static auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() + fakeMillisOffset;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// In-memory stand-in for the ESP32 Preferences (NVS) library.
+// Namespaces are shared by every instance, so values survive a new ClockwiseParams.
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> FakeNamespace;
+
+inline std::map<std::string, FakeNamespace> &fakeNvs()
+{
+  static std::map<std::string, FakeNamespace> storage;
+  return storage;
+}
+
+class Preferences
+{
+private:
+  FakeNamespace *_keys = nullptr;
+
+  size_t put(const char *key, const void *value, size_t length)
+  {
+    const uint8_t *bytes = (const uint8_t *)value;
+    (*_keys)[key] = std::vector<uint8_t>(bytes, bytes + length);
+    return length;
+  }
+
+  const std::vector<uint8_t> *get(const char *key)
+  {
+    FakeNamespace::iterator entry = _keys->find(key);
+    return entry == _keys->end() ? nullptr : &entry->second;
+  }
+
+public:
+  bool begin(const char *name, bool readOnly = false)
+  {
+    _keys = &fakeNvs()[name];
+    return true;
+  }
+
+  void end() { _keys = nullptr; }
+  bool clear() { _keys->clear(); return true; }
+  bool remove(const char *key) { return _keys->erase(key) > 0; }
+  bool isKey(const char *key) { return get(key) != nullptr; }
+
+  size_t putBool(const char *key, bool value) { uint8_t v = value; return put(key, &v, 1); }
+  size_t putUInt(const char *key, uint32_t value) { return put(key, &value, sizeof(value)); }
+  size_t putString(const char *key, const String &value) { return put(key, value.c_str(), value.length()); }
+  size_t putBytes(const char *key, const void *value, size_t length) { return put(key, value, length); }
+
+  bool getBool(const char *key, bool defaultValue = false)
+  {
+    const std::vector<uint8_t> *value = get(key);
+    return value ? (*value)[0] != 0 : defaultValue;
+  }
+
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0)
+  {
+    const std::vector<uint8_t> *value = get(key);
+    uint32_t result = defaultValue;
+    if (value)
+      memcpy(&result, value->data(), sizeof(result));
+    return result;
+  }
+
+  String getString(const char *key, const String &defaultValue = String())
+  {
+    const std::vector<uint8_t> *value = get(key);
+    return value ? String(std::string(value->begin(), value->end())) : defaultValue;
+  }
+
+  size_t getBytesLength(const char *key)
+  {
+    const std::vector<uint8_t> *value = get(key);
+    return value ? value->size() : 0;
+  }
+
+  size_t getBytes(const char *key, void *buffer, size_t length)
+  {
+    const std::vector<uint8_t> *value = get(key);
+    if (!value || value->size() > length)
+      return 0;
+
+    memcpy(buffer, value->data(), value->size());
+    return value->size();
+  }
+};
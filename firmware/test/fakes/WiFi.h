@@ -0,0 +1,180 @@
+#pragma once
+
+// In-process stand-in for a canvas server, so the HTTP client can be tested natively.
+// Every Client connects to the same FakeHttpServer, which answers GETs for its resources
+// honouring keep-alive, conditional requests and (optionally) chunked encoding, and counts
+// connections and lookups.
+
+#include "Arduino.h"
+#include <map>
+
+typedef enum { WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+struct IPAddress
+{
+  uint8_t bytes[4] = {0, 0, 0, 0};
+
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+  bool operator==(const IPAddress &other) const { return memcmp(bytes, other.bytes, 4) == 0; }
+};
+
+struct FakeResource
+{
+  std::string body;
+  std::string etag;
+  std::string lastModified;
+};
+
+struct FakeHttpServer
+{
+  std::map<std::string, FakeResource> resources;
+  bool keepAlive = true;
+  bool chunked = false;
+
+  uint32_t connections = 0;
+  uint32_t lookups = 0;
+  uint32_t requests = 0;
+  std::string lastRequest;
+
+  void reset()
+  {
+    *this = FakeHttpServer();
+  }
+
+  static std::string header(const std::string &request, const char *name)
+  {
+    size_t start = request.find(std::string("\r\n") + name + ": ");
+    if (start == std::string::npos)
+      return "";
+
+    start += strlen(name) + 4;
+    return request.substr(start, request.find("\r\n", start) - start);
+  }
+
+  std::string respond(const std::string &request, bool &close)
+  {
+    requests++;
+    lastRequest = request;
+    close = !keepAlive || header(request, "Connection") == "close";
+
+    std::string path = request.substr(4, request.find(' ', 4) - 4);
+    std::string connection = (close ? "close" : "keep-alive");
+    auto found = resources.find(path);
+
+    if (found == resources.end())
+      return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: " + connection + "\r\n\r\n";
+
+    const FakeResource &resource = found->second;
+    std::string validators;
+    if (!resource.etag.empty())
+      validators += "ETag: " + resource.etag + "\r\n";
+    if (!resource.lastModified.empty())
+      validators += "Last-Modified: " + resource.lastModified + "\r\n";
+
+    std::string etag = header(request, "If-None-Match");
+    std::string since = header(request, "If-Modified-Since");
+    if ((!etag.empty() && etag == resource.etag) || (etag.empty() && !since.empty() && since == resource.lastModified))
+      return "HTTP/1.1 304 Not Modified\r\n" + validators + "Connection: " + connection + "\r\n\r\n";
+
+    if (chunked)
+    {
+      // Split in two chunks, the first with an extension, and end with a trailer
+      size_t half = resource.body.size() / 2;
+      char sizes[32];
+      snprintf(sizes, sizeof(sizes), "%zx;part=1\r\n", half);
+      std::string body = sizes + resource.body.substr(0, half) + "\r\n";
+      snprintf(sizes, sizeof(sizes), "%zX\r\n", resource.body.size() - half);
+      body += sizes + resource.body.substr(half) + "\r\n0\r\nX-Checksum: 0\r\n\r\n";
+
+      return "HTTP/1.1 200 OK\r\n" + validators + "Transfer-Encoding: chunked\r\nConnection: " + connection + "\r\n\r\n" + body;
+    }
+
+    return "HTTP/1.1 200 OK\r\n" + validators + "Content-Length: " + std::to_string(resource.body.size()) +
+           "\r\nConnection: " + connection + "\r\n\r\n" + resource.body;
+  }
+};
+
+inline FakeHttpServer &fakeHttpServer()
+{
+  static FakeHttpServer server;
+  return server;
+}
+
+class Client : public Stream
+{
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int read(uint8_t *buffer, size_t size) = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  using Stream::read;
+};
+
+class WiFiClient : public Client
+{
+private:
+  bool _open = false;
+  bool _closing = false;
+  std::string _request;
+  std::string _response;
+  size_t _position = 0;
+
+public:
+  int connect(IPAddress, uint16_t) override
+  {
+    _open = true;
+    _closing = false;
+    _request.clear();
+    _response.clear();
+    _position = 0;
+    fakeHttpServer().connections++;
+    return 1;
+  }
+
+  size_t write(uint8_t c) override
+  {
+    if (!_open || _closing)
+      return 0;
+
+    _request += (char)c;
+    if (_request.size() >= 4 && _request.compare(_request.size() - 4, 4, "\r\n\r\n") == 0)
+    {
+      _response = _response.substr(_position) + fakeHttpServer().respond(_request, _closing);
+      _position = 0;
+      _request.clear();
+    }
+    return 1;
+  }
+
+  int available() override { return _response.size() - _position; }
+  int read() override { return _position < _response.size() ? (uint8_t)_response[_position++] : -1; }
+  int peek() override { return _position < _response.size() ? (uint8_t)_response[_position] : -1; }
+
+  int read(uint8_t *buffer, size_t size) override
+  {
+    size_t count = std::min(size, _response.size() - _position);
+    memcpy(buffer, _response.data() + _position, count);
+    _position += count;
+    return count;
+  }
+
+  void stop() override { _open = false; }
+
+  // A server side close is seen once everything it sent was read
+  uint8_t connected() override { return _open && (!_closing || available() > 0); }
+};
+
+struct WiFiClass
+{
+  wl_status_t status() { return WL_CONNECTED; }
+
+  int hostByName(const char *, IPAddress &ip)
+  {
+    fakeHttpServer().lookups++;
+    ip = IPAddress(127, 0, 0, 1);
+    return 1;
+  }
+};
+
+static WiFiClass WiFi;
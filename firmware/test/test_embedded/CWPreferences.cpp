@@ -24,9 +24,31 @@ void test_function_should_get_default_values(void) {
   TEST_ASSERT_EQUAL(true, ClockwiseParams::getInstance()->use24hFormat);
 }
 
+void test_function_should_only_mark_changed_values_dirty(void) {
+  ClockwiseParams::getInstance()->load();
+  uint8_t bright = ClockwiseParams::getInstance()->displayBright;
+
+  ClockwiseParams::getInstance()->set(PARAM_DISPLAY_BRIGHT, bright);
+  TEST_ASSERT_FALSE(ClockwiseParams::getInstance()->isDirty(PARAM_DISPLAY_BRIGHT));
+
+  ClockwiseParams::getInstance()->set(PARAM_DISPLAY_BRIGHT, bright + 1);
+  TEST_ASSERT_TRUE(ClockwiseParams::getInstance()->isDirty(PARAM_DISPLAY_BRIGHT));
+  TEST_ASSERT_FALSE(ClockwiseParams::getInstance()->isDirty(PARAM_TIME_ZONE));
+
+  ClockwiseParams::getInstance()->save();
+  TEST_ASSERT_FALSE(ClockwiseParams::getInstance()->isDirty(PARAM_DISPLAY_BRIGHT));
+
+  ClockwiseParams::getInstance()->reload();
+  TEST_ASSERT_EQUAL(bright + 1, ClockwiseParams::getInstance()->displayBright);
+
+  ClockwiseParams::getInstance()->set(PARAM_DISPLAY_BRIGHT, bright);
+  ClockwiseParams::getInstance()->save();
+}
+
 int runUnityTests(void) {
   UNITY_BEGIN();
   RUN_TEST(test_function_should_get_default_values);
+  RUN_TEST(test_function_should_only_mark_changed_values_dirty);
   return UNITY_END();
 }
 
@@ -0,0 +1,89 @@
+#include "unity.h"
+#include "EventBus.h"
+
+class Counter : public EventTask {
+  public:
+    EventBus* bus = nullptr;
+    bool leave = false;
+    int count = 0;
+
+    void execute(EventType event, Sprite* caller) override {
+      count++;
+      if (leave)
+        bus->unsubscribe(this);
+    }
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_subscribers_should_get_their_topic_only(void) {
+  EventBus bus;
+  Counter moves, collisions;
+
+  bus.subscribe(&moves, MOVE);
+  bus.subscribe(&collisions, COLLISION);
+  bus.broadcast(COLLISION, nullptr);
+
+  TEST_ASSERT_EQUAL(0, moves.count);
+  TEST_ASSERT_EQUAL(1, collisions.count);
+}
+
+void test_unsubscribing_from_a_handler_should_keep_delivering_to_the_others(void) {
+  EventBus bus;
+  Counter first, leaving, last;
+
+  leaving.bus = &bus;
+  leaving.leave = true;
+  bus.subscribe(&first, COLLISION);
+  bus.subscribe(&leaving, COLLISION);
+  bus.subscribe(&last, COLLISION);
+
+  bus.broadcast(COLLISION, nullptr);
+  TEST_ASSERT_EQUAL(1, first.count);
+  TEST_ASSERT_EQUAL(1, leaving.count);
+  TEST_ASSERT_EQUAL(1, last.count);
+
+  bus.broadcast(COLLISION, nullptr);
+  TEST_ASSERT_EQUAL(2, first.count);
+  TEST_ASSERT_EQUAL(1, leaving.count);
+  TEST_ASSERT_EQUAL(2, last.count);
+}
+
+void test_slots_unsubscribed_from_a_handler_should_be_reused(void) {
+  EventBus bus;
+  Counter leaving[EVENTBUS_SUBSCRIPTIONS];
+  Counter late;
+
+  for (uint8_t i = 0; i < EVENTBUS_SUBSCRIPTIONS; i++) {
+    leaving[i].bus = &bus;
+    leaving[i].leave = true;
+    bus.subscribe(&leaving[i], MOVE);
+  }
+
+  bus.post(MOVE, nullptr);
+  bus.dispatch();
+  bus.subscribe(&late, MOVE);
+  bus.broadcast(MOVE, nullptr);
+
+  for (uint8_t i = 0; i < EVENTBUS_SUBSCRIPTIONS; i++) {
+    TEST_ASSERT_EQUAL(1, leaving[i].count);
+  }
+  TEST_ASSERT_EQUAL(1, late.count);
+}
+
+int runUnityTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_subscribers_should_get_their_topic_only);
+  RUN_TEST(test_unsubscribing_from_a_handler_should_keep_delivering_to_the_others);
+  RUN_TEST(test_slots_unsubscribed_from_a_handler_should_be_reused);
+  return UNITY_END();
+}
+
+
+int main() {
+  return runUnityTests();
+}
@@ -0,0 +1,204 @@
+#include "unity.h"
+#include "FontRegistry.h"
+#include <vector>
+
+// Reads from bytes in memory
+class BytesStream : public Stream {
+  private:
+    std::vector<uint8_t> _bytes;
+    size_t _position = 0;
+
+  public:
+    void append(const std::vector<uint8_t>& bytes) { _bytes.insert(_bytes.end(), bytes.begin(), bytes.end()); }
+    size_t position() const { return _position; }
+
+    int available() override { return _bytes.size() - _position; }
+    int read() override { return _position < _bytes.size() ? _bytes[_position++] : -1; }
+    int peek() override { return _position < _bytes.size() ? _bytes[_position] : -1; }
+    size_t write(uint8_t c) override { return 0; }
+};
+
+// Glyphs of one pixel each, all sharing the first byte of the bitmap
+std::vector<uint8_t> fontPack(uint16_t first, uint16_t last, uint32_t bitmapSize, uint32_t magic = CW_FONT_PACK_MAGIC) {
+  FontPackHeader header = {magic, first, last, 8, 0, bitmapSize};
+  std::vector<uint8_t> pack((uint8_t*)&header, (uint8_t*)&header + sizeof(header));
+
+  for (uint16_t code = first; code <= last; code++) {
+    FontPackGlyph glyph = {0, 1, 1, 2, 0, -1};
+    pack.insert(pack.end(), (uint8_t*)&glyph, (uint8_t*)&glyph + sizeof(glyph));
+  }
+  pack.resize(pack.size() + bitmapSize, 0x80);
+  return pack;
+}
+
+size_t packMemory(uint16_t first, uint16_t last, uint32_t bitmapSize) {
+  return sizeof(GFXfont) + (last - first + 1) * sizeof(GFXglyph) + bitmapSize;
+}
+
+int loaderCalls = 0;
+
+bool countingLoader(const char* name) {
+  loaderCalls++;
+  return false;
+}
+
+void setUp(void) {
+  loaderCalls = 0;
+}
+
+void tearDown(void) {
+}
+
+// font0, font39 and font62 start probing from the same slot
+void test_names_sharing_a_slot_should_get_ids_of_their_own(void) {
+  FontRegistry fonts;
+
+  uint8_t first = fonts.intern("font0");
+  uint8_t second = fonts.intern("font39");
+  uint8_t third = fonts.intern("font62");
+
+  TEST_ASSERT_TRUE(first != FontRegistry::DEFAULT_FONT);
+  TEST_ASSERT_TRUE(first != second && second != third && first != third);
+  TEST_ASSERT_EQUAL(second, fonts.intern("font39"));
+  TEST_ASSERT_EQUAL(third, fonts.intern("font62"));
+  TEST_ASSERT_EQUAL(first, fonts.intern("font0"));
+  TEST_ASSERT_EQUAL_STRING("font39", fonts.name(second));
+
+  TEST_ASSERT_EQUAL(FontRegistry::DEFAULT_FONT, fonts.intern(nullptr));
+  TEST_ASSERT_EQUAL(FontRegistry::DEFAULT_FONT, fonts.intern(""));
+  // Names are compared on CW_FONT_NAME_MAX characters
+  TEST_ASSERT_EQUAL(fonts.intern("a-very-long-font-name"), fonts.intern("a-very-long-fon"));
+}
+
+void test_a_full_registry_should_keep_its_names_and_refuse_new_ones(void) {
+  FontRegistry fonts;
+  uint8_t ids[31];
+  char name[16];
+
+  for (uint8_t i = 0; i < 31; i++) {
+    snprintf(name, sizeof(name), "font%u", i);
+    ids[i] = fonts.intern(name);
+    TEST_ASSERT_EQUAL(i + 1, ids[i]);
+  }
+
+  TEST_ASSERT_EQUAL(FontRegistry::DEFAULT_FONT, fonts.intern("one-too-many"));
+  for (uint8_t i = 0; i < 31; i++) {
+    snprintf(name, sizeof(name), "font%u", i);
+    TEST_ASSERT_EQUAL(ids[i], fonts.intern(name));
+  }
+
+  BytesStream stream;
+  String error;
+  stream.append(fontPack('0', '9', 16));
+  stream.append({0x42});
+  TEST_ASSERT_FALSE(fonts.load("one-too-many", stream, fontPack('0', '9', 16).size(), error));
+  TEST_ASSERT_EQUAL_STRING("Too many fonts", error.c_str());
+  TEST_ASSERT_EQUAL(0x42, stream.read());
+}
+
+void test_rejected_packs_should_consume_exactly_their_size(void) {
+  FontRegistry fonts;
+  BytesStream stream;
+  String error;
+
+  std::vector<uint8_t> badMagic = fontPack('0', '9', 16, 0x12345678);
+  std::vector<uint8_t> tooShort = {1, 2, 3};
+  std::vector<uint8_t> badOffset = fontPack('0', '9', 16);
+  std::vector<uint8_t> truncated = fontPack('0', '9', 16);
+  std::vector<uint8_t> reversed = fontPack('9', '0', 0);
+
+  // The glyph of '9' points past the bitmap
+  badOffset[sizeof(FontPackHeader) + 9 * sizeof(FontPackGlyph)] = 16;
+  // Says 16 bytes of bitmap, holds 8
+  truncated.resize(truncated.size() - 8);
+
+  const std::vector<uint8_t>* rejected[] = {&badMagic, &tooShort, &badOffset, &truncated, &reversed};
+  for (const std::vector<uint8_t>* pack : rejected) {
+    stream.append(*pack);
+    stream.append({0x42});
+  }
+
+  for (const std::vector<uint8_t>* pack : rejected) {
+    size_t start = stream.position();
+    error = "";
+    TEST_ASSERT_FALSE(fonts.load("rejected", stream, pack->size(), error));
+    TEST_ASSERT_FALSE(error.isEmpty());
+    TEST_ASSERT_EQUAL(pack->size(), stream.position() - start);
+    TEST_ASSERT_EQUAL(0x42, stream.read());
+  }
+  TEST_ASSERT_NULL(fonts.get(fonts.intern("rejected")));
+}
+
+void test_packs_should_be_loaded_within_the_budget(void) {
+  FontRegistry fonts;
+  BytesStream stream;
+  String error;
+  uint32_t bitmapSize = 4000;
+  size_t fitting = CW_FONT_PACK_BUDGET / packMemory(' ', '~', bitmapSize);
+  std::vector<uint8_t> pack = fontPack(' ', '~', bitmapSize);
+  char name[16];
+
+  for (size_t i = 0; i <= fitting; i++) {
+    stream.append(pack);
+    stream.append({0x42});
+  }
+
+  for (size_t i = 0; i < fitting; i++) {
+    snprintf(name, sizeof(name), "big%u", (unsigned)i);
+    TEST_ASSERT_TRUE(fonts.load(name, stream, pack.size(), error));
+    TEST_ASSERT_NOT_NULL(fonts.get(fonts.intern(name)));
+    TEST_ASSERT_EQUAL(0x42, stream.read());
+  }
+
+  TEST_ASSERT_FALSE(fonts.load("over", stream, pack.size(), error));
+  TEST_ASSERT_EQUAL_STRING("Font packs exceed the memory budget", error.c_str());
+  TEST_ASSERT_NULL(fonts.get(fonts.intern("over")));
+  TEST_ASSERT_EQUAL(0x42, stream.read());
+
+  // The refused pack took nothing from what is left
+  std::vector<uint8_t> small = fontPack('0', '9', CW_FONT_PACK_BUDGET - fitting * packMemory(' ', '~', bitmapSize) - packMemory('0', '9', 0));
+  stream.append(small);
+  TEST_ASSERT_TRUE(fonts.load("small", stream, small.size(), error));
+  TEST_ASSERT_TRUE(fonts.isPack(fonts.intern("small")));
+
+  // A name that has a font keeps it and the pack is skipped
+  const GFXfont* loaded = fonts.get(fonts.intern("big0"));
+  stream.append(pack);
+  stream.append({0x42});
+  TEST_ASSERT_TRUE(fonts.load("big0", stream, pack.size(), error));
+  TEST_ASSERT_TRUE(loaded == fonts.get(fonts.intern("big0")));
+  TEST_ASSERT_EQUAL(0x42, stream.read());
+}
+
+void test_the_loader_should_be_asked_once_per_missing_font(void) {
+  FontRegistry fonts;
+  GFXfont builtIn = {};
+
+  fonts.setLoader(countingLoader);
+  fonts.add("builtin", &builtIn);
+  uint8_t missing = fonts.intern("missing");
+
+  fonts.require(FontRegistry::DEFAULT_FONT);
+  fonts.require(fonts.intern("builtin"));
+  TEST_ASSERT_EQUAL(0, loaderCalls);
+
+  fonts.require(missing);
+  fonts.require(missing);
+  TEST_ASSERT_EQUAL(1, loaderCalls);
+  TEST_ASSERT_NULL(fonts.get(missing));
+}
+
+int runUnityTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_names_sharing_a_slot_should_get_ids_of_their_own);
+  RUN_TEST(test_a_full_registry_should_keep_its_names_and_refuse_new_ones);
+  RUN_TEST(test_rejected_packs_should_consume_exactly_their_size);
+  RUN_TEST(test_packs_should_be_loaded_within_the_budget);
+  RUN_TEST(test_the_loader_should_be_asked_once_per_missing_font);
+  return UNITY_END();
+}
+
+
+int main() {
+  return runUnityTests();
+}
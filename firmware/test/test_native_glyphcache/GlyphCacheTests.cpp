@@ -0,0 +1,154 @@
+#include "unity.h"
+#include "GlyphCache.h"
+#include "picopixel.h"
+
+// A 64x64 panel keeping its pixels, and the leftmost column drawn since the last reset
+class Panel : public Adafruit_GFX {
+  public:
+    uint16_t pixels[64 * 64] = {};
+    int16_t leftmost = INT16_MAX;
+    int drawn = 0;
+
+    Panel() : Adafruit_GFX(64, 64) {}
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+      if (x < 0 || y < 0 || x >= 64 || y >= 64)
+        return;
+      pixels[y * 64 + x] = color;
+      leftmost = min(leftmost, x);
+      drawn++;
+    }
+
+    void resetDrawn() {
+      leftmost = INT16_MAX;
+      drawn = 0;
+    }
+
+    bool same(const Panel& other) const {
+      return memcmp(pixels, other.pixels, sizeof(pixels)) == 0;
+    }
+
+    // Adafruit_GFX::drawChar for GFX fonts, bit by bit
+    void drawChar(const GFXfont* font, int16_t x, int16_t y, char c, uint16_t color) {
+      const GFXglyph* glyph = &font->glyph[(uint8_t)c - font->first];
+      const uint8_t* bitmap = font->bitmap;
+      uint16_t offset = glyph->bitmapOffset;
+      uint8_t bits = 0, bit = 0;
+
+      for (uint8_t yy = 0; yy < glyph->height; yy++) {
+        for (uint8_t xx = 0; xx < glyph->width; xx++) {
+          if (!(bit++ & 7))
+            bits = bitmap[offset++];
+          if (bits & 0x80)
+            drawPixel(x + glyph->xOffset + xx, y + glyph->yOffset + yy, color);
+          bits <<= 1;
+        }
+      }
+    }
+
+    void printChars(const GFXfont* font, const char* text, int16_t x, int16_t y, uint16_t color) {
+      int16_t cursorX = x;
+      for (const char* c = text; *c; c++) {
+        if (*c == '\n') {
+          cursorX = x;
+          y += font->yAdvance;
+        } else if ((uint8_t)*c >= font->first && (uint8_t)*c <= font->last) {
+          drawChar(font, cursorX, y, *c, color);
+          cursorX += font->glyph[(uint8_t)*c - font->first].xAdvance;
+        }
+      }
+    }
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_spans_should_match_adafruit_draw_char(void) {
+  char all[0x7F - 0x20 + 1];
+  for (uint8_t c = 0x20; c < 0x7F; c++)
+    all[c - 0x20] = c;
+  all[0x7F - 0x20] = 0;
+
+  // Cached, over the budget from the start, and over it halfway through
+  const size_t budgets[] = {4096, 0, 256};
+  for (size_t budget : budgets) {
+    GlyphCache glyphs(budget);
+
+    for (int16_t offset = 0; offset < 4; offset++) {
+      Panel expected, drawn;
+      int16_t x = offset * 3 - 2;
+
+      for (size_t line = 0; line * 12 < strlen(all); line++) {
+        String text = String(all).substring(line * 12, line * 12 + 12);
+        expected.printChars(&Picopixel, text.c_str(), x, 6 + line * 7, 0xF800 + line);
+        glyphs.print(&drawn, &Picopixel, text.c_str(), x, 6 + line * 7, 0xF800 + line);
+      }
+      expected.printChars(&Picopixel, "ab\ncd", 40, 58, 0x07E0);
+      glyphs.print(&drawn, &Picopixel, "ab\ncd", 40, 58, 0x07E0);
+
+      TEST_ASSERT_TRUE(expected.drawn > 0);
+      TEST_ASSERT_TRUE(expected.same(drawn));
+    }
+  }
+}
+
+// Both strings have the same FNV-1a hash
+void test_strings_sharing_a_hash_should_not_share_bounds(void) {
+  GlyphCache glyphs, fresh;
+  Panel panel;
+  int16_t x1, y1, freshX1, freshY1;
+  uint16_t w, h, freshW, freshH, firstW;
+
+  glyphs.getTextBounds(&panel, &Picopixel, "PAM:2:2", 0, 10, &x1, &y1, &firstW, &h);
+  glyphs.getTextBounds(&panel, &Picopixel, "14173", 0, 10, &x1, &y1, &w, &h);
+  fresh.getTextBounds(&panel, &Picopixel, "14173", 0, 10, &freshX1, &freshY1, &freshW, &freshH);
+
+  TEST_ASSERT_TRUE(firstW != freshW);
+  TEST_ASSERT_EQUAL(freshX1, x1);
+  TEST_ASSERT_EQUAL(freshY1, y1);
+  TEST_ASSERT_EQUAL(freshW, w);
+  TEST_ASSERT_EQUAL(freshH, h);
+}
+
+void test_reprint_should_only_draw_the_changed_glyphs(void) {
+  GlyphCache glyphs;
+  Panel panel, expected;
+  int16_t x1, y1;
+  uint16_t w, h;
+
+  glyphs.print(&panel, &Picopixel, "12:34", 5, 20, 0xFFFF);
+  panel.resetDrawn();
+
+  glyphs.reprint(&panel, &Picopixel, "12:34", "12:34", 5, 20, 0xFFFF, 0);
+  TEST_ASSERT_EQUAL(0, panel.drawn);
+
+  glyphs.reprint(&panel, &Picopixel, "12:34", "12:35", 5, 20, 0xFFFF, 0);
+  glyphs.getTextBounds(&panel, &Picopixel, "12:3", 5, 20, &x1, &y1, &w, &h);
+  TEST_ASSERT_TRUE(panel.drawn > 0);
+  TEST_ASSERT_TRUE(panel.leftmost > x1 + w - 1);
+
+  expected.printChars(&Picopixel, "12:35", 5, 20, 0xFFFF);
+  TEST_ASSERT_TRUE(expected.same(panel));
+
+  // A shorter text clears what the longer one left
+  glyphs.reprint(&panel, &Picopixel, "12:35", "9:5", 5, 20, 0xFFFF, 0);
+  Panel shorter;
+  shorter.printChars(&Picopixel, "9:5", 5, 20, 0xFFFF);
+  TEST_ASSERT_TRUE(shorter.same(panel));
+}
+
+int runUnityTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_spans_should_match_adafruit_draw_char);
+  RUN_TEST(test_strings_sharing_a_hash_should_not_share_bounds);
+  RUN_TEST(test_reprint_should_only_draw_the_changed_glyphs);
+  return UNITY_END();
+}
+
+
+int main() {
+  return runUnityTests();
+}
@@ -0,0 +1,212 @@
+#include "unity.h"
+#include "Arduino.h"
+#include "CWHttpClient.h"
+
+#define HOST "canvas.local"
+#define PORT 4443
+
+ClockwiseHttpClient *http;
+
+String readBody()
+{
+  String body;
+  int c;
+  while ((c = http->body.read()) >= 0)
+    body += (char)c;
+  return body;
+}
+
+void setUp(void) {
+  fakeHttpServer().reset();
+  fakeHttpServer().resources["/pac-man.json"] = {"{\"name\":\"Pac-Man\"}", "\"v1\"", "Sat, 01 Jun 2024 10:00:00 GMT"};
+  fakeHttpServer().resources["/mario.json"] = {"{\"name\":\"Mario\"}", "", ""};
+
+  static ClockwiseHttpClient client;
+  client = ClockwiseHttpClient();
+  http = &client;
+}
+
+void tearDown(void) {
+  http->close();
+}
+
+void test_function_should_read_body_and_validators(void) {
+  HttpResponse response = http->get(HOST, "/pac-man.json", PORT);
+
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_EQUAL(18, response.contentLength);
+  TEST_ASSERT_EQUAL_STRING("\"v1\"", response.etag.c_str());
+  TEST_ASSERT_EQUAL_STRING("Sat, 01 Jun 2024 10:00:00 GMT", response.lastModified.c_str());
+  TEST_ASSERT_EQUAL_STRING("{\"name\":\"Pac-Man\"}", readBody().c_str());
+}
+
+void test_function_should_reuse_connection_and_dns(void) {
+  http->get(HOST, "/pac-man.json", PORT);
+  readBody();
+  http->end();
+
+  HttpResponse response = http->get(HOST, "/mario.json", PORT);
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_EQUAL_STRING("{\"name\":\"Mario\"}", readBody().c_str());
+
+  TEST_ASSERT_EQUAL(2, fakeHttpServer().requests);
+  TEST_ASSERT_EQUAL(1, fakeHttpServer().connections);
+  TEST_ASSERT_EQUAL(1, fakeHttpServer().lookups);
+}
+
+void test_function_should_drain_unread_body_to_keep_connection(void) {
+  http->get(HOST, "/pac-man.json", PORT);
+  http->end();
+
+  HttpResponse response = http->get(HOST, "/mario.json", PORT);
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_EQUAL_STRING("{\"name\":\"Mario\"}", readBody().c_str());
+  TEST_ASSERT_EQUAL(1, fakeHttpServer().connections);
+}
+
+void test_function_should_reconnect_when_server_closes(void) {
+  fakeHttpServer().keepAlive = false;
+
+  http->get(HOST, "/pac-man.json", PORT);
+  readBody();
+  http->end();
+
+  HttpResponse response = http->get(HOST, "/mario.json", PORT);
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_EQUAL(2, fakeHttpServer().connections);
+  TEST_ASSERT_EQUAL(1, fakeHttpServer().lookups);
+}
+
+void test_function_should_send_validators_and_accept_304(void) {
+  HttpValidators validators = {"\"v1\"", "Sat, 01 Jun 2024 10:00:00 GMT"};
+  HttpResponse response = http->get(HOST, "/pac-man.json", PORT, &validators);
+
+  TEST_ASSERT_EQUAL(304, response.status);
+  TEST_ASSERT_EQUAL(-1, http->body.read());
+  TEST_ASSERT_TRUE(fakeHttpServer().lastRequest.find("If-None-Match: \"v1\"\r\n") != std::string::npos);
+  TEST_ASSERT_TRUE(fakeHttpServer().lastRequest.find("If-Modified-Since: Sat, 01 Jun 2024 10:00:00 GMT\r\n") != std::string::npos);
+
+  http->end();
+  TEST_ASSERT_EQUAL(200, http->get(HOST, "/mario.json", PORT).status);
+  TEST_ASSERT_EQUAL(1, fakeHttpServer().connections);
+}
+
+void test_function_should_download_again_when_changed(void) {
+  HttpValidators validators = {"\"v0\"", ""};
+  HttpResponse response = http->get(HOST, "/pac-man.json", PORT, &validators);
+
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_EQUAL_STRING("\"v1\"", response.etag.c_str());
+}
+
+struct RecordingHandler : public HttpHeaderHandler
+{
+  int16_t status = 0;
+  std::string headers;
+
+  void onStatus(int16_t code, bool) override { status = code; }
+  void onHeader(const char *name, const char *value) override { headers += std::string(name) + "=" + value + ";"; }
+};
+
+void test_function_should_emit_header_events(void) {
+  RecordingHandler handler;
+  HttpHeaderParser parser;
+  parser.begin(&handler);
+
+  const char *head = "HTTP/1.1 200 OK\r\nContent-Type:  application/json \r\nX-Empty:\r\nbroken line\r\n\r\nbody";
+  const char *c = head;
+  while (!parser.feed(*c))
+    c++;
+
+  TEST_ASSERT_FALSE(parser.failed());
+  TEST_ASSERT_EQUAL(200, handler.status);
+  TEST_ASSERT_EQUAL_STRING("content-type=application/json;x-empty=;", handler.headers.c_str());
+  TEST_ASSERT_EQUAL_STRING("body", c + 1);
+}
+
+void test_function_should_cut_long_header_lines(void) {
+  RecordingHandler handler;
+  HttpHeaderParser parser;
+  parser.begin(&handler);
+
+  std::string head = "HTTP/1.0 404 Not Found\r\nX-Long: " + std::string(1000, 'a') + "\r\n\r\n";
+  bool done = false;
+  for (char c : head)
+    done = parser.feed(c);
+
+  TEST_ASSERT_TRUE(done);
+  TEST_ASSERT_FALSE(parser.failed());
+  TEST_ASSERT_EQUAL(404, handler.status);
+  TEST_ASSERT_EQUAL(strlen("x-long=") + CW_HTTP_LINE_MAX - 1 - strlen("X-Long: ") + 1, handler.headers.size());
+}
+
+void test_function_should_reject_invalid_status_line(void) {
+  RecordingHandler handler;
+  HttpHeaderParser parser;
+  parser.begin(&handler);
+
+  const char *head = "SSH-2.0-OpenSSH\r\n";
+  bool done = false;
+  for (const char *c = head; *c; c++)
+    done = parser.feed(*c);
+
+  TEST_ASSERT_TRUE(done);
+  TEST_ASSERT_TRUE(parser.failed());
+}
+
+void test_function_should_decode_chunked_body(void) {
+  fakeHttpServer().chunked = true;
+
+  HttpResponse response = http->get(HOST, "/pac-man.json", PORT);
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_TRUE(response.chunked);
+  TEST_ASSERT_EQUAL(-1, response.contentLength);
+
+  char buffer[64] = {0};
+  TEST_ASSERT_EQUAL(18, http->body.readBytes(buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_STRING("{\"name\":\"Pac-Man\"}", buffer);
+  TEST_ASSERT_TRUE(http->body.finished());
+
+  // Read byte by byte this time, then the connection is still usable
+  http->end();
+  http->get(HOST, "/mario.json", PORT);
+  TEST_ASSERT_EQUAL_STRING("{\"name\":\"Mario\"}", readBody().c_str());
+  http->end();
+
+  TEST_ASSERT_EQUAL(200, http->get(HOST, "/pac-man.json", PORT).status);
+  TEST_ASSERT_EQUAL(1, fakeHttpServer().connections);
+}
+
+void test_function_should_forward_events_to_listener(void) {
+  RecordingHandler handler;
+  http->get(HOST, "/mario.json", PORT, nullptr, &handler);
+
+  TEST_ASSERT_EQUAL(200, handler.status);
+  TEST_ASSERT_EQUAL_STRING("content-length=16;connection=keep-alive;", handler.headers.c_str());
+}
+
+void test_function_should_report_missing_resource(void) {
+  HttpResponse response = http->get(HOST, "/missing.json", PORT);
+
+  TEST_ASSERT_EQUAL(404, response.status);
+  TEST_ASSERT_EQUAL(-1, http->body.read());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_function_should_read_body_and_validators);
+  RUN_TEST(test_function_should_reuse_connection_and_dns);
+  RUN_TEST(test_function_should_drain_unread_body_to_keep_connection);
+  RUN_TEST(test_function_should_reconnect_when_server_closes);
+  RUN_TEST(test_function_should_send_validators_and_accept_304);
+  RUN_TEST(test_function_should_download_again_when_changed);
+  RUN_TEST(test_function_should_report_missing_resource);
+  RUN_TEST(test_function_should_emit_header_events);
+  RUN_TEST(test_function_should_cut_long_header_lines);
+  RUN_TEST(test_function_should_reject_invalid_status_line);
+  RUN_TEST(test_function_should_decode_chunked_body);
+  RUN_TEST(test_function_should_forward_events_to_listener);
+  UNITY_END();
+
+  return 0;
+}
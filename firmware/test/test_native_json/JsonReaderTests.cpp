@@ -0,0 +1,153 @@
+#include "unity.h"
+#include "CWJsonReader.h"
+
+class StringPrint : public Print
+{
+public:
+  String text;
+  size_t write(uint8_t c) override
+  {
+    text += (char)c;
+    return 1;
+  }
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_function_should_walk_members_and_elements(void) {
+  MemoryStream input("{ \"name\": \"Pac\", \"delay\": 250, \"setup\": [1, -2, 3.9], \"loop\": [] }");
+  JsonStreamReader json(input);
+  char key[16];
+  char name[16];
+  long value;
+  long sum = 0;
+
+  TEST_ASSERT_TRUE(json.beginObject());
+
+  TEST_ASSERT_TRUE(json.nextMember(key, sizeof(key)));
+  TEST_ASSERT_EQUAL_STRING("name", key);
+  TEST_ASSERT_TRUE(json.readString(name, sizeof(name)));
+  TEST_ASSERT_EQUAL_STRING("Pac", name);
+
+  TEST_ASSERT_TRUE(json.nextMember(key, sizeof(key)));
+  TEST_ASSERT_TRUE(json.readInteger(value));
+  TEST_ASSERT_EQUAL(250, value);
+
+  TEST_ASSERT_TRUE(json.nextMember(key, sizeof(key)));
+  TEST_ASSERT_EQUAL_STRING("setup", key);
+  TEST_ASSERT_TRUE(json.beginArray());
+  while (json.nextElement()) {
+    json.readInteger(value);
+    sum += value;
+  }
+  TEST_ASSERT_EQUAL(2, sum);
+
+  TEST_ASSERT_TRUE(json.nextMember(key, sizeof(key)));
+  TEST_ASSERT_TRUE(json.beginArray());
+  TEST_ASSERT_FALSE(json.nextElement());
+
+  TEST_ASSERT_FALSE(json.nextMember(key, sizeof(key)));
+  TEST_ASSERT_FALSE(json.failed());
+}
+
+void test_function_should_skip_nested_values(void) {
+  MemoryStream input("{\"sprites\": [[{\"image\": \"a]}\"}], {\"x\": [true, null]}], \"version\": 3}");
+  JsonStreamReader json(input);
+  char key[16];
+  long version = 0;
+
+  json.beginObject();
+  while (json.nextMember(key, sizeof(key))) {
+    if (strcmp(key, "version") == 0)
+      json.readInteger(version);
+    else
+      json.skipValue();
+  }
+
+  TEST_ASSERT_FALSE(json.failed());
+  TEST_ASSERT_EQUAL(3, version);
+}
+
+void test_function_should_unescape_strings(void) {
+  MemoryStream input("\"a\\\"b\\\\c\\/d\\n\\u00e9\\u20ac\"");
+  JsonStreamReader json(input);
+  StringPrint out;
+
+  TEST_ASSERT_TRUE(json.readString(&out));
+  TEST_ASSERT_EQUAL_STRING("a\"b\\c/d\n\xC3\xA9\xE2\x82\xAC", out.text.c_str());
+}
+
+void test_function_should_cut_long_strings(void) {
+  MemoryStream input("\"shouldReturnToOrigin\"");
+  JsonStreamReader json(input);
+  char key[7];
+
+  TEST_ASSERT_TRUE(json.readString(key, sizeof(key)));
+  TEST_ASSERT_EQUAL_STRING("should", key);
+}
+
+void test_function_should_read_literals_as_numbers(void) {
+  MemoryStream input("[true, false, null]");
+  JsonStreamReader json(input);
+  bool flag = false;
+  long value = -1;
+
+  json.beginArray();
+  json.nextElement();
+  TEST_ASSERT_TRUE(json.readBool(flag));
+  TEST_ASSERT_TRUE(flag);
+  json.nextElement();
+  TEST_ASSERT_TRUE(json.readBool(flag));
+  TEST_ASSERT_FALSE(flag);
+  json.nextElement();
+  TEST_ASSERT_TRUE(json.readInteger(value));
+  TEST_ASSERT_EQUAL(0, value);
+  TEST_ASSERT_FALSE(json.nextElement());
+}
+
+void test_function_should_fail_on_invalid_input(void) {
+  const char *invalid[] = {
+    "{\"a\": 1 \"b\": 2}",    // missing comma
+    "{\"a\": 1,}",            // trailing comma
+    "[1, 2",                  // truncated
+    "{\"a\": tru}",
+    "{\"a\": \"\\x\"}",
+  };
+
+  for (const char *text : invalid) {
+    MemoryStream input(text);
+    JsonStreamReader json(input);
+
+    TEST_ASSERT_FALSE(json.skipValue());
+    TEST_ASSERT_TRUE(json.failed());
+  }
+}
+
+void test_function_should_stop_after_a_failure(void) {
+  MemoryStream input("{\"a\" 1, \"b\": 2}");
+  JsonStreamReader json(input);
+  char key[4];
+
+  json.beginObject();
+  TEST_ASSERT_FALSE(json.nextMember(key, sizeof(key)));
+  TEST_ASSERT_FALSE(json.nextMember(key, sizeof(key)));
+  TEST_ASSERT_TRUE(json.failed());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_function_should_walk_members_and_elements);
+  RUN_TEST(test_function_should_skip_nested_values);
+  RUN_TEST(test_function_should_unescape_strings);
+  RUN_TEST(test_function_should_cut_long_strings);
+  RUN_TEST(test_function_should_read_literals_as_numbers);
+  RUN_TEST(test_function_should_fail_on_invalid_input);
+  RUN_TEST(test_function_should_stop_after_a_failure);
+  UNITY_END();
+
+  return 0;
+}
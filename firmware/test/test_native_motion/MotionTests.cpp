@@ -0,0 +1,120 @@
+#include "unity.h"
+#include "Motion.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_each_keyframe_should_be_reached_exactly_at_its_duration(void) {
+  const Keyframe path[] = {{10, 20, EASING_LINEAR, 100}, {-5, 3, EASING_OUT, 50}};
+  Motion motion;
+
+  motion.start(0, 0, path, 2, 1000);
+  TEST_ASSERT_TRUE(motion.update(1099));
+  TEST_ASSERT_TRUE(motion.x < TO_FIXED(10));
+
+  TEST_ASSERT_TRUE(motion.update(1100));
+  TEST_ASSERT_EQUAL(TO_FIXED(10), motion.x);
+  TEST_ASSERT_EQUAL(TO_FIXED(20), motion.y);
+
+  TEST_ASSERT_TRUE(motion.update(1149));
+  TEST_ASSERT_TRUE(motion.isMoving());
+
+  TEST_ASSERT_FALSE(motion.update(1150));
+  TEST_ASSERT_FALSE(motion.isMoving());
+  TEST_ASSERT_EQUAL(TO_FIXED(-5), motion.x);
+  TEST_ASSERT_EQUAL(TO_FIXED(3), motion.y);
+  TEST_ASSERT_EQUAL(-5, motion.pixelX());
+  TEST_ASSERT_EQUAL(3, motion.pixelY());
+}
+
+void test_a_late_update_should_end_on_the_last_keyframe(void) {
+  const Keyframe path[] = {{10, 20, EASING_BOUNCE, 100}, {-5, 3, EASING_IN, 50}, {7, -7, EASING_IN_OUT, 10}};
+  Motion motion;
+
+  motion.start(1, 1, path, 3, 0);
+  TEST_ASSERT_FALSE(motion.update(5000));
+  TEST_ASSERT_EQUAL(7, motion.pixelX());
+  TEST_ASSERT_EQUAL(-7, motion.pixelY());
+}
+
+void test_ease_in_and_out_should_be_monotonic(void) {
+  const Easing easings[] = {EASING_LINEAR, EASING_IN, EASING_OUT, EASING_IN_OUT};
+
+  for (Easing easing : easings) {
+    uint16_t previous = 0;
+
+    TEST_ASSERT_EQUAL(0, Motion::ease(easing, 0));
+    for (uint16_t progress = 1; progress <= FIXED_ONE; progress++) {
+      uint16_t eased = Motion::ease(easing, progress);
+      TEST_ASSERT_TRUE(eased >= previous);
+      previous = eased;
+    }
+    TEST_ASSERT_EQUAL(FIXED_ONE, previous);
+  }
+
+  // Slow start, slow end
+  TEST_ASSERT_TRUE(Motion::ease(EASING_IN, 64) < 64);
+  TEST_ASSERT_TRUE(Motion::ease(EASING_OUT, 64) > 64);
+  TEST_ASSERT_TRUE(Motion::ease(EASING_IN_OUT, 64) < 64);
+  TEST_ASSERT_TRUE(Motion::ease(EASING_IN_OUT, 192) > 192);
+}
+
+void test_bounce_should_rebound_without_passing_the_target(void) {
+  uint16_t highest = 0;
+  uint16_t rebound = FIXED_ONE;
+
+  for (uint16_t progress = 0; progress <= FIXED_ONE; progress++) {
+    uint16_t eased = Motion::ease(EASING_BOUNCE, progress);
+    TEST_ASSERT_TRUE(eased <= FIXED_ONE);
+    highest = max(highest, eased);
+    if (highest >= 248)
+      rebound = min(rebound, eased);
+  }
+
+  TEST_ASSERT_TRUE(rebound < 200);
+  TEST_ASSERT_EQUAL(FIXED_ONE, Motion::ease(EASING_BOUNCE, FIXED_ONE));
+}
+
+// A position past the int8_t range would wrap to the other side of the display
+void test_moves_across_the_whole_int8_range_should_not_wrap(void) {
+  const Keyframe path[] = {{127, -128, EASING_BOUNCE, 1000}, {-128, 127, EASING_IN_OUT, 1000}};
+  Motion motion;
+  int8_t previousX = -128;
+  int8_t previousY = 127;
+
+  motion.start(-128, 127, path, 2, 0);
+  for (unsigned long now = 0; now < 2000; now++) {
+    motion.update(now);
+    TEST_ASSERT_TRUE(abs(motion.pixelX() - previousX) <= 16);
+    TEST_ASSERT_TRUE(abs(motion.pixelY() - previousY) <= 16);
+    previousX = motion.pixelX();
+    previousY = motion.pixelY();
+
+    if (now == 1000) {
+      TEST_ASSERT_EQUAL(127, motion.pixelX());
+      TEST_ASSERT_EQUAL(-128, motion.pixelY());
+    }
+  }
+
+  TEST_ASSERT_FALSE(motion.update(2000));
+  TEST_ASSERT_EQUAL(-128, motion.pixelX());
+  TEST_ASSERT_EQUAL(127, motion.pixelY());
+}
+
+int runUnityTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_each_keyframe_should_be_reached_exactly_at_its_duration);
+  RUN_TEST(test_a_late_update_should_end_on_the_last_keyframe);
+  RUN_TEST(test_ease_in_and_out_should_be_monotonic);
+  RUN_TEST(test_bounce_should_rebound_without_passing_the_target);
+  RUN_TEST(test_moves_across_the_whole_int8_range_should_not_wrap);
+  return UNITY_END();
+}
+
+
+int main() {
+  return runUnityTests();
+}
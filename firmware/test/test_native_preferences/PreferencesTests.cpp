@@ -0,0 +1,133 @@
+#define CW_PREF_DB_NAME "clockwise_test"
+
+#include "unity.h"
+#include "Arduino.h"
+#include "CWPreferences.h"
+
+void setUp(void) {
+  fakeNvs().clear();
+}
+
+void tearDown(void) {
+}
+
+void test_function_should_get_default_values(void) {
+  ClockwiseParams params;
+  params.load();
+
+  TEST_ASSERT_EQUAL_STRING("raw.githubusercontent.com", params.canvasServer.c_str());
+  TEST_ASSERT_EQUAL_STRING("America/Sao_Paulo", params.timeZone.c_str());
+  TEST_ASSERT_EQUAL(32, params.displayBright);
+  TEST_ASSERT_EQUAL(true, params.use24hFormat);
+  TEST_ASSERT_EQUAL(0, fakeNvs()[CW_PREF_DB_NAME].size());
+}
+
+void test_function_should_round_trip_through_one_blob(void) {
+  ClockwiseParams params;
+  params.load();
+  params.set(PARAM_DISPLAY_BRIGHT, 100);
+  params.set(PARAM_DISPLAY_ABC_MAX, 4000);
+  params.set(PARAM_SWAP_BLUE_GREEN, true);
+  params.set(PARAM_WIFI_SSID, String("my network"));
+  params.save();
+
+  TEST_ASSERT_EQUAL(1, fakeNvs()[CW_PREF_DB_NAME].size());
+
+  ClockwiseParams reloaded;
+  reloaded.load();
+  TEST_ASSERT_EQUAL(100, reloaded.displayBright);
+  TEST_ASSERT_EQUAL(4000, reloaded.autoBrightMax);
+  TEST_ASSERT_EQUAL(true, reloaded.swapBlueGreen);
+  TEST_ASSERT_EQUAL_STRING("my network", reloaded.wifiSsid.c_str());
+  TEST_ASSERT_EQUAL_STRING("time.google.com", reloaded.ntpServer.c_str());
+}
+
+void test_function_should_migrate_legacy_keys(void) {
+  Preferences legacy;
+  legacy.begin(CW_PREF_DB_NAME);
+  legacy.putUInt("displayBright", 64);
+  legacy.putBool("use24hFormat", false);
+  legacy.putString("canvasFile", "vespa");
+
+  ClockwiseParams params;
+  params.load();
+  TEST_ASSERT_EQUAL(64, params.displayBright);
+  TEST_ASSERT_EQUAL(false, params.use24hFormat);
+  TEST_ASSERT_EQUAL_STRING("vespa", params.canvasFile.c_str());
+  TEST_ASSERT_EQUAL(35, params.ldrPin);
+
+  TEST_ASSERT_FALSE(legacy.isKey("displayBright"));
+  TEST_ASSERT_TRUE(legacy.isKey(CW_PREF_BLOB_KEY));
+
+  ClockwiseParams reloaded;
+  reloaded.load();
+  TEST_ASSERT_EQUAL(64, reloaded.displayBright);
+  TEST_ASSERT_EQUAL_STRING("vespa", reloaded.canvasFile.c_str());
+}
+
+void test_function_should_use_defaults_when_blob_is_corrupted(void) {
+  ClockwiseParams params;
+  params.load();
+  params.set(PARAM_DISPLAY_BRIGHT, 100);
+  params.save();
+
+  fakeNvs()[CW_PREF_DB_NAME][CW_PREF_BLOB_KEY][SETTINGS_BLOB_HEADER_SIZE + 3] ^= 0x01;
+
+  ClockwiseParams reloaded;
+  reloaded.load();
+  TEST_ASSERT_EQUAL(32, reloaded.displayBright);
+}
+
+void test_function_should_reject_unknown_versions_and_truncated_blobs(void) {
+  ClockwiseParams params;
+  params.load();
+  params.set(PARAM_DISPLAY_BRIGHT, 100);
+
+  uint8_t blob[SETTINGS_BLOB_MAX_SIZE];
+  size_t length = params.serialize(blob, sizeof(blob));
+  TEST_ASSERT_TRUE(length > SETTINGS_BLOB_HEADER_SIZE);
+
+  ClockwiseParams other;
+  TEST_ASSERT_TRUE(other.deserialize(blob, length));
+  TEST_ASSERT_EQUAL(100, other.displayBright);
+
+  TEST_ASSERT_FALSE(other.deserialize(blob, length - 1));
+  TEST_ASSERT_EQUAL(32, other.displayBright);
+
+  blob[0] = SETTINGS_BLOB_VERSION + 1;
+  TEST_ASSERT_FALSE(other.deserialize(blob, length));
+  TEST_ASSERT_EQUAL(32, other.displayBright);
+}
+
+void test_function_should_only_write_when_something_changed(void) {
+  ClockwiseParams params;
+  params.load();
+  params.set(PARAM_DISPLAY_BRIGHT, 32);
+  params.save();
+  TEST_ASSERT_EQUAL(0, fakeNvs()[CW_PREF_DB_NAME].size());
+
+  params.set(PARAM_DISPLAY_BRIGHT, 33);
+  params.saveLater(1000);
+  params.handle();
+  TEST_ASSERT_EQUAL(0, fakeNvs()[CW_PREF_DB_NAME].size());
+
+  fakeMillisOffset += 1000;
+  params.handle();
+  TEST_ASSERT_EQUAL(1, fakeNvs()[CW_PREF_DB_NAME].size());
+}
+
+int runUnityTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_function_should_get_default_values);
+  RUN_TEST(test_function_should_round_trip_through_one_blob);
+  RUN_TEST(test_function_should_migrate_legacy_keys);
+  RUN_TEST(test_function_should_use_defaults_when_blob_is_corrupted);
+  RUN_TEST(test_function_should_reject_unknown_versions_and_truncated_blobs);
+  RUN_TEST(test_function_should_only_write_when_something_changed);
+  return UNITY_END();
+}
+
+
+int main() {
+  return runUnityTests();
+}
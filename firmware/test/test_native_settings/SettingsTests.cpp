@@ -0,0 +1,53 @@
+#include "unity.h"
+#include "CWSettings.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_every_key_should_be_found(void) {
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    TEST_ASSERT_EQUAL(i, findSetting(SETTINGS[i].key));
+  }
+}
+
+void test_unknown_keys_should_not_be_found(void) {
+  TEST_ASSERT_EQUAL(PARAM_COUNT, findSetting(""));
+  TEST_ASSERT_EQUAL(PARAM_COUNT, findSetting("autoBright"));
+  TEST_ASSERT_EQUAL(PARAM_COUNT, findSetting("displaybright"));
+  TEST_ASSERT_EQUAL(PARAM_COUNT, findSetting("displayBrightness"));
+}
+
+void test_keys_should_fit_in_nvs(void) {
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    TEST_ASSERT_TRUE(strlen(SETTINGS[i].key) <= 15);
+  }
+}
+
+void test_defaults_should_be_in_range(void) {
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    if (SETTINGS[i].type == SETTING_STRING) {
+      TEST_ASSERT_NOT_NULL(SETTINGS[i].defaultText);
+      TEST_ASSERT_TRUE(strlen(SETTINGS[i].defaultText) <= SETTINGS[i].max);
+    } else {
+      TEST_ASSERT_TRUE(SETTINGS[i].defaultNumber >= SETTINGS[i].min);
+      TEST_ASSERT_TRUE(SETTINGS[i].defaultNumber <= SETTINGS[i].max);
+    }
+  }
+}
+
+int runUnityTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_key_should_be_found);
+  RUN_TEST(test_unknown_keys_should_not_be_found);
+  RUN_TEST(test_keys_should_fit_in_nvs);
+  RUN_TEST(test_defaults_should_be_in_range);
+  return UNITY_END();
+}
+
+
+int main() {
+  return runUnityTests();
+}
@@ -0,0 +1,161 @@
+#include "unity.h"
+#include "Locator.h"
+#include "SpatialGrid.h"
+
+class Box : public Sprite {
+  public:
+    Box(int8_t x, int8_t y, uint8_t width, uint8_t height) {
+      moveTo(x, y);
+      _width = width;
+      _height = height;
+    }
+
+    void moveTo(int8_t x, int8_t y) {
+      _x = x;
+      _y = y;
+    }
+
+    const char* name() override {
+      return "BOX";
+    }
+};
+
+// Counts the COLLISION events of one sprite and keeps the last sprite it hit
+class Collisions : public EventTask {
+  public:
+    int count = 0;
+    Sprite* last = nullptr;
+
+    void execute(EventType event, Sprite* caller) override {
+      if (event == COLLISION) {
+        count++;
+        last = caller;
+      }
+    }
+};
+
+EventBus bus;
+SpatialGrid* grid;
+
+void setUp(void) {
+  Locator::provide(&bus);
+  grid = new SpatialGrid();
+}
+
+void tearDown(void) {
+  delete grid;
+}
+
+void test_a_pair_should_collide_once_until_it_separates(void) {
+  Box a(10, 10, 8, 8), b(30, 10, 8, 8);
+  Collisions hitsA, hitsB;
+
+  grid->add(&a, &hitsA);
+  grid->add(&b, &hitsB);
+  TEST_ASSERT_EQUAL(0, hitsA.count);
+
+  b.moveTo(16, 10);
+  grid->update(&b);
+  TEST_ASSERT_EQUAL(1, hitsA.count);
+  TEST_ASSERT_EQUAL(1, hitsB.count);
+  TEST_ASSERT_TRUE(hitsA.last == &b);
+  TEST_ASSERT_TRUE(hitsB.last == &a);
+
+  // Still overlapping, from either side
+  b.moveTo(14, 12);
+  grid->update(&b);
+  a.moveTo(11, 10);
+  grid->update(&a);
+  TEST_ASSERT_EQUAL(1, hitsA.count);
+  TEST_ASSERT_EQUAL(1, hitsB.count);
+
+  // Touching edges do not overlap
+  b.moveTo(19, 10);
+  grid->update(&b);
+  b.moveTo(18, 10);
+  grid->update(&b);
+  TEST_ASSERT_EQUAL(2, hitsA.count);
+  TEST_ASSERT_EQUAL(2, hitsB.count);
+}
+
+void test_sprites_across_the_edges_should_be_clipped_to_the_edge_cells(void) {
+  Box left(-4, 20, 8, 8), right(60, 60, 8, 8), corner(62, 62, 2, 2), inside(2, 22, 2, 2);
+  Collisions hitsLeft, hitsRight;
+  Sprite* found[4];
+
+  grid->add(&left, &hitsLeft);
+  grid->add(&right, &hitsRight);
+  grid->add(&corner);
+  grid->add(&inside);
+
+  TEST_ASSERT_EQUAL(1, hitsLeft.count);
+  TEST_ASSERT_TRUE(hitsLeft.last == &inside);
+  TEST_ASSERT_EQUAL(1, hitsRight.count);
+  TEST_ASSERT_TRUE(hitsRight.last == &corner);
+
+  TEST_ASSERT_EQUAL(1, grid->query(-10, 0, 11, 64, found, 4));
+  TEST_ASSERT_TRUE(found[0] == &left);
+  TEST_ASSERT_EQUAL(2, grid->query(63, 63, 10, 10, found, 4));
+  TEST_ASSERT_EQUAL(1, grid->query(63, 63, 10, 10, found, 4, &right));
+  TEST_ASSERT_TRUE(found[0] == &corner);
+}
+
+void test_sprites_off_the_display_should_collide_with_nothing(void) {
+  Box a(-20, 10, 8, 8), b(-18, 12, 8, 8), c(10, 70, 8, 8), d(12, 72, 8, 8);
+  Collisions hitsA, hitsC;
+  Sprite* found[4];
+
+  grid->add(&a, &hitsA);
+  grid->add(&b);
+  grid->add(&c, &hitsC);
+  grid->add(&d);
+  TEST_ASSERT_EQUAL(0, hitsA.count);
+  TEST_ASSERT_EQUAL(0, hitsC.count);
+  TEST_ASSERT_EQUAL(0, grid->query(-30, -30, 120, 120, found, 4));
+
+  // Back on the display, the pair starts to overlap
+  a.moveTo(0, 10);
+  grid->update(&a);
+  b.moveTo(2, 12);
+  grid->update(&b);
+  TEST_ASSERT_EQUAL(1, hitsA.count);
+}
+
+void test_removing_a_sprite_should_forget_its_pairs_both_ways(void) {
+  Box a(10, 10, 8, 8), b(12, 12, 8, 8);
+  Collisions hitsA, hitsB;
+
+  grid->add(&a, &hitsA);
+  grid->add(&b, &hitsB);
+  TEST_ASSERT_EQUAL(1, hitsA.count);
+  TEST_ASSERT_EQUAL(1, hitsB.count);
+
+  // Added again at the same place, both sides see a new pair
+  grid->remove(&b);
+  grid->add(&b, &hitsB);
+  TEST_ASSERT_EQUAL(2, hitsA.count);
+  TEST_ASSERT_EQUAL(2, hitsB.count);
+
+  grid->remove(&a);
+  b.moveTo(11, 11);
+  grid->update(&b);
+  TEST_ASSERT_EQUAL(2, hitsB.count);
+
+  grid->add(&a, &hitsA);
+  TEST_ASSERT_EQUAL(3, hitsA.count);
+  TEST_ASSERT_EQUAL(3, hitsB.count);
+}
+
+int runUnityTests(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_a_pair_should_collide_once_until_it_separates);
+  RUN_TEST(test_sprites_across_the_edges_should_be_clipped_to_the_edge_cells);
+  RUN_TEST(test_sprites_off_the_display_should_collide_with_nothing);
+  RUN_TEST(test_removing_a_sprite_should_forget_its_pairs_both_ways);
+  return UNITY_END();
+}
+
+
+int main() {
+  return runUnityTests();
+}
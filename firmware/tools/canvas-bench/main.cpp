@@ -0,0 +1,313 @@
+// Measures what the cw-cf-0x07 engine costs on real canvases, on the host with a memory
+// display and a simulated clock: parse time, heap, the decode time of every image and the
+// cost of each update over 10 simulated minutes.
+//
+//   pio run -e bench
+//   .pio/build/bench/program                    data/*.json and the canvases in localcanvas.h
+//   .pio/build/bench/program data/vespa.json    only these files
+//
+// Times are host times, only comparable between runs on the same machine. Heap counts what
+// the engine allocates with new, the sprite cache (allocated with malloc) is given apart.
+
+#include <stdio.h>
+#include <dirent.h>
+#include <time.h>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+#include <PNGdec.h>
+#include <PNGRender.h>
+#include "CanvasProgram.h"
+#include "CanvasRenderer.h"
+#include "localcanvas.h"
+#include "picopixel.h"
+#include "fonts/atari.h"
+#include "fonts/hour8pt7b.h"
+#include "fonts/minute7pt7b.h"
+#include "fonts/cartographer3pt7b.h"
+
+#define BENCH_MINUTES 10
+
+// 2024-01-01 09:59:00 UTC, a minute and an hour roll over early in the run
+#define BENCH_EPOCH 1704103140
+
+static size_t heapUsed = 0;
+static size_t heapPeak = 0;
+
+static const size_t BLOCK_HEADER = alignof(std::max_align_t);
+
+void *operator new(size_t size)
+{
+  uint8_t *block = (uint8_t *)malloc(size + BLOCK_HEADER);
+  if (block == nullptr)
+    throw std::bad_alloc();
+
+  *(size_t *)block = size;
+  heapUsed += size;
+  heapPeak = max(heapPeak, heapUsed);
+  return block + BLOCK_HEADER;
+}
+
+void operator delete(void *memory) noexcept
+{
+  if (memory == nullptr)
+    return;
+
+  uint8_t *block = (uint8_t *)memory - BLOCK_HEADER;
+  heapUsed -= *(size_t *)block;
+  free(block);
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *memory) noexcept { operator delete(memory); }
+void operator delete(void *memory, size_t) noexcept { operator delete(memory); }
+void operator delete[](void *memory, size_t) noexcept { operator delete(memory); }
+
+// The 64x64 panel, counting the pixels written to it
+class MemoryDisplay : public Adafruit_GFX
+{
+public:
+  uint16_t pixels[64 * 64] = {};
+  uint32_t writes = 0;
+
+  MemoryDisplay() : Adafruit_GFX(64, 64) {}
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override
+  {
+    writes++;
+    if (x >= 0 && x < 64 && y >= 0 && y < 64)
+      pixels[y * 64 + x] = color;
+  }
+};
+
+static MemoryDisplay display;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The ezTime letters canvases use, anything else is copied as is
+static String formatTime(const char *format, time_t now)
+{
+  static const char *DAYS[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  static const char *MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  struct tm time;
+  gmtime_r(&now, &time);
+
+  std::string text;
+  char field[8];
+
+  for (const char *c = format; *c; c++)
+  {
+    field[0] = 0;
+    switch (*c)
+    {
+    case 'H': snprintf(field, sizeof(field), "%02d", time.tm_hour); break;
+    case 'G': snprintf(field, sizeof(field), "%d", time.tm_hour); break;
+    case 'h': snprintf(field, sizeof(field), "%02d", (time.tm_hour + 11) % 12 + 1); break;
+    case 'g': snprintf(field, sizeof(field), "%d", (time.tm_hour + 11) % 12 + 1); break;
+    case 'i': snprintf(field, sizeof(field), "%02d", time.tm_min); break;
+    case 's': snprintf(field, sizeof(field), "%02d", time.tm_sec); break;
+    case 'A': snprintf(field, sizeof(field), "%s", time.tm_hour < 12 ? "AM" : "PM"); break;
+    case 'a': snprintf(field, sizeof(field), "%s", time.tm_hour < 12 ? "am" : "pm"); break;
+    case 'd': snprintf(field, sizeof(field), "%02d", time.tm_mday); break;
+    case 'j': snprintf(field, sizeof(field), "%d", time.tm_mday); break;
+    case 'D': snprintf(field, sizeof(field), "%s", DAYS[time.tm_wday]); break;
+    case 'm': snprintf(field, sizeof(field), "%02d", time.tm_mon + 1); break;
+    case 'n': snprintf(field, sizeof(field), "%d", time.tm_mon + 1); break;
+    case 'M': snprintf(field, sizeof(field), "%s", MONTHS[time.tm_mon]); break;
+    case 'Y': snprintf(field, sizeof(field), "%d", time.tm_year + 1900); break;
+    case 'y': snprintf(field, sizeof(field), "%02d", time.tm_year % 100); break;
+    case '~':
+    case '\\':
+      if (c[1] != 0)
+        c++;
+      // fall through
+    default:
+      text += *c;
+      break;
+    }
+    text += field;
+  }
+  return String(text);
+}
+
+// The simulated time of the run
+class BenchClock : public CanvasClock
+{
+public:
+  time_t now = BENCH_EPOCH;
+
+  String format(const char *format) override { return formatTime(format, now); }
+
+  int16_t minuteOfDay() override
+  {
+    struct tm time;
+    gmtime_r(&now, &time);
+    return time.tm_hour * 60 + time.tm_min;
+  }
+
+  int16_t day() override
+  {
+    struct tm time;
+    gmtime_r(&now, &time);
+    return time.tm_mday;
+  }
+
+  uint8_t second() override { return now % 60; }
+};
+
+static BenchClock benchClock;
+
+static bool bench(const char *name, const char *json)
+{
+  size_t heapStart = heapUsed;
+  heapPeak = heapUsed;
+
+  CanvasProgram program;
+  MemoryStream stream(json);
+  String error;
+
+  auto start = std::chrono::steady_clock::now();
+  if (!program.compile(stream, stream.length(), *Locator::getFontRegistry(), nullptr, error)) {
+    printf("%s: %s\n", name, error.c_str());
+    return false;
+  }
+
+  printf("%s: '%s' version %u\n", name, program.text(program.name), program.version);
+  printf("  parse        %8.3f ms  %u bytes of JSON -> %u bytes, heap peak %u\n", elapsedMs(start), (unsigned)stream.length(),
+         (unsigned)program.memoryUsage(), (unsigned)(heapPeak - heapStart));
+
+  // Setup images are decoded whenever the canvas is drawn, sprite frames once into the cache
+  for (const CanvasElement &element : program.elements)
+  {
+    if (element.type != ELEMENT_IMAGE)
+      continue;
+
+    uint8_t width = 0, height = 0;
+    getImageDimensions(program.text(element.text), width, height);
+
+    start = std::chrono::steady_clock::now();
+    renderImage(program.text(element.text), element.x, element.y);
+    printf("  image        %8.3f ms  %ux%u at %d,%d\n", elapsedMs(start), width, height, element.x, element.y);
+  }
+
+  SpriteCache cache;
+  for (uint16_t i = 0; i < program.frameHandles.size();)
+  {
+    uint8_t animated = program.animationFrames(i);
+
+    start = std::chrono::steady_clock::now();
+    uint16_t cached = CanvasRenderer::cacheFrames(cache, program, i);
+    double ms = elapsedMs(start);
+
+    uint8_t width = 0, height = 0;
+    cache.getDimensions(program.frameHandles[i], width, height);
+    printf("  frame %-4u   %8.3f ms  %ux%u%s%s\n", i, ms, width, height, animated > 0 ? ", animation" : "",
+           program.frameHandles[i] < 0 ? ", not cached" : "");
+    i += cached;
+  }
+  printf("  sprite cache %u images, %u bytes\n", (unsigned)cache.count(), (unsigned)cache.usedBytes());
+
+  // Drawn the way the Clockface draws it
+  CanvasRenderer renderer(&display, &benchClock);
+  benchClock.now = BENCH_EPOCH;
+
+  start = std::chrono::steady_clock::now();
+  renderer.show(program, cache);
+  printf("  first screen %8.3f ms\n", elapsedMs(start));
+
+  // Every ms of the run is an update, like the busy loop of the firmware
+  const unsigned long duration = BENCH_MINUTES * 60 * 1000UL;
+  unsigned long lastTick = 0;
+  uint32_t drawing = 0, writesBefore = display.writes;
+  double total = 0, worst = 0, drawingTotal = 0;
+
+  for (unsigned long now = 1; now <= duration; now++)
+  {
+    uint32_t writes = display.writes;
+    start = std::chrono::steady_clock::now();
+
+    benchClock.now = BENCH_EPOCH + now / 1000;
+    renderer.animate(now);
+
+    if (now - lastTick >= 1000) {
+      renderer.refreshDateTime();
+      lastTick = now;
+    }
+
+    double ms = elapsedMs(start);
+    total += ms;
+    worst = max(worst, ms);
+    if (display.writes != writes) {
+      drawing++;
+      drawingTotal += ms;
+    }
+  }
+
+  printf("  %u minutes   %8.3f ms  %lu updates, %u drew (%.2f us each), worst %.3f ms, %u pixels written\n", BENCH_MINUTES, total, duration, drawing,
+         drawing > 0 ? drawingTotal * 1000 / drawing : 0.0, worst, (unsigned)(display.writes - writesBefore));
+  printf("  heap         peak %u bytes, sprite cache %u bytes\n\n", (unsigned)(heapPeak - heapStart), (unsigned)cache.usedBytes());
+  return true;
+}
+
+static std::string readFile(const char *path)
+{
+  std::string content;
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr)
+    return content;
+
+  char chunk[4096];
+  size_t length;
+  while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    content.append(chunk, length);
+  fclose(file);
+  return content;
+}
+
+int main(int argc, char **argv)
+{
+  Locator::provide(&display);
+
+  // Same names as the Clockface gives them
+  FontRegistry *fonts = Locator::getFontRegistry();
+  fonts->add("picopixel", &Picopixel);
+  fonts->add("square", &atariFont);
+  fonts->add("big", &hour8pt7b);
+  fonts->add("medium", &minute7pt7b);
+  fonts->add("carto", &cartographer3pt7b);
+
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++)
+    files.push_back(argv[i]);
+
+  if (argc == 1) {
+    DIR *data = opendir("data");
+    struct dirent *entry;
+    while (data != nullptr && (entry = readdir(data)) != nullptr)
+    {
+      std::string name = entry->d_name;
+      if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0)
+        files.push_back("data/" + name);
+    }
+    if (data != nullptr)
+      closedir(data);
+  }
+
+  bool ok = true;
+  for (const std::string &file : files)
+  {
+    std::string json = readFile(file.c_str());
+    ok = (!json.empty() && bench(file.c_str(), json.c_str())) && ok;
+  }
+
+  if (argc == 1) {
+    ok = bench("localcanvas.h vespa", vespa) && ok;
+    ok = bench("localcanvas.h snoopy3", snoopy3) && ok;
+  }
+  return (ok ? 0 : 1);
+}
@@ -0,0 +1,347 @@
+// Compiles a clock-club canvas (JSON with base64 PNGs) into a bundle the clock loads
+// without parsing or decoding anything, see CanvasBundle.h for the layout.
+//
+//   pio run -e bundler
+//   .pio/build/bundler/program data/vespa.json vespa.cwb
+//   curl --data-binary @vespa.cwb "http://<clock>/canvas/bundle?name=vespa"
+//
+// A bundle placed in data/ is also flashed by 'pio run -t uploadfs'.
+
+#include <stdio.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <PNGdec.h>
+#include <AnimationDecoder.h>
+#include "CanvasProgram.h"
+
+#ifndef CW_SPRITE_CACHE_BUDGET
+  #define CW_SPRITE_CACHE_BUDGET 32768
+#endif
+
+static bool decodeBase64(const char *text, std::vector<uint8_t> &out)
+{
+  static const char *ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  uint32_t bits = 0;
+  uint8_t count = 0;
+
+  for (const char *c = text; *c && *c != '='; c++)
+  {
+    if (*c == '\n' || *c == '\r')
+      continue;
+
+    const char *found = strchr(ALPHABET, *c);
+    if (found == nullptr)
+      return false;
+
+    bits = (bits << 6) | (found - ALPHABET);
+    count += 6;
+    if (count >= 8) {
+      count -= 8;
+      out.push_back((bits >> count) & 0xFF);
+    }
+  }
+  return !out.empty();
+}
+
+struct DecodeTarget
+{
+  PNG *decoder;
+  std::vector<uint8_t> *atlas;
+  uint32_t pixels;
+  uint32_t mask;
+  bool hasMask;
+};
+
+static void decodeLine(PNGDRAW *draw)
+{
+  DecodeTarget *target = (DecodeTarget *)draw->pUser;
+  uint8_t *atlas = target->atlas->data();
+
+  target->decoder->getLineAsRGB565(draw, (uint16_t *)(atlas + target->pixels) + draw->y * draw->iWidth, PNG_RGB565_LITTLE_ENDIAN, 0xffffffff);
+
+  if (target->hasMask)
+    target->decoder->getAlphaMask(draw, atlas + target->mask + draw->y * ((draw->iWidth + 7) / 8), 128);
+}
+
+// Decoded images, identical base64 strings share one bitmap
+class Atlas
+{
+private:
+  std::map<std::string, uint16_t> _indexes;
+  PNG _png;
+
+public:
+  std::vector<CanvasBundleBitmap> bitmaps;
+  std::vector<uint8_t> data;
+
+  bool add(const char *base64, uint16_t &index)
+  {
+    auto found = _indexes.find(base64);
+    if (found != _indexes.end()) {
+      index = found->second;
+      return true;
+    }
+
+    std::vector<uint8_t> png;
+    if (!decodeBase64(base64, png) || _png.openRAM(png.data(), png.size(), decodeLine) != PNG_SUCCESS)
+      return false;
+
+    if (_png.getWidth() > UINT8_MAX || _png.getHeight() > UINT8_MAX) {
+      _png.close();
+      return false;
+    }
+
+    CanvasBundleBitmap bitmap = {};
+    bitmap.offset = data.size();
+    bitmap.width = _png.getWidth();
+    bitmap.height = _png.getHeight();
+    bitmap.hasMask = (_png.hasAlpha() != 0);
+
+    DecodeTarget target = {&_png, &data, bitmap.offset, bitmap.offset + bitmap.pixelBytes(), (bool)bitmap.hasMask};
+    data.resize(data.size() + bitmap.pixelBytes() + bitmap.maskBytes());
+    int rc = _png.decode(&target, 0);
+    _png.close();
+
+    if (rc != PNG_SUCCESS) {
+      data.resize(bitmap.offset);
+      return false;
+    }
+
+    index = bitmaps.size();
+    bitmaps.push_back(bitmap);
+    _indexes[base64] = index;
+    return true;
+  }
+
+  // Every frame of an animation becomes a bitmap of its own
+  bool addAnimation(const char *base64, uint8_t count, std::vector<uint16_t> &indexes)
+  {
+    std::vector<uint8_t> file;
+    AnimationDecoder animation;
+    if (!decodeBase64(base64, file) || !animation.open(file.data(), file.size(), &_png))
+      return false;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (!animation.next())
+        return false;
+
+      CanvasBundleBitmap bitmap = {};
+      bitmap.offset = data.size();
+      bitmap.width = animation.width();
+      bitmap.height = animation.height();
+      bitmap.hasMask = animation.hasMask();
+
+      const uint8_t *pixels = (const uint8_t *)animation.pixels();
+      data.insert(data.end(), pixels, pixels + bitmap.pixelBytes());
+      if (bitmap.hasMask)
+        data.insert(data.end(), animation.mask(), animation.mask() + bitmap.maskBytes());
+
+      indexes.push_back(bitmaps.size());
+      bitmaps.push_back(bitmap);
+    }
+    return true;
+  }
+};
+
+// The program's pool without the base64 images, which are in the atlas now
+class StringPool
+{
+public:
+  std::vector<char> data = {0};
+
+  uint16_t add(const char *text)
+  {
+    if (*text == 0)
+      return 0;
+
+    uint16_t offset = data.size();
+    data.insert(data.end(), text, text + strlen(text) + 1);
+    return offset;
+  }
+};
+
+// Collects a font pack written by the registry
+class BytePrint : public Print
+{
+public:
+  std::vector<uint8_t> data;
+
+  size_t write(uint8_t c) override
+  {
+    data.push_back(c);
+    return 1;
+  }
+};
+
+template <typename T>
+static void writeRecord(FILE *file, const T &record)
+{
+  fwrite(&record, sizeof(record), 1, file);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <canvas.json> <canvas.cwb>\n", argv[0]);
+    return 2;
+  }
+
+  FILE *input = fopen(argv[1], "rb");
+  if (input == nullptr) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  std::string json;
+  char chunk[4096];
+  size_t length;
+  while ((length = fread(chunk, 1, sizeof(chunk), input)) > 0)
+    json.append(chunk, length);
+  fclose(input);
+
+  // Fonts are only told apart by name, the clock resolves them when it loads the bundle
+  FontRegistry fonts;
+  CanvasProgram program;
+  MemoryStream stream(json.c_str());
+  String error;
+
+  if (!program.compile(stream, json.size(), fonts, nullptr, error)) {
+    fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+    return 1;
+  }
+
+  Atlas atlas;
+  StringPool strings;
+  std::vector<CanvasBundleElement> elements;
+  std::vector<CanvasBundleFrame> frames;
+
+  for (const CanvasElement &element : program.elements)
+  {
+    uint16_t text;
+
+    if (element.type != ELEMENT_IMAGE)
+      text = strings.add(program.text(element.text));
+    else if (!atlas.add(program.text(element.text), text)) {
+      fprintf(stderr, "%s: cannot decode a setup image at %d,%d\n", argv[1], element.x, element.y);
+      return 1;
+    }
+
+    CanvasBundleElement record = {element.type, strings.add(fonts.name(element.font)), element.x, element.y, element.x1, element.y1, element.color, element.bgColor, text};
+    elements.push_back(record);
+  }
+
+  for (uint16_t i = 0; i < program.frameHandles.size();)
+  {
+    uint16_t bitmap;
+    std::vector<uint16_t> bitmaps;
+    uint8_t animated = program.animationFrames(i);
+
+    if (animated > 0 ? !atlas.addAnimation(program.frame(i), animated, bitmaps) : !atlas.add(program.frame(i), bitmap)) {
+      fprintf(stderr, "%s: cannot decode sprite frame %u\n", argv[1], i);
+      return 1;
+    }
+
+    if (animated == 0)
+      bitmaps.push_back(bitmap);
+
+    for (uint16_t bitmap : bitmaps)
+    {
+      frames.push_back({bitmap, program.frameDelay(i)});
+      i++;
+    }
+  }
+
+  std::vector<CanvasBundleFont> fontRecords;
+  std::vector<BytePrint> fontPacks(program.fontPacks.size());
+
+  for (size_t i = 0; i < program.fontPacks.size(); i++)
+  {
+    fonts.save(program.fontPacks[i], fontPacks[i]);
+    fontRecords.push_back({strings.add(fonts.name(program.fontPacks[i])), (uint32_t)fontPacks[i].data.size()});
+  }
+
+  CanvasBundleHeader header = {};
+  header.magic = CW_CANVAS_BUNDLE_MAGIC;
+  header.format = CANVAS_BUNDLE_FORMAT;
+  header.version = program.version;
+  header.bgColor = program.bgColor;
+  header.delay = program.delay;
+  header.name = strings.add(program.text(program.name));
+  header.author = strings.add(program.text(program.author));
+  header.stringsSize = strings.data.size();
+  header.elementCount = elements.size();
+  header.spriteCount = program.sprites.size();
+  header.frameCount = frames.size();
+  header.instanceCount = program.instances.size();
+  header.bitmapCount = atlas.bitmaps.size();
+  header.keyframeCount = program.keyframes.size();
+  header.fontCount = fontRecords.size();
+  header.atlasSize = atlas.data.size();
+
+  FILE *output = fopen(argv[2], "wb");
+  if (output == nullptr) {
+    fprintf(stderr, "Cannot create %s\n", argv[2]);
+    return 1;
+  }
+
+  writeRecord(output, header);
+  fwrite(strings.data.data(), 1, strings.data.size(), output);
+
+  for (const CanvasBundleElement &record : elements)
+    writeRecord(output, record);
+
+  // Sprites take their size from the first frame, as the clock did when decoding them
+  for (const CanvasSpriteFrames &sprite : program.sprites)
+  {
+    CanvasBundleSprite record = {sprite.firstFrame, sprite.count, 0, 0};
+    if (sprite.count > 0) {
+      record.width = atlas.bitmaps[frames[sprite.firstFrame].bitmap].width;
+      record.height = atlas.bitmaps[frames[sprite.firstFrame].bitmap].height;
+    }
+    writeRecord(output, record);
+  }
+
+  for (const CanvasBundleFrame &record : frames)
+    writeRecord(output, record);
+
+  for (const CanvasSpriteInstance &instance : program.instances)
+  {
+    CanvasBundleInstance record = {instance.loopDelay, instance.frameDelay, instance.moveStartTime, instance.firstKeyframe, instance.keyframeCount,
+                                   instance.sprite, instance.x, instance.y};
+    writeRecord(output, record);
+  }
+
+  for (const Keyframe &keyframe : program.keyframes)
+  {
+    CanvasBundleKeyframe record = {keyframe.x, keyframe.y, keyframe.easing, keyframe.duration};
+    writeRecord(output, record);
+  }
+
+  for (size_t i = 0; i < fontRecords.size(); i++)
+  {
+    writeRecord(output, fontRecords[i]);
+    fwrite(fontPacks[i].data.data(), 1, fontPacks[i].data.size(), output);
+  }
+
+  for (const CanvasBundleBitmap &bitmap : atlas.bitmaps)
+    writeRecord(output, bitmap);
+
+  fwrite(atlas.data.data(), 1, atlas.data.size(), output);
+  long size = ftell(output);
+  fclose(output);
+
+  printf("%s: '%s' version %u, %u elements, %u sprite frames as %u bitmaps\n", argv[2], program.text(program.name), program.version,
+         (unsigned)elements.size(), (unsigned)frames.size(), (unsigned)atlas.bitmaps.size());
+  printf("%s: %u bytes of JSON -> %ld bytes, atlas %u bytes\n", argv[2], (unsigned)json.size(), size, (unsigned)atlas.data.size());
+
+  if (atlas.data.size() > CW_SPRITE_CACHE_BUDGET)
+    printf("warning: the atlas exceeds the sprite cache budget (%u bytes), some frames will be read from flash while drawing\n", CW_SPRITE_CACHE_BUDGET);
+
+  if (size > CW_CANVAS_BUNDLE_MAX_SIZE) {
+    fprintf(stderr, "%s: larger than the %u bytes a clock accepts\n", argv[2], CW_CANVAS_BUNDLE_MAX_SIZE);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Converts a font header written by Adafruit's fontconvert into a font pack (.cwf).
+
+    python tools/font-pack/fontpack.py FreeSans9pt7b.h data/fonts/sans.cwf
+
+A pack in data/fonts/ is flashed by 'pio run -t uploadfs' and used by any canvas naming
+the font ("font": "sans"). To ship it inside a canvas instead, add it to "fonts":
+
+    python tools/font-pack/fontpack.py FreeSans9pt7b.h sans.cwf --base64
+
+The layout is described in lib/cw-gfx-engine/FontRegistry.h.
+"""
+
+import base64
+import re
+import struct
+import sys
+
+MAGIC = 0x31465743  # "CWF1"
+
+
+def array_body(source, type_name):
+    match = re.search(r"const\s+" + type_name + r"\s+\w+\s*\[\s*\]\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S)
+    if match is None:
+        raise ValueError("no %s array found" % type_name)
+    return match.group(1)
+
+
+def numbers(text):
+    text = re.sub(r"//.*", "", text)
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return [int(value, 0) for value in re.findall(r"-?(?:0x[0-9a-fA-F]+|\d+)", text)]
+
+
+def convert(source):
+    bitmap = bytes(numbers(array_body(source, "uint8_t")))
+    glyphs = numbers(array_body(source, "GFXglyph"))
+
+    match = re.search(r"const\s+GFXfont\s+\w+\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S)
+    if match is None:
+        raise ValueError("no GFXfont found")
+    first, last, y_advance = numbers(re.sub(r"\([^)]*\)\s*\w+", "", match.group(1)))[-3:]
+
+    if len(glyphs) != (last - first + 1) * 6:
+        raise ValueError("expected %d glyphs, found %d" % (last - first + 1, len(glyphs) // 6))
+    if last > 255:
+        raise ValueError("codes above 255 are not supported")
+
+    pack = struct.pack("<IHHBBI", MAGIC, first, last, y_advance, 0, len(bitmap))
+    for i in range(0, len(glyphs), 6):
+        pack += struct.pack("<HBBBbb", *glyphs[i:i + 6])
+    return pack + bitmap
+
+
+def main(argv):
+    if len(argv) not in (3, 4) or (len(argv) == 4 and argv[3] != "--base64"):
+        print("Usage: %s <font.h> <font.cwf> [--base64]" % argv[0], file=sys.stderr)
+        return 2
+
+    with open(argv[1]) as header:
+        pack = convert(header.read())
+
+    with open(argv[2], "wb") as output:
+        output.write(pack)
+
+    print("%s: %d bytes" % (argv[2], len(pack)))
+    if len(argv) == 4:
+        print(base64.b64encode(pack).decode())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))